@@ -0,0 +1,226 @@
+#include "CompactVertex.h"
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+static_assert(sizeof(CompactVertex) == sizeof(Vertex) / 2, "CompactVertex is expected to be half the size of Vertex");
+
+VkVertexInputBindingDescription CompactVertex::getBindingDescription()
+{
+	VkVertexInputBindingDescription bindingDescription = {};
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(CompactVertex);
+	bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+	return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> CompactVertex::getAttributeDescriptions()
+{
+	/*Same locations as Vertex, the shader sees floats either way and only the decoding differs*/
+	std::array<VkVertexInputAttributeDescription, 3> atributeDescriptions = {};
+
+	atributeDescriptions[0].binding = 0;
+	atributeDescriptions[0].location = 0;
+	atributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+	atributeDescriptions[0].offset = offsetof(CompactVertex, pos);
+
+	atributeDescriptions[1].binding = 0;
+	atributeDescriptions[1].location = 1;
+	atributeDescriptions[1].format = VK_FORMAT_R16G16_SFLOAT;
+	atributeDescriptions[1].offset = offsetof(CompactVertex, texCoord);
+
+	/*The shader reads a vec3, the missing third component is filled in with 0*/
+	atributeDescriptions[2].binding = 0;
+	atributeDescriptions[2].location = 2;
+	atributeDescriptions[2].format = VK_FORMAT_R16G16_SNORM;
+	atributeDescriptions[2].offset = offsetof(CompactVertex, norm);
+
+	return atributeDescriptions;
+}
+
+VertexDecode makeVertexDecode(const std::vector<Vertex>& vertices, VertexFormat format)
+{
+	VertexDecode decode;
+	decode.positionOffset = glm::vec4(0.0f);
+	decode.positionScale = glm::vec4(1.0f);
+
+	if ((format != VertexFormat::Compact) || vertices.empty())
+	{
+		return decode;
+	}
+
+	glm::vec3 minimum = vertices[0].pos;
+	glm::vec3 maximum = vertices[0].pos;
+
+	for (const Vertex& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.pos);
+		maximum = glm::max(maximum, vertex.pos);
+	}
+
+	decode.positionOffset = glm::vec4(minimum, 0.0f);
+	decode.positionScale = glm::vec4(maximum - minimum, 0.0f);
+
+	return decode;
+}
+
+/*Rounds a value in [0, 1] or [-1, 1] to the nearest step of a normalized integer format*/
+static int32_t quantizeNormalized(float value, float lowest, float steps)
+{
+	return static_cast<int32_t>(std::floor((std::min)((std::max)(value, lowest), 1.0f) * steps + 0.5f));
+}
+
+/*Like the sign, but 0 counts as positive so the folded octahedron has no seam at the axes*/
+static float signNotZero(float value)
+{
+	return (value >= 0.0f) ? 1.0f : -1.0f;
+}
+
+std::vector<CompactVertex> encodeCompactVertices(const std::vector<Vertex>& vertices, const VertexDecode& decode)
+{
+	std::vector<CompactVertex> compactVertices(vertices.size());
+
+	/*Flat axes have no extent, any value decodes to the offset there*/
+	const glm::vec3 extent = glm::vec3(decode.positionScale);
+	const glm::vec3 inverseExtent(extent.x > 0.0f ? 1.0f / extent.x : 0.0f, extent.y > 0.0f ? 1.0f / extent.y : 0.0f, extent.z > 0.0f ? 1.0f / extent.z : 0.0f);
+
+	for (size_t index = 0; index < vertices.size(); index++)
+	{
+		const Vertex& vertex = vertices[index];
+		CompactVertex& compactVertex = compactVertices[index];
+
+		const glm::vec3 position = (vertex.pos - glm::vec3(decode.positionOffset)) * inverseExtent;
+
+		for (unsigned int axis = 0; axis < 3; axis++)
+		{
+			compactVertex.pos[axis] = static_cast<uint16_t>(quantizeNormalized(position[axis], 0.0f, 65535.0f));
+		}
+
+		compactVertex.pos[3] = 0;
+
+		/*Project the normal onto the octahedron |x| + |y| + |z| = 1 and fold the lower half over the upper one*/
+		const float length = std::abs(vertex.norm.x) + std::abs(vertex.norm.y) + std::abs(vertex.norm.z);
+		glm::vec2 octahedral(0.0f); // Missing normals stay at 0, which decodes to +z
+
+		if (length > 0.0f)
+		{
+			octahedral = glm::vec2(vertex.norm.x, vertex.norm.y) / length;
+
+			if (vertex.norm.z < 0.0f)
+			{
+				octahedral = glm::vec2((1.0f - std::abs(octahedral.y)) * signNotZero(octahedral.x), (1.0f - std::abs(octahedral.x)) * signNotZero(octahedral.y));
+			}
+		}
+
+		compactVertex.norm[0] = static_cast<int16_t>(quantizeNormalized(octahedral.x, -1.0f, 32767.0f));
+		compactVertex.norm[1] = static_cast<int16_t>(quantizeNormalized(octahedral.y, -1.0f, 32767.0f));
+
+		compactVertex.texCoord[0] = floatToHalf(vertex.texCoord.x);
+		compactVertex.texCoord[1] = floatToHalf(vertex.texCoord.y);
+	}
+
+	return compactVertices;
+}
+
+Vertex decodeCompactVertex(const CompactVertex& vertex, const VertexDecode& decode)
+{
+	const glm::vec3 position(vertex.pos[0] / 65535.0f, vertex.pos[1] / 65535.0f, vertex.pos[2] / 65535.0f);
+
+	/*Signed normalized values below -1 are clamped, as the vertex input does*/
+	glm::vec3 normal((std::max)(vertex.norm[0] / 32767.0f, -1.0f), (std::max)(vertex.norm[1] / 32767.0f, -1.0f), 0.0f);
+	normal.z = 1.0f - std::abs(normal.x) - std::abs(normal.y);
+
+	/*Unfold the lower half of the octahedron*/
+	const float fold = (std::max)(-normal.z, 0.0f);
+	normal.x += (normal.x >= 0.0f) ? -fold : fold;
+	normal.y += (normal.y >= 0.0f) ? -fold : fold;
+
+	return Vertex(glm::vec3(decode.positionOffset) + position * glm::vec3(decode.positionScale),
+		glm::vec2(halfToFloat(vertex.texCoord[0]), halfToFloat(vertex.texCoord[1])),
+		glm::normalize(normal));
+}
+
+size_t vertexStride(VertexFormat format)
+{
+	return (format == VertexFormat::Compact) ? sizeof(CompactVertex) : sizeof(Vertex);
+}
+
+uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	const uint32_t sign = (bits >> 16) & 0x8000u;
+	const uint32_t magnitude = bits & 0x7FFFFFFFu;
+
+	/*Infinity and NaN keep their meaning, NaNs stay quiet*/
+	if (magnitude >= 0x7F800000u)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00u | ((magnitude > 0x7F800000u) ? 0x200u : 0u));
+	}
+
+	/*Halfway between the largest half float, 65504, and the next power of two rounds up to infinity*/
+	if (magnitude >= 0x477FF000u)
+	{
+		return static_cast<uint16_t>(sign | 0x7C00u);
+	}
+
+	uint32_t result;
+	uint32_t remainder;
+	uint32_t halfway;
+
+	if (magnitude < 0x38800000u)
+	{
+		/*Below the smallest normal half float, the result counts steps of 2^-24*/
+		const uint32_t shift = 126u - (magnitude >> 23);
+
+		if (shift >= 25u)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+
+		const uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+
+		result = mantissa >> shift;
+		remainder = mantissa & ((1u << shift) - 1u);
+		halfway = 1u << (shift - 1u);
+	}
+	else
+	{
+		/*Rebias the exponent from 127 to 15 and drop the lowest 13 mantissa bits*/
+		result = (magnitude - 0x38000000u) >> 13;
+		remainder = magnitude & 0x1FFFu;
+		halfway = 0x1000u;
+	}
+
+	/*Round to nearest, ties to even. A carry out of the mantissa correctly moves on to the next exponent*/
+	if ((remainder > halfway) || ((remainder == halfway) && (result & 1u)))
+	{
+		result++;
+	}
+
+	return static_cast<uint16_t>(sign | result);
+}
+
+float halfToFloat(uint16_t value)
+{
+	const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	const uint32_t exponent = (value >> 10) & 0x1Fu;
+	const uint32_t mantissa = value & 0x3FFu;
+
+	if (exponent == 0)
+	{
+		/*Zero and subnormals, which are normal numbers as 32-bit floats*/
+		const float magnitude = static_cast<float>(mantissa) * (1.0f / 16777216.0f);
+		return sign ? -magnitude : magnitude;
+	}
+
+	const uint32_t bits = sign | ((exponent == 0x1Fu) ? (0x7F800000u | (mantissa << 13)) : (((exponent + 112u) << 23) | (mantissa << 13)));
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+
+	return result;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <glm.hpp>
+#include <vulkan\vulkan.h>
+#include <array>
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+
+/*The layouts a mesh can be uploaded to the vertex buffer in*/
+enum class VertexFormat
+{
+	Full, // Vertex, 32 bytes of 32-bit floats
+	Compact // CompactVertex, 16 bytes which the vertex shader decodes
+};
+
+/*
+	Values the vertex shader needs to turn a compact vertex back into the original one, passed as push constants.
+	For the Full format the offset is 0 and the scale is 1, so the shader can apply them either way.
+*/
+struct VertexDecode
+{
+	glm::vec4 positionOffset; // Minimum corner of the mesh bounds, w is unused
+	glm::vec4 positionScale; // Extent of the mesh bounds, w is unused
+};
+
+/*
+	A vertex in half the size of Vertex.
+
+	The position is stored as 16-bit unsigned normalized values relative to the bounds of the mesh, which keeps
+	the error below 1/131070 of the mesh size on each axis. The normal is mapped onto an octahedron and unfolded
+	into two 16-bit signed normalized values, and the texture coordinates are half floats, which are accurate to
+	about 1/2048 within [0, 1] but lose precision on textures repeated many times.
+*/
+struct CompactVertex
+{
+	uint16_t pos[4]; // The fourth value pads the position to 8 bytes, three component 16-bit formats are optional for vertex buffers
+	int16_t norm[2];
+	uint16_t texCoord[2];
+
+	static VkVertexInputBindingDescription getBindingDescription();
+
+	static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+};
+
+/*Finds the bounds of the positions, which the compact positions are stored relative to*/
+VertexDecode makeVertexDecode(const std::vector<Vertex>& vertices, VertexFormat format);
+
+/*Converts every vertex to the compact layout, the decode has to come from makeVertexDecode for the same vertices*/
+std::vector<CompactVertex> encodeCompactVertices(const std::vector<Vertex>& vertices, const VertexDecode& decode);
+
+/*The inverse of the encoding, done the same way as in the vertex shader*/
+Vertex decodeCompactVertex(const CompactVertex& vertex, const VertexDecode& decode);
+
+/*Size in bytes of one vertex in the given format*/
+size_t vertexStride(VertexFormat format);
+
+/*Conversions between 32-bit and 16-bit floats, rounding to the nearest half float*/
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t value);
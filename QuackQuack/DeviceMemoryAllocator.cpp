@@ -0,0 +1,554 @@
+#include "DeviceMemoryAllocator.h"
+
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*Index of the lowest set bit, the mask must not be 0*/
+static unsigned int lowestSetBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+	/*Two 32 bit scans, the 64 bit intrinsic does not exist on x86*/
+	unsigned long index;
+
+	if (_BitScanForward(&index, static_cast<unsigned long>(mask)))
+	{
+		return static_cast<unsigned int>(index);
+	}
+
+	_BitScanForward(&index, static_cast<unsigned long>(mask >> 32));
+	return static_cast<unsigned int>(index) + 32;
+#else
+	return static_cast<unsigned int>(__builtin_ctzll(mask));
+#endif
+}
+
+/*Index of the highest set bit, the mask must not be 0*/
+static unsigned int highestSetBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+
+	if (_BitScanReverse(&index, static_cast<unsigned long>(mask >> 32)))
+	{
+		return static_cast<unsigned int>(index) + 32;
+	}
+
+	_BitScanReverse(&index, static_cast<unsigned long>(mask));
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(63 - __builtin_clzll(mask));
+#endif
+}
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/*std::max takes its arguments by reference, so the constants need a definition*/
+const uint32_t MemoryRangeAllocator::invalidRange;
+const VkDeviceSize MemoryRangeAllocator::minimumAlignment;
+
+MemoryRangeAllocator::MemoryRangeAllocator(VkDeviceSize size)
+{
+	for (unsigned int firstLevel = 0; firstLevel < 64; firstLevel++)
+	{
+		for (unsigned int secondLevel = 0; secondLevel < secondLevelCount; secondLevel++)
+		{
+			freeLists[firstLevel][secondLevel] = invalidRange;
+		}
+	}
+
+	capacity = size & ~(minimumAlignment - 1);
+
+	if (capacity == 0)
+	{
+		return;
+	}
+
+	/*The range at offset 0 is never merged into a previous one, so it stays the start of the physical list*/
+	const uint32_t range = newRange();
+	ranges[range].offset = 0;
+	ranges[range].size = capacity;
+
+	freeBytes = capacity;
+	insertFree(range);
+}
+
+uint32_t MemoryRangeAllocator::newRange()
+{
+	uint32_t range;
+
+	if (!unusedRanges.empty())
+	{
+		range = unusedRanges.back();
+		unusedRanges.pop_back();
+	}
+	else
+	{
+		range = static_cast<uint32_t>(ranges.size());
+		ranges.push_back(Range());
+	}
+
+	ranges[range] = { 0, 0, invalidRange, invalidRange, invalidRange, invalidRange, true };
+	return range;
+}
+
+void MemoryRangeAllocator::insertFree(uint32_t range)
+{
+	/*Free ranges are filed under the size class they fill completely, so any range of a class fits a search rounded up to it*/
+	const VkDeviceSize size = ranges[range].size;
+	const unsigned int firstLevel = highestSetBit(size);
+	const unsigned int secondLevel = static_cast<unsigned int>(size >> (firstLevel - secondLevelBits)) & (secondLevelCount - 1);
+
+	const uint32_t head = freeLists[firstLevel][secondLevel];
+
+	ranges[range].free = true;
+	ranges[range].previousFree = invalidRange;
+	ranges[range].nextFree = head;
+
+	if (head != invalidRange)
+	{
+		ranges[head].previousFree = range;
+	}
+
+	freeLists[firstLevel][secondLevel] = range;
+	secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+	firstLevelBitmap |= uint64_t(1) << firstLevel;
+}
+
+void MemoryRangeAllocator::removeFree(uint32_t range)
+{
+	const VkDeviceSize size = ranges[range].size;
+	const unsigned int firstLevel = highestSetBit(size);
+	const unsigned int secondLevel = static_cast<unsigned int>(size >> (firstLevel - secondLevelBits)) & (secondLevelCount - 1);
+
+	const uint32_t previous = ranges[range].previousFree;
+	const uint32_t next = ranges[range].nextFree;
+
+	if (previous != invalidRange)
+	{
+		ranges[previous].nextFree = next;
+	}
+	else
+	{
+		freeLists[firstLevel][secondLevel] = next;
+	}
+
+	if (next != invalidRange)
+	{
+		ranges[next].previousFree = previous;
+	}
+
+	if (freeLists[firstLevel][secondLevel] == invalidRange)
+	{
+		secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+
+		if (secondLevelBitmaps[firstLevel] == 0)
+		{
+			firstLevelBitmap &= ~(uint64_t(1) << firstLevel);
+		}
+	}
+
+	ranges[range].free = false;
+}
+
+uint32_t MemoryRangeAllocator::findFree(VkDeviceSize size) const
+{
+	/*Rounding the size up to the next class makes the first range of any larger class a fit, no list has to be walked*/
+	unsigned int firstLevel = highestSetBit(size);
+	const VkDeviceSize roundedSize = size + (VkDeviceSize(1) << (firstLevel - secondLevelBits)) - 1;
+
+	if (roundedSize < size)
+	{
+		return invalidRange;
+	}
+
+	firstLevel = highestSetBit(roundedSize);
+	const unsigned int secondLevel = static_cast<unsigned int>(roundedSize >> (firstLevel - secondLevelBits)) & (secondLevelCount - 1);
+
+	uint32_t secondLevelMask = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+
+	if (secondLevelMask == 0)
+	{
+		const uint64_t firstLevelMask = (firstLevel >= 63) ? 0 : (firstLevelBitmap & (~uint64_t(0) << (firstLevel + 1)));
+
+		if (firstLevelMask == 0)
+		{
+			return invalidRange;
+		}
+
+		firstLevel = lowestSetBit(firstLevelMask);
+		secondLevelMask = secondLevelBitmaps[firstLevel];
+	}
+
+	return freeLists[firstLevel][lowestSetBit(secondLevelMask)];
+}
+
+uint32_t MemoryRangeAllocator::splitRange(uint32_t range, VkDeviceSize size)
+{
+	const uint32_t rest = newRange();
+
+	ranges[rest].offset = ranges[range].offset + size;
+	ranges[rest].size = ranges[range].size - size;
+	ranges[rest].previousPhysical = range;
+	ranges[rest].nextPhysical = ranges[range].nextPhysical;
+
+	if (ranges[range].nextPhysical != invalidRange)
+	{
+		ranges[ranges[range].nextPhysical].previousPhysical = rest;
+	}
+
+	ranges[range].nextPhysical = rest;
+	ranges[range].size = size;
+
+	return rest;
+}
+
+uint32_t MemoryRangeAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	size = alignUp((std::max)(size, VkDeviceSize(1)), minimumAlignment);
+	alignment = (std::max)(alignment, minimumAlignment);
+
+	/*A range found for a larger alignment may start anywhere, so it has to hold the worst padding as well*/
+	const uint32_t range = findFree(size + (alignment - minimumAlignment));
+
+	if (range == invalidRange)
+	{
+		return invalidRange;
+	}
+
+	removeFree(range);
+
+	uint32_t allocated = range;
+	const VkDeviceSize padding = alignUp(ranges[range].offset, alignment) - ranges[range].offset;
+
+	/*The padding in front stays free for smaller resources*/
+	if (padding != 0)
+	{
+		allocated = splitRange(range, padding);
+		insertFree(range);
+	}
+
+	if (ranges[allocated].size - size >= minimumAlignment)
+	{
+		insertFree(splitRange(allocated, size));
+	}
+
+	ranges[allocated].free = false;
+	freeBytes -= ranges[allocated].size;
+	allocationCount++;
+
+	offset = ranges[allocated].offset;
+	return allocated;
+}
+
+void MemoryRangeAllocator::free(uint32_t range)
+{
+	freeBytes += ranges[range].size;
+	allocationCount--;
+
+	const uint32_t next = ranges[range].nextPhysical;
+
+	if ((next != invalidRange) && ranges[next].free)
+	{
+		removeFree(next);
+
+		ranges[range].size += ranges[next].size;
+		ranges[range].nextPhysical = ranges[next].nextPhysical;
+
+		if (ranges[next].nextPhysical != invalidRange)
+		{
+			ranges[ranges[next].nextPhysical].previousPhysical = range;
+		}
+
+		unusedRanges.push_back(next);
+	}
+
+	const uint32_t previous = ranges[range].previousPhysical;
+
+	if ((previous != invalidRange) && ranges[previous].free)
+	{
+		removeFree(previous);
+
+		ranges[previous].size += ranges[range].size;
+		ranges[previous].nextPhysical = ranges[range].nextPhysical;
+
+		if (ranges[range].nextPhysical != invalidRange)
+		{
+			ranges[ranges[range].nextPhysical].previousPhysical = previous;
+		}
+
+		unusedRanges.push_back(range);
+		range = previous;
+	}
+
+	insertFree(range);
+}
+
+size_t MemoryRangeAllocator::countFreeRanges(VkDeviceSize& largestFreeRange) const
+{
+	size_t count = 0;
+	largestFreeRange = 0;
+
+	for (uint32_t range = ranges.empty() ? invalidRange : 0; range != invalidRange; range = ranges[range].nextPhysical)
+	{
+		if (ranges[range].free)
+		{
+			largestFreeRange = (std::max)(largestFreeRange, ranges[range].size);
+			count++;
+		}
+	}
+
+	return count;
+}
+
+DeviceMemoryAllocator::DeviceMemoryAllocator()
+{
+}
+
+void DeviceMemoryAllocator::initialize(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize memoryBlockSize)
+{
+	device = logicalDevice;
+	blockSize = memoryBlockSize;
+
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	/*Ranges start and end on multiples of the minimum alignment, so a granularity up to it can never put a buffer and an image on one page*/
+	separateKinds = properties.limits.bufferImageGranularity > MemoryRangeAllocator::minimumAlignment;
+}
+
+uint32_t DeviceMemoryAllocator::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++)
+	{
+		if ((typeFilter & (1 << i)) && (memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+VkDeviceMemory DeviceMemoryAllocator::allocateMemory(uint32_t memoryType, VkDeviceSize size, void*& mapped)
+{
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryType;
+
+	VkDeviceMemory memory;
+
+	if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to allocate device memory!");
+	}
+
+	totalAllocateCalls++;
+	mapped = nullptr;
+
+	if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+		{
+			vkFreeMemory(device, memory, nullptr);
+			throw std::runtime_error("Failed to map device memory!");
+		}
+	}
+
+	return memory;
+}
+
+DeviceMemoryAllocator::MemoryPool& DeviceMemoryAllocator::findPool(uint32_t memoryType, DeviceResourceKind kind, uint32_t& poolIndex)
+{
+	if (!separateKinds)
+	{
+		kind = DeviceResourceKind::Buffer;
+	}
+
+	for (poolIndex = 0; poolIndex < pools.size(); poolIndex++)
+	{
+		if ((pools[poolIndex].memoryType == memoryType) && (pools[poolIndex].kind == kind))
+		{
+			return pools[poolIndex];
+		}
+	}
+
+	MemoryPool pool;
+	pool.memoryType = memoryType;
+	pool.kind = kind;
+	pools.push_back(std::move(pool));
+
+	return pools.back();
+}
+
+DeviceAllocation DeviceMemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, DeviceResourceKind kind)
+{
+	const uint32_t memoryType = findMemoryType(requirements.memoryTypeBits, properties);
+
+	DeviceAllocation allocation;
+	allocation.size = requirements.size;
+
+	uint32_t poolIndex;
+	MemoryPool& pool = findPool(memoryType, kind, poolIndex);
+	allocation.pool = poolIndex;
+
+	totalAllocations++;
+
+	/*A resource this large would leave most of a block to a few small ones, it is cheaper to give it its own memory*/
+	if (requirements.size > blockSize / 2)
+	{
+		allocation.memory = allocateMemory(memoryType, requirements.size, allocation.mapped);
+		dedicatedCount++;
+		dedicatedBytes += requirements.size;
+
+		return allocation;
+	}
+
+	for (uint32_t block = 0; block < pool.blocks.size(); block++)
+	{
+		MemoryBlock& memoryBlock = pool.blocks[block];
+
+		if (memoryBlock.memory == VK_NULL_HANDLE)
+		{
+			continue;
+		}
+
+		allocation.range = memoryBlock.ranges.allocate(requirements.size, requirements.alignment, allocation.offset);
+
+		if (allocation.range != MemoryRangeAllocator::invalidRange)
+		{
+			allocation.memory = memoryBlock.memory;
+			allocation.block = block;
+			allocation.mapped = memoryBlock.mapped ? static_cast<char*>(memoryBlock.mapped) + allocation.offset : nullptr;
+
+			return allocation;
+		}
+	}
+
+	/*No block has room left, a released slot is reused before the list grows*/
+	uint32_t block = 0;
+
+	while ((block < pool.blocks.size()) && (pool.blocks[block].memory != VK_NULL_HANDLE))
+	{
+		block++;
+	}
+
+	void* mapped;
+	const VkDeviceMemory memory = allocateMemory(memoryType, blockSize, mapped);
+	const MemoryBlock memoryBlock = { memory, mapped, MemoryRangeAllocator(blockSize) };
+
+	if (block == pool.blocks.size())
+	{
+		pool.blocks.push_back(memoryBlock);
+	}
+	else
+	{
+		pool.blocks[block] = memoryBlock;
+	}
+
+	allocation.range = pool.blocks[block].ranges.allocate(requirements.size, requirements.alignment, allocation.offset);
+	allocation.memory = memory;
+	allocation.block = block;
+	allocation.mapped = mapped ? static_cast<char*>(mapped) + allocation.offset : nullptr;
+
+	return allocation;
+}
+
+void DeviceMemoryAllocator::free(DeviceAllocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	if (allocation.range == MemoryRangeAllocator::invalidRange)
+	{
+		/*Freeing the memory unmaps it as well*/
+		vkFreeMemory(device, allocation.memory, nullptr);
+		dedicatedCount--;
+		dedicatedBytes -= allocation.size;
+	}
+	else
+	{
+		MemoryPool& pool = pools[allocation.pool];
+		MemoryBlock& memoryBlock = pool.blocks[allocation.block];
+		memoryBlock.ranges.free(allocation.range);
+
+		/*An empty block is kept while it is the only one, so a pool which is emptied and filled again does not allocate every time*/
+		if (memoryBlock.ranges.getAllocationCount() == 0)
+		{
+			const bool otherBlockAlive = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&memoryBlock](const MemoryBlock& block)
+			{
+				return (&block != &memoryBlock) && (block.memory != VK_NULL_HANDLE);
+			});
+
+			if (otherBlockAlive)
+			{
+				vkFreeMemory(device, memoryBlock.memory, nullptr);
+				memoryBlock.memory = VK_NULL_HANDLE;
+				memoryBlock.mapped = nullptr;
+			}
+		}
+	}
+
+	allocation = DeviceAllocation();
+}
+
+void DeviceMemoryAllocator::destroy()
+{
+	for (MemoryPool& pool : pools)
+	{
+		for (MemoryBlock& memoryBlock : pool.blocks)
+		{
+			if (memoryBlock.memory != VK_NULL_HANDLE)
+			{
+				vkFreeMemory(device, memoryBlock.memory, nullptr);
+			}
+		}
+	}
+
+	pools.clear();
+}
+
+DeviceMemoryStatistics DeviceMemoryAllocator::getStatistics() const
+{
+	DeviceMemoryStatistics statistics;
+	statistics.blockCount = dedicatedCount;
+	statistics.dedicatedCount = dedicatedCount;
+	statistics.allocationCount = dedicatedCount;
+	statistics.totalAllocateCalls = totalAllocateCalls;
+	statistics.totalAllocations = totalAllocations;
+	statistics.reservedBytes = dedicatedBytes;
+	statistics.usedBytes = dedicatedBytes;
+
+	for (const MemoryPool& pool : pools)
+	{
+		for (const MemoryBlock& memoryBlock : pool.blocks)
+		{
+			if (memoryBlock.memory == VK_NULL_HANDLE)
+			{
+				continue;
+			}
+
+			statistics.blockCount++;
+			statistics.allocationCount += memoryBlock.ranges.getAllocationCount();
+			statistics.reservedBytes += memoryBlock.ranges.getCapacity();
+			statistics.usedBytes += memoryBlock.ranges.getCapacity() - memoryBlock.ranges.getFreeBytes();
+			VkDeviceSize largestFreeRange;
+			statistics.freeRangeCount += memoryBlock.ranges.countFreeRanges(largestFreeRange);
+			statistics.largestFreeRange = (std::max)(statistics.largestFreeRange, largestFreeRange);
+			statistics.largestFreeRangeSum += largestFreeRange;
+		}
+	}
+
+	return statistics;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw3.h>
+
+#include <vector>
+#include <stdint.h>
+
+/*
+	Sub-allocation of Vulkan device memory.
+
+	Every memory type gets a list of large blocks, each a single vkAllocateMemory, and resources are
+	placed inside them with a two-level segregated fit (TLSF) allocator. Finding and returning a range
+	takes constant time, and neighbouring free ranges are merged as soon as they are returned. Buffers
+	and images go into separate blocks whenever the bufferImageGranularity of the device is larger than
+	the range alignment, so a linear and an optimal resource never share a page. Host visible blocks are mapped once for their whole
+	lifetime, as a memory object cannot be mapped twice.
+*/
+
+/*A range of a memory object which is free or in use, with constant time search and merging*/
+class MemoryRangeAllocator
+{
+
+private:
+
+	struct Range
+	{
+		VkDeviceSize offset;
+		VkDeviceSize size;
+		uint32_t previousPhysical; // The ranges before and after this one in the memory
+		uint32_t nextPhysical;
+		uint32_t previousFree; // The neighbours in the free list of its size class
+		uint32_t nextFree;
+		bool free;
+	};
+
+	/*Eight size classes per power of two, which wastes at most an eighth of a range on rounding*/
+	static const unsigned int secondLevelBits = 3;
+	static const unsigned int secondLevelCount = 1u << secondLevelBits;
+
+	std::vector<Range> ranges;
+	std::vector<uint32_t> unusedRanges; // Entries of ranges which were merged away, reused before ranges grows
+
+	uint64_t firstLevelBitmap = 0; // Bit f is set if any list of the power of two f holds a free range
+	uint32_t secondLevelBitmaps[64] = {}; // Bit s of entry f is set if the list f, s holds a free range
+	uint32_t freeLists[64][secondLevelCount]; // First free range of every size class
+
+	VkDeviceSize capacity = 0;
+	VkDeviceSize freeBytes = 0;
+	size_t allocationCount = 0;
+
+	uint32_t newRange();
+	void insertFree(uint32_t range);
+	void removeFree(uint32_t range);
+	uint32_t findFree(VkDeviceSize size) const;
+
+	/*Turns the first size bytes of a free range into a range of their own, returns the rest*/
+	uint32_t splitRange(uint32_t range, VkDeviceSize size);
+
+public:
+
+	static const uint32_t invalidRange = 0xFFFFFFFFu;
+
+	/*Offsets and sizes are multiples of this, so smaller alignments never need any padding*/
+	static const VkDeviceSize minimumAlignment = 256;
+
+	explicit MemoryRangeAllocator(VkDeviceSize size);
+
+	/*Finds a range of at least size bytes at a multiple of alignment, which has to be a power of two. Returns invalidRange if none is left*/
+	uint32_t allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+	/*Returns a range from allocate, merging it with the free ranges around it*/
+	void free(uint32_t range);
+
+	VkDeviceSize getCapacity() const { return capacity; };
+	VkDeviceSize getFreeBytes() const { return freeBytes; };
+	size_t getAllocationCount() const { return allocationCount; };
+
+	/*Walks all free ranges for the statistics, largestFreeRange is set to the largest of them*/
+	size_t countFreeRanges(VkDeviceSize& largestFreeRange) const;
+};
+
+/*A part of a memory block a resource is bound to*/
+struct DeviceAllocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	void* mapped = nullptr; // Points at offset inside the persistent mapping of a host visible block, null otherwise
+
+	uint32_t pool = 0; // Where the range came from, for returning it
+	uint32_t block = 0;
+	uint32_t range = MemoryRangeAllocator::invalidRange; // invalidRange for a dedicated allocation
+};
+
+/*Resources bound to an allocation*/
+enum class DeviceResourceKind
+{
+	Buffer, // Linear
+	Image // Optimal tiling
+};
+
+/*How well the blocks are used, over all memory types*/
+struct DeviceMemoryStatistics
+{
+	size_t blockCount = 0; // vkAllocateMemory calls currently alive, dedicated ones included
+	size_t dedicatedCount = 0; // Resources too large to share a block
+	size_t allocationCount = 0; // Resources currently placed in memory
+	size_t totalAllocateCalls = 0; // vkAllocateMemory calls over the lifetime of the allocator
+	size_t totalAllocations = 0; // allocate calls over the lifetime of the allocator, the difference to totalAllocateCalls is what sub-allocation saved
+	VkDeviceSize reservedBytes = 0; // Size of all blocks
+	VkDeviceSize usedBytes = 0; // Part of reservedBytes resources are placed in, including their alignment padding
+	size_t freeRangeCount = 0;
+	VkDeviceSize largestFreeRange = 0; // Largest free range of any single block
+	VkDeviceSize largestFreeRangeSum = 0; // The largest free range of every block added up
+
+	/*0 if every block has its free memory in one range, close to 1 if it is spread over many small ones*/
+	double fragmentation() const
+	{
+		const VkDeviceSize freeBytes = reservedBytes - usedBytes;
+		return (freeBytes == 0) ? 0.0 : 1.0 - static_cast<double>(largestFreeRangeSum) / static_cast<double>(freeBytes);
+	}
+};
+
+/*Places buffers and images in shared blocks of device memory*/
+class DeviceMemoryAllocator
+{
+
+private:
+
+	struct MemoryBlock
+	{
+		VkDeviceMemory memory;
+		void* mapped; // The whole block, if it is host visible
+		MemoryRangeAllocator ranges;
+	};
+
+	/*The blocks of one memory type and resource kind*/
+	struct MemoryPool
+	{
+		uint32_t memoryType;
+		DeviceResourceKind kind;
+		std::vector<MemoryBlock> blocks; // Blocks whose memory is null were freed and can be reused
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDeviceMemoryProperties memoryProperties = {};
+	VkDeviceSize blockSize = 0;
+	bool separateKinds = false; // Set if bufferImageGranularity asks for buffers and images to be kept apart
+
+	std::vector<MemoryPool> pools;
+	size_t dedicatedCount = 0;
+	VkDeviceSize dedicatedBytes = 0;
+	size_t totalAllocateCalls = 0;
+	size_t totalAllocations = 0;
+
+	/*Picks the first memory type in typeFilter which has all the properties*/
+	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+	/*Allocates device memory and maps it if the type is host visible*/
+	VkDeviceMemory allocateMemory(uint32_t memoryType, VkDeviceSize size, void*& mapped);
+
+	MemoryPool& findPool(uint32_t memoryType, DeviceResourceKind kind, uint32_t& poolIndex);
+
+	DeviceMemoryAllocator(const DeviceMemoryAllocator&) = delete;
+	DeviceMemoryAllocator& operator = (const DeviceMemoryAllocator&) = delete;
+
+public:
+
+	DeviceMemoryAllocator();
+
+	/*Resources larger than half a block get a memory object of their own*/
+	void initialize(VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VkDeviceSize memoryBlockSize = 64 * 1024 * 1024);
+
+	/*Finds memory for a resource with the requirements Vulkan reported for it. Throws if no memory type fits or the device is out of memory*/
+	DeviceAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, DeviceResourceKind kind);
+
+	/*Returns the memory of a resource which was destroyed, empty blocks are released except for the last one of every pool*/
+	void free(DeviceAllocation& allocation);
+
+	/*Releases every block, all resources have to be destroyed before*/
+	void destroy();
+
+	DeviceMemoryStatistics getStatistics() const;
+};
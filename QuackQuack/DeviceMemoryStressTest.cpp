@@ -0,0 +1,253 @@
+#include "DeviceMemoryStressTest.h"
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <random>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <stdint.h>
+
+#include "DeviceMemoryAllocator.h"
+
+/*A resource the test keeps alive, with the pattern written into its memory*/
+struct StressResource
+{
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkImage image = VK_NULL_HANDLE;
+	DeviceAllocation allocation;
+	uint8_t pattern = 0;
+};
+
+/*Where a resource lies in its memory, the key of the map is the offset*/
+struct PlacedRange
+{
+	VkDeviceSize end;
+	bool optimal;
+};
+
+static void createStressBuffer(VkDevice device, std::mt19937& random, DeviceMemoryAllocator& allocator, StressResource& resource)
+{
+	/*Mostly small buffers, with the odd one past half a block so the dedicated path runs too*/
+	const VkDeviceSize size = (random() % 64 == 0) ? (VkDeviceSize(1) << 20) * (3 + random() % 4) : 1 + random() % (256 * 1024);
+	const bool hostVisible = (random() % 2) == 0;
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = size;
+	bufferInfo.usage = (random() % 2 == 0) ? (VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT) : (VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &resource.buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a stress test buffer!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, resource.buffer, &memRequirements);
+
+	const VkMemoryPropertyFlags properties = hostVisible ? (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	resource.allocation = allocator.allocate(memRequirements, properties, DeviceResourceKind::Buffer);
+
+	if (resource.allocation.offset % memRequirements.alignment != 0)
+	{
+		throw std::runtime_error("A buffer was placed at an offset it cannot be bound to!");
+	}
+
+	vkBindBufferMemory(device, resource.buffer, resource.allocation.memory, resource.allocation.offset);
+}
+
+static void createStressImage(VkDevice device, std::mt19937& random, DeviceMemoryAllocator& allocator, StressResource& resource)
+{
+	VkImageCreateInfo imageInfo = {};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = 1u << (2 + random() % 9);
+	imageInfo.extent.height = 1u << (2 + random() % 9);
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a stress test image!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetImageMemoryRequirements(device, resource.image, &memRequirements);
+
+	resource.allocation = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, DeviceResourceKind::Image);
+
+	if (resource.allocation.offset % memRequirements.alignment != 0)
+	{
+		throw std::runtime_error("An image was placed at an offset it cannot be bound to!");
+	}
+
+	vkBindImageMemory(device, resource.image, resource.allocation.memory, resource.allocation.offset);
+}
+
+/*Checks a new resource against every other one in the same memory, including the page rule between linear and optimal ones*/
+static void checkPlacement(std::map<VkDeviceMemory, std::map<VkDeviceSize, PlacedRange>>& placedRanges, const DeviceAllocation& allocation, bool optimal, VkDeviceSize granularity)
+{
+	std::map<VkDeviceSize, PlacedRange>& ranges = placedRanges[allocation.memory];
+	const VkDeviceSize start = allocation.offset;
+	const VkDeviceSize end = allocation.offset + allocation.size;
+
+	const auto next = ranges.lower_bound(start);
+
+	if ((next != ranges.end()) && (next->first < end))
+	{
+		throw std::runtime_error("Two resources were placed over each other!");
+	}
+
+	if ((next != ranges.end()) && (next->second.optimal != optimal) && ((end - 1) / granularity == next->first / granularity))
+	{
+		throw std::runtime_error("A buffer and an image share a page of the bufferImageGranularity!");
+	}
+
+	if (next != ranges.begin())
+	{
+		const auto previous = std::prev(next);
+
+		if (previous->second.end > start)
+		{
+			throw std::runtime_error("Two resources were placed over each other!");
+		}
+
+		if ((previous->second.optimal != optimal) && ((previous->second.end - 1) / granularity == start / granularity))
+		{
+			throw std::runtime_error("A buffer and an image share a page of the bufferImageGranularity!");
+		}
+	}
+
+	ranges[start] = { end, optimal };
+}
+
+static void printStatistics(const std::string& label, const DeviceMemoryStatistics& statistics)
+{
+	std::cout << label << ": " << statistics.allocationCount << " resources in " << statistics.blockCount << " memory objects ("
+		<< statistics.dedicatedCount << " dedicated), " << (statistics.usedBytes >> 10) << " of " << (statistics.reservedBytes >> 10) << " KiB used, "
+		<< statistics.freeRangeCount << " free ranges, largest " << (statistics.largestFreeRange >> 10) << " KiB, fragmentation " << statistics.fragmentation()
+		<< ", " << statistics.totalAllocations << " allocations served by " << statistics.totalAllocateCalls << " vkAllocateMemory calls" << std::endl;
+}
+
+void stressTestDeviceMemory(VkPhysicalDevice physicalDevice, VkDevice device, size_t operationCount)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	std::cout << "Device memory stress test on " << properties.deviceName << ", bufferImageGranularity " << properties.limits.bufferImageGranularity << std::endl;
+
+	/*Small blocks, so the test keeps opening and releasing them*/
+	DeviceMemoryAllocator allocator;
+	allocator.initialize(physicalDevice, device, 8 * 1024 * 1024);
+
+	std::mt19937 random(20181017);
+	std::vector<StressResource> resources;
+	std::map<VkDeviceMemory, std::map<VkDeviceSize, PlacedRange>> placedRanges;
+
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (size_t operation = 0; operation < operationCount; operation++)
+	{
+		/*The live set grows to a few hundred resources and then hovers there, which is where fragmentation builds up*/
+		const bool create = resources.empty() || (random() % 512 >= resources.size());
+
+		if (create)
+		{
+			StressResource resource;
+			const bool optimal = (random() % 4) == 0;
+
+			if (optimal)
+			{
+				createStressImage(device, random, allocator, resource);
+			}
+			else
+			{
+				createStressBuffer(device, random, allocator, resource);
+			}
+
+			checkPlacement(placedRanges, resource.allocation, optimal, properties.limits.bufferImageGranularity);
+
+			if (resource.allocation.mapped)
+			{
+				resource.pattern = static_cast<uint8_t>(random());
+				std::memset(resource.allocation.mapped, resource.pattern, static_cast<size_t>(resource.allocation.size));
+			}
+
+			resources.push_back(resource);
+		}
+		else
+		{
+			const size_t entry = random() % resources.size();
+			StressResource& resource = resources[entry];
+
+			/*Another resource writing over this one would have changed the pattern*/
+			if (resource.allocation.mapped)
+			{
+				const uint8_t* bytes = static_cast<const uint8_t*>(resource.allocation.mapped);
+
+				for (VkDeviceSize byte = 0; byte < resource.allocation.size; byte++)
+				{
+					if (bytes[byte] != resource.pattern)
+					{
+						throw std::runtime_error("The memory of a resource was overwritten by another one!");
+					}
+				}
+			}
+
+			placedRanges[resource.allocation.memory].erase(resource.allocation.offset);
+
+			if (resource.buffer != VK_NULL_HANDLE)
+			{
+				vkDestroyBuffer(device, resource.buffer, nullptr);
+			}
+			else
+			{
+				vkDestroyImage(device, resource.image, nullptr);
+			}
+
+			allocator.free(resource.allocation);
+
+			resources[entry] = resources.back();
+			resources.pop_back();
+		}
+
+		if ((operation + 1) % (operationCount / 4 + 1) == 0)
+		{
+			printStatistics("After " + std::to_string(operation + 1) + " operations", allocator.getStatistics());
+		}
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+
+	for (StressResource& resource : resources)
+	{
+		if (resource.buffer != VK_NULL_HANDLE)
+		{
+			vkDestroyBuffer(device, resource.buffer, nullptr);
+		}
+		else
+		{
+			vkDestroyImage(device, resource.image, nullptr);
+		}
+
+		allocator.free(resource.allocation);
+	}
+
+	printStatistics("After freeing everything", allocator.getStatistics());
+
+	std::cout << "Device memory stress test passed, " << operationCount << " operations in "
+		<< std::chrono::duration<double, std::chrono::milliseconds::period>(endTime - startTime).count() << " ms" << std::endl;
+
+	allocator.destroy();
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw3.h>
+
+#include <stddef.h>
+
+/*
+	A stress test of the device memory allocator, built into the renderer with QUACK_MEMORY_STRESS_TEST.
+
+	Real buffers and images of random sizes are created, placed, bound and destroyed in a random order, on
+	whatever device the renderer picked. A software driver such as lavapipe or SwiftShader runs it without
+	a GPU. Every placement is checked against the alignment Vulkan asked for, against the other resources
+	in its block and against the bufferImageGranularity of the device, and host visible ranges are filled
+	with a pattern which is verified before they are freed. Any violation throws.
+*/
+
+/*Runs operationCount random creations and destructions, then prints the allocator statistics*/
+void stressTestDeviceMemory(VkPhysicalDevice physicalDevice, VkDevice device, size_t operationCount = 20000);
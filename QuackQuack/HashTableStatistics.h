@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stddef.h>
+#include <algorithm>
+
+/*
+	How evenly the entries of a hash table are spread, used to check the cost of vertex deduplication.
+
+	The probe length of an entry is the amount of entries compared before it is found, so
+	a perfectly spread table has an average and maximum probe length of 1.
+*/
+struct HashTableStatistics
+{
+	size_t entryCount = 0; // Amount of entries stored
+	size_t bucketCount = 0; // Amount of buckets or slots of the table
+	size_t occupiedBucketCount = 0; // Buckets which at least one entry hashes to
+	size_t largestBucketSize = 0; // Most entries hashing to the same bucket
+	double averageProbeLength = 0.0; // Average amount of compares for a successful lookup
+	size_t maximumProbeLength = 0; // Most compares needed to find any entry
+};
+
+/*
+	Gathers the statistics of one of the standard unordered containers. Their buckets are chains,
+	so the k-th entry of a bucket is found after k compares.
+*/
+template<typename UnorderedContainer>
+HashTableStatistics collectBucketStatistics(const UnorderedContainer& container)
+{
+	HashTableStatistics statistics;
+	statistics.entryCount = container.size();
+	statistics.bucketCount = container.bucket_count();
+
+	double probeLengthSum = 0.0;
+
+	for (size_t bucket = 0; bucket < container.bucket_count(); bucket++)
+	{
+		const size_t bucketSize = container.bucket_size(bucket);
+
+		if (bucketSize != 0)
+		{
+			statistics.occupiedBucketCount++;
+			statistics.largestBucketSize = (std::max)(statistics.largestBucketSize, bucketSize);
+
+			/*1 + 2 + ... + bucketSize*/
+			probeLengthSum += bucketSize * (bucketSize + 1) / 2.0;
+		}
+	}
+
+	statistics.maximumProbeLength = statistics.largestBucketSize;
+	statistics.averageProbeLength = (statistics.entryCount != 0) ? probeLengthSum / statistics.entryCount : 0.0;
+
+	return statistics;
+}
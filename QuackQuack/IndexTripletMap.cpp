@@ -0,0 +1,159 @@
+#include "IndexTripletMap.h"
+
+/*The table is kept at most half full, which keeps the probe sequences short*/
+static const size_t maximumLoadNumerator = 1;
+static const size_t maximumLoadDenominator = 2;
+
+static const size_t minimumCapacity = 16;
+
+/*Smallest power of two which is at least value*/
+static size_t nextPowerOfTwo(size_t value)
+{
+	size_t powerOfTwo = minimumCapacity;
+
+	while (powerOfTwo < value)
+	{
+		powerOfTwo *= 2;
+	}
+
+	return powerOfTwo;
+}
+
+size_t IndexTripletMap::hashTriplet(const objVertexData& key)
+{
+	/*Every index gets multiplied by a different odd constant, then the high bits are folded into the low ones used for the slot*/
+	uint64_t hash = (static_cast<uint64_t>(key.v) * 0x9E3779B97F4A7C15ull) ^ (static_cast<uint64_t>(key.vt) * 0xC2B2AE3D27D4EB4Full) ^ (static_cast<uint64_t>(key.vn) * 0x165667B19E3779F9ull);
+
+	hash ^= hash >> 29;
+	hash *= 0xBF58476D1CE4E5B9ull;
+	hash ^= hash >> 32;
+
+	return static_cast<size_t>(hash);
+}
+
+void IndexTripletMap::grow()
+{
+	std::vector<Entry> oldEntries(entries.size() * 2, Entry{ 0, 0, 0, 0 });
+	oldEntries.swap(entries);
+
+	const size_t mask = entries.size() - 1;
+
+	for (const Entry& entry : oldEntries)
+	{
+		if (entry.v == 0)
+		{
+			continue;
+		}
+
+		size_t slot = hashTriplet(objVertexData(entry.v, entry.vt, entry.vn)) & mask;
+
+		while (entries[slot].v != 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+
+		entries[slot] = entry;
+	}
+}
+
+IndexTripletMap::IndexTripletMap() : entries(minimumCapacity, Entry{ 0, 0, 0, 0 }), entryCount(0)
+{
+}
+
+IndexTripletMap::IndexTripletMap(size_t expectedCount) : entries(nextPowerOfTwo(expectedCount * maximumLoadDenominator / maximumLoadNumerator), Entry{ 0, 0, 0, 0 }), entryCount(0)
+{
+}
+
+void IndexTripletMap::reserve(size_t expectedCount)
+{
+	while (expectedCount * maximumLoadDenominator > entries.size() * maximumLoadNumerator)
+	{
+		grow();
+	}
+}
+
+uint32_t IndexTripletMap::findOrInsert(const objVertexData& key, uint32_t newIndex, bool& inserted)
+{
+	/*Grow before inserting, so the table always has a free slot to stop the probing*/
+	if ((entryCount + 1) * maximumLoadDenominator > entries.size() * maximumLoadNumerator)
+	{
+		grow();
+	}
+
+	const size_t mask = entries.size() - 1;
+	size_t slot = hashTriplet(key) & mask;
+
+	while (true)
+	{
+		Entry& entry = entries[slot];
+
+		/*An empty slot ends the probe sequence, the key is not in the table*/
+		if (entry.v == 0)
+		{
+			entry.v = key.v;
+			entry.vt = key.vt;
+			entry.vn = key.vn;
+			entry.index = newIndex;
+
+			entryCount++;
+			inserted = true;
+
+			return newIndex;
+		}
+
+		if (entry.v == key.v && entry.vt == key.vt && entry.vn == key.vn)
+		{
+			inserted = false;
+
+			return entry.index;
+		}
+
+		slot = (slot + 1) & mask;
+	}
+}
+
+HashTableStatistics IndexTripletMap::collectStatistics() const
+{
+	HashTableStatistics statistics;
+	statistics.entryCount = entryCount;
+	statistics.bucketCount = entries.size();
+
+	const size_t mask = entries.size() - 1;
+
+	/*How many entries hash to every slot, regardless of where probing placed them*/
+	std::vector<uint32_t> homeSlotCounts(entries.size(), 0);
+
+	double probeLengthSum = 0.0;
+
+	for (size_t slot = 0; slot < entries.size(); slot++)
+	{
+		const Entry& entry = entries[slot];
+
+		if (entry.v == 0)
+		{
+			continue;
+		}
+
+		const size_t homeSlot = hashTriplet(objVertexData(entry.v, entry.vt, entry.vn)) & mask;
+		homeSlotCounts[homeSlot]++;
+
+		/*Linear probing walks from the home slot up to the slot of the entry, wrapping around at the end*/
+		const size_t probeLength = ((slot - homeSlot) & mask) + 1;
+
+		probeLengthSum += static_cast<double>(probeLength);
+		statistics.maximumProbeLength = (std::max)(statistics.maximumProbeLength, probeLength);
+	}
+
+	for (const uint32_t homeSlotCount : homeSlotCounts)
+	{
+		if (homeSlotCount != 0)
+		{
+			statistics.occupiedBucketCount++;
+			statistics.largestBucketSize = (std::max)(statistics.largestBucketSize, static_cast<size_t>(homeSlotCount));
+		}
+	}
+
+	statistics.averageProbeLength = (entryCount != 0) ? probeLengthSum / entryCount : 0.0;
+
+	return statistics;
+}
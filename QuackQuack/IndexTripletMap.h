@@ -0,0 +1,59 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "objVertexData.h"
+#include "HashTableStatistics.h"
+
+/*
+	Maps the v/vt/vn index triplet of a face corner to the index of the vertex created for it.
+
+	The entries are stored in one flat array and collisions are resolved by linear probing,
+	so a lookup hashes three integers and usually touches a single cache line.
+	A position index of 0 never occurs in a corner, which is why it marks an empty slot.
+*/
+class IndexTripletMap
+{
+
+private:
+
+	/*One slot of the table, 16 bytes so four of them share a cache line*/
+	struct Entry
+	{
+		uint32_t v;
+		uint32_t vt;
+		uint32_t vn;
+		uint32_t index;
+	};
+
+	std::vector<Entry> entries; // The slots, the amount is always a power of two
+	size_t entryCount; // Amount of occupied slots
+
+	/*Mixes the three indices so that neighbouring triplets end up in different slots*/
+	static size_t hashTriplet(const objVertexData& key);
+
+	/*Doubles the amount of slots and reinserts every entry*/
+	void grow();
+
+public:
+
+	IndexTripletMap();
+	explicit IndexTripletMap(size_t expectedCount);
+
+	/*Makes room for expectedCount entries without the table having to grow*/
+	void reserve(size_t expectedCount);
+
+	/*
+		Returns the index stored for the key. If the key is not present yet, newIndex is
+		stored for it and returned, and inserted is set to true.
+	*/
+	uint32_t findOrInsert(const objVertexData& key, uint32_t newIndex, bool& inserted);
+
+	/*Measures how far the entries had to move away from the slot they hash to*/
+	HashTableStatistics collectStatistics() const;
+
+	/*Getters*/
+	size_t size() const { return entryCount; };
+	size_t capacity() const { return entries.size(); };
+};
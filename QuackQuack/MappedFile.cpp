@@ -0,0 +1,92 @@
+#include "MappedFile.h"
+
+#define NOMINMAX
+#include <windows.h>
+
+/*
+	Opens the file and maps all of it as a single read-only view.
+	Any previously mapped file is released first.
+*/
+bool MappedFile::open(const std::string& path)
+{
+	close();
+
+	/*The sequential scan hint lets the cache manager read ahead aggressively, which suits a front to back parse*/
+	HANDLE file = CreateFile(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+
+	/*Empty files cannot be mapped, so there is nothing to view*/
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMapping(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	if (mapping == nullptr)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	/*Map the whole file, offset 0 and size 0 stand for "everything"*/
+	const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (view == nullptr)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+
+	fileHandle = file;
+	mappingHandle = mapping;
+	mappedData = static_cast<const char*>(view);
+	mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (mappedData != nullptr)
+	{
+		UnmapViewOfFile(mappedData);
+	}
+
+	if (mappingHandle != nullptr)
+	{
+		CloseHandle(mappingHandle);
+	}
+
+	if (fileHandle != nullptr)
+	{
+		CloseHandle(fileHandle);
+	}
+
+	fileHandle = nullptr;
+	mappingHandle = nullptr;
+	mappedData = nullptr;
+	mappedSize = 0;
+}
+
+MappedFile::MappedFile() : fileHandle(nullptr), mappingHandle(nullptr), mappedData(nullptr), mappedSize(0)
+{
+}
+
+MappedFile::MappedFile(const std::string& path) : fileHandle(nullptr), mappingHandle(nullptr), mappedData(nullptr), mappedSize(0)
+{
+	open(path);
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
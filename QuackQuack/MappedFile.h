@@ -0,0 +1,44 @@
+#pragma once
+
+#include <string>
+
+/*
+	A read-only view of an entire file, mapped into the address space of the process.
+
+	The operating system pages the file in on demand, so the contents can be scanned
+	in place without copying them into intermediate strings or stream buffers first.
+	The pointer returned by data() is only valid while the object is alive.
+*/
+class MappedFile
+{
+
+private:
+
+	void* fileHandle; // The handle of the file opened for reading
+	void* mappingHandle; // The file mapping object created from the file handle
+
+	const char* mappedData; // The first byte of the mapped view
+	size_t mappedSize; // The size of the file in bytes
+
+	/*Copying would result in the view being unmapped twice*/
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator = (const MappedFile&) = delete;
+
+public:
+
+	MappedFile();
+	MappedFile(const std::string& path);
+
+	/*Maps the file at path, returns false if the file could not be opened or is empty*/
+	bool open(const std::string& path);
+
+	/*Unmaps the view and closes all handles*/
+	void close();
+
+	/*Getters*/
+	bool isOpen() const { return mappedData != nullptr; };
+	const char* data() const { return mappedData; };
+	size_t size() const { return mappedSize; };
+
+	~MappedFile();
+};
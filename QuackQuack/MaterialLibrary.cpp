@@ -0,0 +1,98 @@
+#include "MaterialLibrary.h"
+
+#include <fstream>
+#include <sstream>
+
+/*The rest of the line without the whitespace around it, names may contain spaces*/
+static std::string trimmedRemainder(std::istringstream& line)
+{
+	std::string remainder;
+	std::getline(line, remainder);
+
+	const size_t first = remainder.find_first_not_of(" \t\r");
+	const size_t last = remainder.find_last_not_of(" \t\r");
+
+	return (first == std::string::npos) ? std::string() : remainder.substr(first, last - first + 1);
+}
+
+std::string resolveObjRelativePath(const std::string& objPath, const std::string& name)
+{
+	const bool absolute = (!name.empty() && (name[0] == '/' || name[0] == '\\')) || (name.size() > 1 && name[1] == ':');
+
+	if (absolute)
+	{
+		return name;
+	}
+
+	const size_t separator = objPath.find_last_of("/\\");
+
+	return (separator == std::string::npos) ? name : objPath.substr(0, separator + 1) + name;
+}
+
+bool readMaterialLibrary(const std::string& path, std::vector<std::string>& names, std::vector<Material>& materials)
+{
+	std::ifstream file(path);
+
+	if (!file.is_open())
+	{
+		return false;
+	}
+
+	std::string text;
+	std::string keyword;
+
+	/*Values before the first newmtl have no material to go to*/
+	Material* material = nullptr;
+
+	while (std::getline(file, text))
+	{
+		std::istringstream line(text);
+
+		if (!(line >> keyword) || keyword[0] == '#')
+		{
+			continue;
+		}
+
+		if (keyword == "newmtl")
+		{
+			names.push_back(trimmedRemainder(line));
+			materials.push_back(Material());
+			material = &materials.back();
+		}
+		else if (material == nullptr)
+		{
+			continue;
+		}
+		else if (keyword == "Ka")
+		{
+			line >> material->ambient.r >> material->ambient.g >> material->ambient.b;
+		}
+		else if (keyword == "Kd")
+		{
+			line >> material->diffuse.r >> material->diffuse.g >> material->diffuse.b;
+		}
+		else if (keyword == "Ks")
+		{
+			line >> material->specular.r >> material->specular.g >> material->specular.b;
+		}
+		else if (keyword == "Ns")
+		{
+			line >> material->specular.w;
+		}
+		else if (keyword == "d")
+		{
+			line >> material->diffuse.a;
+		}
+		else if (keyword == "Tr")
+		{
+			float transparency = 0.0f;
+
+			if (line >> transparency)
+			{
+				material->diffuse.a = 1.0f - transparency;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "MeshData.h"
+
+/*
+	Materials from the mtl files an obj file names with mtllib.
+
+	Only the values of the lighting model the renderer implements are read, Ka, Kd, Ks, Ns and
+	the dissolve d (or its inverse Tr). Everything else, the texture maps included, is skipped.
+*/
+
+/*Path of a file named inside an obj file, which is relative to the directory of the obj file unless it is absolute*/
+std::string resolveObjRelativePath(const std::string& objPath, const std::string& name);
+
+/*
+	Reads every newmtl of the mtl file, appending its name and values. Values the file does not
+	set keep the defaults of Material. Returns false if the file cannot be opened.
+*/
+bool readMaterialLibrary(const std::string& path, std::vector<std::string>& names, std::vector<Material>& materials);
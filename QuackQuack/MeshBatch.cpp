@@ -0,0 +1,91 @@
+#include "MeshBatch.h"
+
+#include <algorithm>
+#include <chrono>
+#include <future>
+
+#include "ThreadPool.h"
+#include "StartupTrace.h"
+
+MeshBatch importObjFiles(const std::vector<std::string>& paths, const OBJReaderOptions& options, size_t threadCount)
+{
+	const ScopedTraceZone traceZone("Import " + std::to_string(paths.size()) + " obj files", "assets");
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	MeshBatch batch;
+	batch.meshes.resize(paths.size());
+
+	/*The pool already keeps every thread busy, a pool inside each import would only compete with it*/
+	OBJReaderOptions fileOptions = options;
+	fileOptions.threadCount = 1;
+
+	if (fileOptions.readMode == OBJReadMode::Parallel)
+	{
+		fileOptions.readMode = OBJReadMode::MemoryMapped;
+	}
+
+	ThreadPool pool(threadCount);
+
+	{
+		std::vector<std::future<void>> results;
+		results.reserve(paths.size());
+
+		for (size_t entry = 0; entry < paths.size(); entry++)
+		{
+			results.push_back(pool.submit([&batch, &paths, &fileOptions, entry]()
+			{
+				OBJReaderClass reader(paths[entry], fileOptions);
+
+				BatchMesh& batchMesh = batch.meshes[entry];
+				batchMesh.path = paths[entry];
+				batchMesh.loadStatistics = reader.getLoadStatistics();
+				batchMesh.mesh = reader.takeMesh();
+				batchMesh.loaded = !batchMesh.mesh.indices.empty();
+			}));
+		}
+
+		/*get() rethrows the first exception raised by an import*/
+		for (std::future<void>& result : results)
+		{
+			result.get();
+		}
+	}
+
+	const auto packStartTime = std::chrono::high_resolution_clock::now();
+
+	/*The meshes are packed in the order of the paths, so the arena does not depend on which import finished first*/
+	size_t vertexCount = 0;
+	size_t indexCount = 0;
+
+	for (BatchMesh& batchMesh : batch.meshes)
+	{
+		batchMesh.baseVertex = static_cast<uint32_t>(vertexCount);
+		batchMesh.vertexCount = static_cast<uint32_t>(batchMesh.mesh.vertices.size());
+		batchMesh.firstIndex = static_cast<uint32_t>(indexCount);
+		batchMesh.indexCount = static_cast<uint32_t>(batchMesh.mesh.indices.size());
+
+		vertexCount += batchMesh.vertexCount;
+		indexCount += batchMesh.indexCount;
+	}
+
+	batch.vertices.resize(vertexCount);
+	batch.indices.resize(indexCount);
+
+	/*Every mesh copies into its own range, releasing its arrays as soon as they are in the arena*/
+	pool.parallelFor(batch.meshes.size(), [&batch](size_t entry)
+	{
+		BatchMesh& batchMesh = batch.meshes[entry];
+
+		std::copy(batchMesh.mesh.vertices.begin(), batchMesh.mesh.vertices.end(), batch.vertices.begin() + batchMesh.baseVertex);
+		std::copy(batchMesh.mesh.indices.begin(), batchMesh.mesh.indices.end(), batch.indices.begin() + batchMesh.firstIndex);
+
+		std::vector<Vertex>().swap(batchMesh.mesh.vertices);
+		std::vector<uint32_t>().swap(batchMesh.mesh.indices);
+	});
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	batch.packSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - packStartTime).count();
+	batch.importSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+
+	return batch;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+#include "MeshData.h"
+#include "OBJReaderClass.h"
+
+/*
+	Imports many obj files at once into one shared vertex and index arena.
+
+	Every file is read on a worker of a thread pool, with the same options and mesh cache as a single
+	import. Once all of them are done the meshes are packed one after another, so the arena can be
+	uploaded with one copy each and every mesh drawn from it through its base offsets.
+*/
+
+/*Where one mesh of a batch lies in the arena*/
+struct BatchMesh
+{
+	std::string path; // The obj file the mesh was read from
+	bool loaded = false; // False if the file could not be read, the mesh is then empty
+	uint32_t baseVertex = 0; // First vertex of the mesh, the indices are relative to it and have to be drawn with it as the vertex offset
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0; // First index of the mesh in the arena
+	uint32_t indexCount = 0;
+
+	/*Everything but the vertices and indices. The index offsets of the levels, submeshes and chunks are relative to firstIndex*/
+	MeshData mesh;
+
+	OBJLoadStatistics loadStatistics;
+};
+
+/*The packed result of a batch import*/
+struct MeshBatch
+{
+	std::vector<Vertex> vertices; // The vertices of every mesh one after another
+	std::vector<uint32_t> indices; // The indices of every mesh one after another, each relative to the base vertex of its mesh
+	std::vector<BatchMesh> meshes; // One entry per path, in the order of the paths
+	double importSeconds = 0.0; // Wall time of the whole import
+	double packSeconds = 0.0; // Part of importSeconds spent copying the meshes into the arena
+};
+
+/*
+	Reads every obj file of paths and packs the meshes into one arena. A thread count of 0 uses every hardware thread.
+	The files themselves are read by a single thread each, so the Parallel read mode is replaced by the MemoryMapped one,
+	which gives the same mesh. Every entry is read on its own, a path listed twice is packed twice.
+*/
+MeshBatch importObjFiles(const std::vector<std::string>& paths, const OBJReaderOptions& options, size_t threadCount = 0);
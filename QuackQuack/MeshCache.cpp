@@ -0,0 +1,566 @@
+#include "MeshCache.h"
+#include "MappedFile.h"
+
+#include <cstring>
+
+#define NOMINMAX
+#include <windows.h>
+
+/*Increase whenever the layout of the file or the meaning of its contents changes*/
+static const uint32_t meshCacheVersion = 8;
+
+static const char meshCacheMagic[4] = { 'Q', 'M', 'S', 'H' };
+
+/*The arrays of MeshData stored in the cache, in file order*/
+enum MeshCacheArray
+{
+	VerticesArray,
+	IndicesArray,
+	LodsArray,
+	MeshletVertexOffsetsArray,
+	MeshletTriangleOffsetsArray,
+	MeshletVertexCountsArray,
+	MeshletTriangleCountsArray,
+	MeshletBoundingSpheresArray,
+	MeshletNormalConesArray,
+	MeshletVerticesArray,
+	MeshletTrianglesArray,
+	ChunkIndexOffsetsArray,
+	ChunkIndexCountsArray,
+	ChunkMinimumXArray,
+	ChunkMinimumYArray,
+	ChunkMinimumZArray,
+	ChunkMaximumXArray,
+	ChunkMaximumYArray,
+	ChunkMaximumZArray,
+	ChunkMaterialsArray,
+	SubmeshesArray,
+	MaterialsArray,
+	MaterialNamesArray,
+	MaterialLibrariesArray,
+	MaterialLibraryKeysArray,
+	ObjectsArray,
+	ObjectNamesArray,
+	MeshCacheArrayCount
+};
+
+/*Identifies an mtl file the materials were read from, the cache is rebuilt if one of them changes*/
+struct MaterialLibraryKey
+{
+	uint64_t size;
+	uint64_t writeTime; // 0 if the file did not exist, no existing file has that write time
+	uint64_t hash; // Content hash, checked when only the write time changed
+};
+
+/*Where one array lies in the file*/
+struct MeshCacheArrayLocation
+{
+	uint64_t offset;
+	uint64_t count;
+	uint32_t elementSize; // sizeof the element when the file was written, guards against layout changes
+	uint32_t reserved; // Keeps the locations 8 byte aligned
+};
+
+/*The start of every cache file, followed by the arrays at the given offsets*/
+struct MeshCacheHeader
+{
+	char magic[4];
+	uint32_t version;
+
+	uint64_t sourceSize;
+	uint64_t sourceWriteTime;
+	uint64_t sourceHash; // Content hash of the obj file, checked when only the write time changed
+	uint64_t settings;
+
+	MeshCacheArrayLocation arrays[MeshCacheArrayCount];
+};
+
+/*Pointer, size and element size of an array to be written*/
+struct MeshCacheArrayData
+{
+	const void* data;
+	uint64_t count;
+	uint32_t elementSize;
+};
+
+template<typename T>
+static MeshCacheArrayData arrayData(const std::vector<T>& array)
+{
+	const MeshCacheArrayData data = { array.data(), array.size(), sizeof(T) };
+	return data;
+}
+
+/*Copies one array out of the mapped cache, the location has to be validated already*/
+template<typename T>
+static void readArray(const MappedFile& cache, const MeshCacheArrayLocation& location, std::vector<T>& array)
+{
+	const T* first = reinterpret_cast<const T*>(cache.data() + location.offset);
+	array.assign(first, first + location.count);
+}
+
+/*Stores the strings one after another, each followed by a zero*/
+static std::vector<char> joinStrings(const std::vector<std::string>& strings)
+{
+	std::vector<char> joined;
+
+	for (const std::string& string : strings)
+	{
+		joined.insert(joined.end(), string.begin(), string.end());
+		joined.push_back('\0');
+	}
+
+	return joined;
+}
+
+/*Splits the strings stored by joinStrings, returns false if the last one is not terminated*/
+static bool splitStrings(const std::vector<char>& joined, std::vector<std::string>& strings)
+{
+	if (!joined.empty() && joined.back() != '\0')
+	{
+		return false;
+	}
+
+	for (size_t start = 0; start < joined.size(); start += strings.back().size() + 1)
+	{
+		strings.push_back(std::string(joined.data() + start));
+	}
+
+	return true;
+}
+
+/*The arrays start on 16 byte boundaries*/
+static uint64_t alignOffset(uint64_t offset)
+{
+	return (offset + 15) & ~static_cast<uint64_t>(15);
+}
+
+/*Hashes the file eight bytes at a time, returns false if it cannot be mapped*/
+static bool hashFile(const std::string& path, uint64_t& hash)
+{
+	MappedFile file(path);
+
+	if (!file.isOpen())
+	{
+		return false;
+	}
+
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(file.data());
+	const size_t size = file.size();
+
+	hash = 0xCBF29CE484222325ull ^ size;
+
+	size_t offset = 0;
+
+	for (; offset + 8 <= size; offset += 8)
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + offset, sizeof(word));
+
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 32;
+	}
+
+	/*The remaining bytes are folded in one at a time*/
+	for (; offset < size; offset++)
+	{
+		hash = (hash ^ bytes[offset]) * 0x100000001B3ull;
+	}
+
+	return true;
+}
+
+/*Size and write time of a file, returns false if it does not exist*/
+static bool fileAttributes(const std::string& path, uint64_t& size, uint64_t& writeTime)
+{
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+	if (!GetFileAttributesEx(path.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		return false;
+	}
+
+	size = (static_cast<uint64_t>(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+	writeTime = (static_cast<uint64_t>(attributes.ftLastWriteTime.dwHighDateTime) << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+
+	return true;
+}
+
+/*True if the mtl file still has the contents it had when the cache was written*/
+static bool materialLibraryUnchanged(const std::string& path, const MaterialLibraryKey& key)
+{
+	uint64_t size = 0;
+	uint64_t writeTime = 0;
+
+	/*A library which was missing stays unchanged only while it is still missing*/
+	if (!fileAttributes(path, size, writeTime))
+	{
+		return key.writeTime == 0;
+	}
+
+	if (key.writeTime == 0 || size != key.size)
+	{
+		return false;
+	}
+
+	uint64_t hash = 0;
+
+	return writeTime == key.writeTime || (hashFile(path, hash) && hash == key.hash);
+}
+
+/*Writes all bytes, WriteFile takes at most 4GB per call*/
+static bool writeAll(HANDLE file, const void* data, uint64_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+
+	while (size > 0)
+	{
+		const DWORD bytesToWrite = static_cast<DWORD>((std::min)(size, static_cast<uint64_t>(1 << 30)));
+		DWORD bytesWritten = 0;
+
+		if (!WriteFile(file, bytes, bytesToWrite, &bytesWritten, nullptr) || bytesWritten != bytesToWrite)
+		{
+			return false;
+		}
+
+		bytes += bytesWritten;
+		size -= bytesWritten;
+	}
+
+	return true;
+}
+
+/*Checks that every index, range and local index stays inside the arrays it refers to*/
+static bool validateMesh(const MeshData& mesh)
+{
+	for (const uint32_t index : mesh.indices)
+	{
+		if (index >= mesh.vertices.size())
+		{
+			return false;
+		}
+	}
+
+	/*Every detail level has to be a range of whole triangles inside the indices*/
+	for (const MeshLod& lod : mesh.lods)
+	{
+		if ((lod.indexCount % 3) != 0 || lod.indexOffset > mesh.indices.size() || lod.indexCount > mesh.indices.size() - lod.indexOffset)
+		{
+			return false;
+		}
+
+		if (lod.firstChunk > mesh.chunks.size() || lod.chunkCount > mesh.chunks.size() - lod.firstChunk)
+		{
+			return false;
+		}
+
+		if (lod.firstSubmesh > mesh.submeshes.size() || lod.submeshCount > mesh.submeshes.size() - lod.firstSubmesh)
+		{
+			return false;
+		}
+	}
+
+	/*Every submesh is a range of whole triangles with an object and a material from the tables*/
+	if (mesh.materialNames.size() != mesh.materials.size() || mesh.objectNames.size() != mesh.objects.size())
+	{
+		return false;
+	}
+
+	for (const Submesh& submesh : mesh.submeshes)
+	{
+		if ((submesh.indexCount % 3) != 0 || submesh.indexOffset > mesh.indices.size() || submesh.indexCount > mesh.indices.size() - submesh.indexOffset ||
+			submesh.material >= mesh.materials.size() || submesh.object >= mesh.objects.size())
+		{
+			return false;
+		}
+	}
+
+	const SpatialChunks& chunks = mesh.chunks;
+	const size_t chunkCount = chunks.indexOffsets.size();
+
+	if (chunks.indexCounts.size() != chunkCount || chunks.materials.size() != chunkCount || chunks.minimumX.size() != chunkCount || chunks.minimumY.size() != chunkCount ||
+		chunks.minimumZ.size() != chunkCount || chunks.maximumX.size() != chunkCount || chunks.maximumY.size() != chunkCount || chunks.maximumZ.size() != chunkCount)
+	{
+		return false;
+	}
+
+	for (size_t chunk = 0; chunk < chunkCount; chunk++)
+	{
+		if (chunks.indexOffsets[chunk] > mesh.indices.size() || chunks.indexCounts[chunk] > mesh.indices.size() - chunks.indexOffsets[chunk] ||
+			chunks.materials[chunk] >= mesh.materials.size())
+		{
+			return false;
+		}
+	}
+
+	const MeshletData& meshlets = mesh.meshlets;
+	const size_t meshletCount = meshlets.vertexOffsets.size();
+
+	if (meshlets.triangleOffsets.size() != meshletCount || meshlets.vertexCounts.size() != meshletCount || meshlets.triangleCounts.size() != meshletCount ||
+		meshlets.boundingSpheres.size() != meshletCount || meshlets.normalCones.size() != meshletCount || meshlets.triangles.size() > mesh.indices.size())
+	{
+		return false;
+	}
+
+	for (const uint32_t vertex : meshlets.vertices)
+	{
+		if (vertex >= mesh.vertices.size())
+		{
+			return false;
+		}
+	}
+
+	for (size_t meshlet = 0; meshlet < meshletCount; meshlet++)
+	{
+		const size_t vertexOffset = meshlets.vertexOffsets[meshlet];
+		const size_t triangleOffset = meshlets.triangleOffsets[meshlet];
+
+		if (vertexOffset + meshlets.vertexCounts[meshlet] > meshlets.vertices.size() || (triangleOffset + meshlets.triangleCounts[meshlet]) * 3 > meshlets.triangles.size())
+		{
+			return false;
+		}
+
+		for (size_t corner = triangleOffset * 3; corner < (triangleOffset + meshlets.triangleCounts[meshlet]) * 3; corner++)
+		{
+			if (meshlets.triangles[corner] >= meshlets.vertexCounts[meshlet])
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+std::string meshCachePath(const std::string& objPath)
+{
+	return objPath + ".meshcache";
+}
+
+bool makeMeshCacheKey(const std::string& objPath, uint64_t settings, MeshCacheKey& key)
+{
+	if (!fileAttributes(objPath, key.sourceSize, key.sourceWriteTime))
+	{
+		return false;
+	}
+
+	key.settings = settings;
+
+	return true;
+}
+
+bool readMeshCache(const std::string& objPath, const MeshCacheKey& key, MeshData& mesh)
+{
+	MappedFile cache(meshCachePath(objPath));
+
+	/*No cache has been written yet*/
+	if (!cache.isOpen() || cache.size() < sizeof(MeshCacheHeader))
+	{
+		return false;
+	}
+
+	MeshCacheHeader header;
+	std::memcpy(&header, cache.data(), sizeof(header));
+
+	if (std::memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 || header.version != meshCacheVersion)
+	{
+		return false;
+	}
+
+	if (header.sourceSize != key.sourceSize || header.settings != key.settings)
+	{
+		return false;
+	}
+
+	/*A different write time alone does not mean the contents changed, copying or checking out the file also touches it*/
+	if (header.sourceWriteTime != key.sourceWriteTime)
+	{
+		uint64_t sourceHash = 0;
+
+		if (!hashFile(objPath, sourceHash) || sourceHash != header.sourceHash)
+		{
+			return false;
+		}
+	}
+
+	const uint32_t elementSizes[MeshCacheArrayCount] =
+	{
+		sizeof(Vertex), sizeof(uint32_t), sizeof(MeshLod),
+		sizeof(uint32_t), sizeof(uint32_t), sizeof(uint8_t), sizeof(uint8_t), sizeof(glm::vec4), sizeof(glm::vec4), sizeof(uint32_t), sizeof(uint8_t),
+		sizeof(uint32_t), sizeof(uint32_t), sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(float), sizeof(uint32_t),
+		sizeof(Submesh), sizeof(Material), sizeof(char), sizeof(char), sizeof(MaterialLibraryKey),
+		sizeof(MeshObject), sizeof(char)
+	};
+
+	/*Every array has to lie completely inside the file, the counts are checked first so the products cannot overflow*/
+	const uint64_t cacheSize = cache.size();
+
+	for (unsigned int array = 0; array < MeshCacheArrayCount; array++)
+	{
+		const MeshCacheArrayLocation& location = header.arrays[array];
+
+		if (location.elementSize != elementSizes[array])
+		{
+			return false;
+		}
+
+		if (location.count > cacheSize / location.elementSize || location.offset > cacheSize - location.count * location.elementSize)
+		{
+			OutputDebugString("The mesh cache is damaged and will be rebuilt!");
+			return false;
+		}
+	}
+
+	MeshData cachedMesh;
+
+	readArray(cache, header.arrays[VerticesArray], cachedMesh.vertices);
+	readArray(cache, header.arrays[IndicesArray], cachedMesh.indices);
+	readArray(cache, header.arrays[LodsArray], cachedMesh.lods);
+	readArray(cache, header.arrays[MeshletVertexOffsetsArray], cachedMesh.meshlets.vertexOffsets);
+	readArray(cache, header.arrays[MeshletTriangleOffsetsArray], cachedMesh.meshlets.triangleOffsets);
+	readArray(cache, header.arrays[MeshletVertexCountsArray], cachedMesh.meshlets.vertexCounts);
+	readArray(cache, header.arrays[MeshletTriangleCountsArray], cachedMesh.meshlets.triangleCounts);
+	readArray(cache, header.arrays[MeshletBoundingSpheresArray], cachedMesh.meshlets.boundingSpheres);
+	readArray(cache, header.arrays[MeshletNormalConesArray], cachedMesh.meshlets.normalCones);
+	readArray(cache, header.arrays[MeshletVerticesArray], cachedMesh.meshlets.vertices);
+	readArray(cache, header.arrays[MeshletTrianglesArray], cachedMesh.meshlets.triangles);
+	readArray(cache, header.arrays[ChunkIndexOffsetsArray], cachedMesh.chunks.indexOffsets);
+	readArray(cache, header.arrays[ChunkIndexCountsArray], cachedMesh.chunks.indexCounts);
+	readArray(cache, header.arrays[ChunkMinimumXArray], cachedMesh.chunks.minimumX);
+	readArray(cache, header.arrays[ChunkMinimumYArray], cachedMesh.chunks.minimumY);
+	readArray(cache, header.arrays[ChunkMinimumZArray], cachedMesh.chunks.minimumZ);
+	readArray(cache, header.arrays[ChunkMaximumXArray], cachedMesh.chunks.maximumX);
+	readArray(cache, header.arrays[ChunkMaximumYArray], cachedMesh.chunks.maximumY);
+	readArray(cache, header.arrays[ChunkMaximumZArray], cachedMesh.chunks.maximumZ);
+	readArray(cache, header.arrays[ChunkMaterialsArray], cachedMesh.chunks.materials);
+	readArray(cache, header.arrays[SubmeshesArray], cachedMesh.submeshes);
+	readArray(cache, header.arrays[MaterialsArray], cachedMesh.materials);
+
+	std::vector<char> materialNames;
+	std::vector<char> materialLibraries;
+	std::vector<MaterialLibraryKey> materialLibraryKeys;
+	std::vector<char> objectNames;
+
+	readArray(cache, header.arrays[MaterialNamesArray], materialNames);
+	readArray(cache, header.arrays[MaterialLibrariesArray], materialLibraries);
+	readArray(cache, header.arrays[MaterialLibraryKeysArray], materialLibraryKeys);
+	readArray(cache, header.arrays[ObjectsArray], cachedMesh.objects);
+	readArray(cache, header.arrays[ObjectNamesArray], objectNames);
+
+	if (!splitStrings(materialNames, cachedMesh.materialNames) || !splitStrings(materialLibraries, cachedMesh.materialLibraries) ||
+		!splitStrings(objectNames, cachedMesh.objectNames) || cachedMesh.materialLibraries.size() != materialLibraryKeys.size() || !validateMesh(cachedMesh))
+	{
+		OutputDebugString("The mesh cache is damaged and will be rebuilt!");
+		return false;
+	}
+
+	/*The materials have to be read again if one of their files changed*/
+	for (size_t library = 0; library < materialLibraryKeys.size(); library++)
+	{
+		if (!materialLibraryUnchanged(cachedMesh.materialLibraries[library], materialLibraryKeys[library]))
+		{
+			return false;
+		}
+	}
+
+	mesh = std::move(cachedMesh);
+
+	return true;
+}
+
+bool writeMeshCache(const std::string& objPath, const MeshCacheKey& key, const MeshData& mesh)
+{
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+
+	std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+	header.version = meshCacheVersion;
+
+	header.sourceSize = key.sourceSize;
+	header.sourceWriteTime = key.sourceWriteTime;
+	header.settings = key.settings;
+
+	if (!hashFile(objPath, header.sourceHash))
+	{
+		return false;
+	}
+
+	/*Names are stored as zero terminated strings one after another*/
+	const std::vector<char> materialNames = joinStrings(mesh.materialNames);
+	const std::vector<char> materialLibraries = joinStrings(mesh.materialLibraries);
+	const std::vector<char> objectNames = joinStrings(mesh.objectNames);
+	std::vector<MaterialLibraryKey> materialLibraryKeys(mesh.materialLibraries.size());
+
+	for (size_t library = 0; library < mesh.materialLibraries.size(); library++)
+	{
+		MaterialLibraryKey& libraryKey = materialLibraryKeys[library];
+		libraryKey.size = 0;
+		libraryKey.writeTime = 0;
+		libraryKey.hash = 0;
+
+		/*A missing library keeps the zero key, its appearance counts as a change*/
+		if (fileAttributes(mesh.materialLibraries[library], libraryKey.size, libraryKey.writeTime) && !hashFile(mesh.materialLibraries[library], libraryKey.hash))
+		{
+			return false;
+		}
+	}
+
+	const MeshCacheArrayData arrays[MeshCacheArrayCount] =
+	{
+		arrayData(mesh.vertices), arrayData(mesh.indices), arrayData(mesh.lods),
+		arrayData(mesh.meshlets.vertexOffsets), arrayData(mesh.meshlets.triangleOffsets), arrayData(mesh.meshlets.vertexCounts), arrayData(mesh.meshlets.triangleCounts),
+		arrayData(mesh.meshlets.boundingSpheres), arrayData(mesh.meshlets.normalCones), arrayData(mesh.meshlets.vertices), arrayData(mesh.meshlets.triangles),
+		arrayData(mesh.chunks.indexOffsets), arrayData(mesh.chunks.indexCounts), arrayData(mesh.chunks.minimumX), arrayData(mesh.chunks.minimumY),
+		arrayData(mesh.chunks.minimumZ), arrayData(mesh.chunks.maximumX), arrayData(mesh.chunks.maximumY), arrayData(mesh.chunks.maximumZ), arrayData(mesh.chunks.materials),
+		arrayData(mesh.submeshes), arrayData(mesh.materials), arrayData(materialNames), arrayData(materialLibraries), arrayData(materialLibraryKeys),
+		arrayData(mesh.objects), arrayData(objectNames)
+	};
+
+	/*The arrays follow each other in order, each starting on an aligned offset*/
+	uint64_t offset = sizeof(MeshCacheHeader);
+
+	for (unsigned int array = 0; array < MeshCacheArrayCount; array++)
+	{
+		header.arrays[array].offset = alignOffset(offset);
+		header.arrays[array].count = arrays[array].count;
+		header.arrays[array].elementSize = arrays[array].elementSize;
+
+		offset = header.arrays[array].offset + arrays[array].count * arrays[array].elementSize;
+	}
+
+	const std::string cachePath = meshCachePath(objPath);
+	const std::string temporaryPath = cachePath + ".tmp";
+
+	HANDLE file = CreateFile(temporaryPath.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		OutputDebugString("Could not create the mesh cache file!");
+		return false;
+	}
+
+	/*Zeros which fill the gaps up to the aligned offsets*/
+	const char padding[16] = {};
+
+	bool written = writeAll(file, &header, sizeof(header));
+	offset = sizeof(header);
+
+	for (unsigned int array = 0; array < MeshCacheArrayCount; array++)
+	{
+		written = written && writeAll(file, padding, header.arrays[array].offset - offset);
+		written = written && writeAll(file, arrays[array].data, arrays[array].count * arrays[array].elementSize);
+
+		offset = header.arrays[array].offset + arrays[array].count * arrays[array].elementSize;
+	}
+
+	CloseHandle(file);
+
+	/*Only a complete file replaces the previous cache*/
+	if (!written || !MoveFileEx(temporaryPath.c_str(), cachePath.c_str(), MOVEFILE_REPLACE_EXISTING))
+	{
+		OutputDebugString("Could not write the mesh cache file!");
+		DeleteFile(temporaryPath.c_str());
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+#include "MeshData.h"
+
+/*
+	A binary copy of a loaded mesh, stored next to the obj file it was created from.
+
+	The cache holds every array of the final MeshData, so loading it is a single memory map
+	and copy instead of parsing, triangulating and deduplicating the text again. It is only
+	used if the obj file still has the same size and write time, or the same content hash,
+	and if it was created with the same reader settings. The mtl files the obj file names are checked
+	the same way, and one which was missing invalidates the cache once it exists.
+*/
+
+/*Identifies the obj file and the settings a cache was created from*/
+struct MeshCacheKey
+{
+	uint64_t sourceSize = 0; // Size of the obj file in bytes
+	uint64_t sourceWriteTime = 0; // Last write time of the obj file, as a FILETIME
+	uint64_t settings = 0; // Reader options which change the resulting mesh
+};
+
+/*Path of the cache belonging to an obj file*/
+std::string meshCachePath(const std::string& objPath);
+
+/*Fills in the size and write time of the obj file, returns false if the file does not exist*/
+bool makeMeshCacheKey(const std::string& objPath, uint64_t settings, MeshCacheKey& key);
+
+/*
+	Loads the arrays from the cache of the obj file. Returns false if there is no cache, if it is
+	damaged or from another version, or if the obj file, its mtl files or the settings changed since it was written.
+*/
+bool readMeshCache(const std::string& objPath, const MeshCacheKey& key, MeshData& mesh);
+
+/*Writes the cache of the obj file, replacing an existing one. The cache is written to a temporary file first, so a crash never leaves a half written cache behind*/
+bool writeMeshCache(const std::string& objPath, const MeshCacheKey& key, const MeshData& mesh);
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+#include <glm.hpp>
+
+#include "Vertex.h"
+
+/*
+	Surface of a material from an mtl file, as the fragment shader reads it from the material buffer.
+	Three vec4 have the same layout in C++ and std430, so the table is uploaded as it is.
+	The defaults are the values the shader used before materials were read.
+*/
+struct Material
+{
+	glm::vec4 ambient = glm::vec4(1.0f, 1.0f, 1.0f, 0.0f); // Ka in rgb
+	glm::vec4 diffuse = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f); // Kd in rgb, the dissolve d in a
+	glm::vec4 specular = glm::vec4(0.288f, 0.288f, 0.288f, 28.0f); // Ks in rgb, the exponent Ns in w
+};
+
+/*A range of the index buffer whose triangles all belong to one object or group and use one material*/
+struct Submesh
+{
+	uint32_t indexOffset = 0;
+	uint32_t indexCount = 0;
+	uint32_t material = 0; // Index into MeshData::materials
+	uint32_t object = 0; // Index into MeshData::objects
+
+	/*Bounding box of the triangles in object space*/
+	glm::vec3 minimum = glm::vec3(0.0f);
+	glm::vec3 maximum = glm::vec3(0.0f);
+};
+
+/*An o or g record of the obj file which has faces, its submeshes can be culled or moved on their own*/
+struct MeshObject
+{
+	/*Bounding box of the submeshes of the object, at every detail level*/
+	glm::vec3 minimum = glm::vec3(0.0f);
+	glm::vec3 maximum = glm::vec3(0.0f);
+};
+
+/*One detail level of a mesh, a range of its index buffer drawn with the shared vertex buffer*/
+struct MeshLod
+{
+	uint32_t indexOffset = 0; // First index of the level
+	uint32_t indexCount = 0; // Three indices per triangle
+	float error = 0.0f; // How far the level may lie from the full mesh, in object space units
+	uint32_t firstChunk = 0; // Spatial chunks of the level, none if the level was not split
+	uint32_t chunkCount = 0;
+	uint32_t firstSubmesh = 0; // The submeshes which make up the level, one after another in the index buffer
+	uint32_t submeshCount = 0;
+};
+
+/*
+	Contiguous ranges of the index buffer whose triangles lie close together, with their bounds as one
+	array per component, so the frustum test can load the same component of four chunks at once.
+*/
+struct SpatialChunks
+{
+	std::vector<uint32_t> indexOffsets; // First index of each chunk
+	std::vector<uint32_t> indexCounts;
+	std::vector<uint32_t> materials; // Every chunk lies inside one submesh and uses its material
+
+	/*Bounding boxes in object space*/
+	std::vector<float> minimumX;
+	std::vector<float> minimumY;
+	std::vector<float> minimumZ;
+	std::vector<float> maximumX;
+	std::vector<float> maximumY;
+	std::vector<float> maximumZ;
+
+	size_t size() const { return indexOffsets.size(); };
+};
+
+/*
+	The full mesh split into small clusters of triangles, stored as one array per field so that
+	culling only reads the bounds. Meshlet m holds triangleCounts[m] triangles starting at triangle
+	triangleOffsets[m] of the full mesh, in index buffer order, so each meshlet can be drawn as a range
+	of the index buffer. The same triangles are also stored with local indices into the vertex list of
+	the meshlet, which is the form mesh shaders consume. A meshlet never spans two submeshes.
+*/
+struct MeshletData
+{
+	std::vector<uint32_t> vertexOffsets; // First entry of each meshlet in vertices
+	std::vector<uint32_t> triangleOffsets; // First triangle of each meshlet, in triangles and in the index buffer
+	std::vector<uint8_t> vertexCounts; // At most maxMeshletVertices
+	std::vector<uint8_t> triangleCounts; // At most maxMeshletTriangles
+	std::vector<glm::vec4> boundingSpheres; // Center in xyz and radius in w, in object space
+	std::vector<glm::vec4> normalCones; // Axis in xyz and cutoff in w, see meshletFacesAway
+
+	std::vector<uint32_t> vertices; // The vertex lists of all meshlets back to back, as indices into the mesh vertices
+	std::vector<uint8_t> triangles; // Three positions in the vertex list of the meshlet per triangle
+
+	size_t size() const { return vertexOffsets.size(); };
+};
+
+/*The arrays which describe a mesh to the renderer, handed from the loader to RenderCode by moving them*/
+struct MeshData
+{
+	std::vector<Vertex> vertices; // Unique vertices
+	std::vector<uint32_t> indices; // Three indices into vertices per triangle, the detail levels one after another
+	std::vector<MeshLod> lods; // Index ranges of the detail levels from the finest to the coarsest, empty if indices only holds the full mesh and it was not split into chunks
+	std::vector<Submesh> submeshes; // The triangles of every level sorted by object and then by material, in the order of the levels. Without levels these cover the whole index buffer
+	std::vector<Material> materials; // At least the default material, submeshes of faces without usemtl use it
+	std::vector<std::string> materialNames; // Name of each material in the obj file, empty for the default material
+	std::vector<std::string> materialLibraries; // Paths of the mtl files the obj file names, including missing ones. The mesh cache is only valid while they stay the same
+	std::vector<MeshObject> objects; // At least one, faces before the first o or g belong to an object without a name
+	std::vector<std::string> objectNames; // The o name, followed by the g name after a slash if the object has groups
+	SpatialChunks chunks; // Chunks of all detail levels, each level refers to its own
+	MeshletData meshlets; // Clusters of the full mesh, empty unless they were requested
+};
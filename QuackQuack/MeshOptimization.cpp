@@ -0,0 +1,645 @@
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+/*Size of the LRU cache the Forsyth scores are tuned for, larger than real caches on purpose*/
+static const unsigned int forsythCacheSize = 32;
+
+/*Cache size used when splitting the index buffer into clusters for the overdraw pass*/
+static const unsigned int clusterCacheSize = 16;
+
+/*Width and height of the buffers the overdraw is measured with*/
+static const int overdrawGridSize = 256;
+
+static const uint32_t invalidIndex = ~0u;
+
+/*
+	Score of a vertex for the Forsyth algorithm. Vertices in the cache score higher the more recently
+	they were used, except that the three of the last triangle are slightly penalized, so strips do not
+	turn back on themselves. Vertices with few remaining triangles get a boost, so they are finished
+	off and do not have to be transformed again later.
+*/
+static float forsythVertexScore(int cachePosition, uint32_t liveTriangleCount)
+{
+	/*Nothing left to draw with this vertex*/
+	if (liveTriangleCount == 0)
+	{
+		return -1.0f;
+	}
+
+	float score = 0.0f;
+
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+		{
+			score = 0.75f;
+		}
+		else
+		{
+			const float scaler = 1.0f / (forsythCacheSize - 3);
+			score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+		}
+	}
+
+	score += 2.0f * std::pow(static_cast<float>(liveTriangleCount), -0.5f);
+
+	return score;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	assert((indices.size() % 3) == 0);
+
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	/*The triangles of every vertex, stored back to back. The first liveTriangleCounts[v] entries of each list are not emitted yet*/
+	std::vector<uint32_t> liveTriangleCounts(vertexCount, 0);
+
+	for (const uint32_t index : indices)
+	{
+		liveTriangleCounts[index]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangleCounts[vertex];
+	}
+
+	std::vector<uint32_t> adjacentTriangles(indices.size());
+	std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = indices[triangle * 3 + corner];
+			adjacentTriangles[adjacencyFill[vertex]++] = static_cast<uint32_t>(triangle);
+		}
+	}
+
+	std::vector<float> vertexScores(vertexCount);
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		vertexScores[vertex] = forsythVertexScore(-1, liveTriangleCounts[vertex]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<char> triangleEmitted(triangleCount, 0);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		triangleScores[triangle] = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+	}
+
+	std::vector<uint32_t> optimizedIndices;
+	optimizedIndices.reserve(indices.size());
+
+	/*Most recently used vertex first, with room for the three a triangle can add before the cache is trimmed*/
+	std::vector<uint32_t> cache;
+	std::vector<uint32_t> newCache;
+	cache.reserve(forsythCacheSize + 3);
+	newCache.reserve(forsythCacheSize + 3);
+
+	uint32_t bestTriangle = static_cast<uint32_t>(std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+	/*If no triangle touches the cache, the next one is taken in input order*/
+	size_t inputCursor = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (bestTriangle == invalidIndex)
+		{
+			while (triangleEmitted[inputCursor])
+			{
+				inputCursor++;
+			}
+
+			bestTriangle = static_cast<uint32_t>(inputCursor);
+		}
+
+		const uint32_t* triangleVertices = &indices[bestTriangle * 3];
+
+		optimizedIndices.insert(optimizedIndices.end(), triangleVertices, triangleVertices + 3);
+		triangleEmitted[bestTriangle] = 1;
+
+		/*Take the triangle out of the live lists of its vertices*/
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = triangleVertices[corner];
+
+			uint32_t* liveBegin = &adjacentTriangles[adjacencyOffsets[vertex]];
+			uint32_t* liveEnd = liveBegin + liveTriangleCounts[vertex];
+			uint32_t* found = std::find(liveBegin, liveEnd, bestTriangle);
+
+			std::swap(*found, *(liveEnd - 1));
+			liveTriangleCounts[vertex]--;
+		}
+
+		/*The vertices of the triangle move to the front of the cache, the rest keep their order*/
+		newCache.assign(triangleVertices, triangleVertices + 3);
+
+		for (const uint32_t vertex : cache)
+		{
+			if (vertex != triangleVertices[0] && vertex != triangleVertices[1] && vertex != triangleVertices[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		/*Update the scores of every vertex which moved, including the ones pushed out, and pass the changes on to their triangles*/
+		for (size_t position = 0; position < newCache.size(); position++)
+		{
+			const uint32_t vertex = newCache[position];
+			const int cachePosition = (position < forsythCacheSize) ? static_cast<int>(position) : -1;
+
+			const float newScore = forsythVertexScore(cachePosition, liveTriangleCounts[vertex]);
+			const float scoreChange = newScore - vertexScores[vertex];
+
+			vertexScores[vertex] = newScore;
+
+			for (uint32_t adjacency = 0; adjacency < liveTriangleCounts[vertex]; adjacency++)
+			{
+				triangleScores[adjacentTriangles[adjacencyOffsets[vertex] + adjacency]] += scoreChange;
+			}
+		}
+
+		if (newCache.size() > forsythCacheSize)
+		{
+			newCache.resize(forsythCacheSize);
+		}
+
+		cache.swap(newCache);
+
+		/*Only triangles using a cached vertex are considered, which keeps every step independent of the mesh size*/
+		bestTriangle = invalidIndex;
+		float bestScore = -std::numeric_limits<float>::max();
+
+		for (const uint32_t vertex : cache)
+		{
+			for (uint32_t adjacency = 0; adjacency < liveTriangleCounts[vertex]; adjacency++)
+			{
+				const uint32_t triangle = adjacentTriangles[adjacencyOffsets[vertex] + adjacency];
+
+				if (triangleScores[triangle] > bestScore)
+				{
+					bestScore = triangleScores[triangle];
+					bestTriangle = triangle;
+				}
+			}
+		}
+	}
+
+	indices.swap(optimizedIndices);
+}
+
+/*
+	A FIFO cache which only remembers when each vertex was last transformed. A vertex is in the
+	cache if fewer than cacheSize misses happened since then.
+*/
+class FifoCacheSimulation
+{
+
+private:
+
+	std::vector<uint32_t> missTimestamps; // Miss counter at the time each vertex was transformed, + 1 so 0 means never
+	uint32_t missCount;
+	const unsigned int cacheSize;
+
+public:
+
+	FifoCacheSimulation(size_t vertexCount, unsigned int size) : missTimestamps(vertexCount, 0), missCount(0), cacheSize(size)
+	{
+	}
+
+	/*Returns true if the vertex had to be transformed*/
+	bool access(uint32_t vertex)
+	{
+		if (missTimestamps[vertex] == 0 || (missCount - (missTimestamps[vertex] - 1)) >= cacheSize)
+		{
+			missTimestamps[vertex] = missCount + 1;
+			missCount++;
+
+			return true;
+		}
+
+		return false;
+	}
+
+	/*Forgets every vertex, as if the cache was flushed*/
+	void flush()
+	{
+		missCount += cacheSize;
+	}
+};
+
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	VertexCacheStatistics statistics;
+
+	if (indices.empty())
+	{
+		return statistics;
+	}
+
+	FifoCacheSimulation cache(vertexCount, cacheSize);
+	std::vector<char> referenced(vertexCount, 0);
+
+	size_t misses = 0;
+	size_t referencedCount = 0;
+
+	for (const uint32_t index : indices)
+	{
+		misses += cache.access(index) ? 1 : 0;
+
+		if (!referenced[index])
+		{
+			referenced[index] = 1;
+			referencedCount++;
+		}
+	}
+
+	statistics.acmr = static_cast<float>(misses) / (indices.size() / 3);
+	statistics.atvr = static_cast<float>(misses) / referencedCount;
+
+	return statistics;
+}
+
+/*A run of consecutive triangles which gets moved as a whole by the overdraw pass*/
+struct TriangleCluster
+{
+	size_t firstTriangle;
+	size_t triangleCount;
+	float sortKey;
+};
+
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	/*Hard boundaries start where the cache optimizer jumped, which shows as a triangle missing with all three vertices*/
+	std::vector<size_t> hardBoundaries;
+
+	{
+		FifoCacheSimulation cache(vertices.size(), clusterCacheSize);
+
+		for (size_t triangle = 0; triangle < triangleCount; triangle++)
+		{
+			const unsigned int misses = (cache.access(indices[triangle * 3]) ? 1 : 0) + (cache.access(indices[triangle * 3 + 1]) ? 1 : 0) + (cache.access(indices[triangle * 3 + 2]) ? 1 : 0);
+
+			if (triangle == 0 || misses == 3)
+			{
+				hardBoundaries.push_back(triangle);
+			}
+		}
+
+		hardBoundaries.push_back(triangleCount);
+	}
+
+	/*
+		Soft boundaries split the hard clusters further, at every point where the cluster so far
+		is already within the threshold of the ACMR of the whole cluster. Starting a new cluster
+		there costs at most that much cache efficiency once the clusters get reordered.
+	*/
+	std::vector<TriangleCluster> clusters;
+
+	/*One simulation for every cluster, flushed at the start of each, so the pass stays linear in the amount of vertices*/
+	FifoCacheSimulation cache(vertices.size(), clusterCacheSize);
+
+	for (size_t hardCluster = 0; hardCluster + 1 < hardBoundaries.size(); hardCluster++)
+	{
+		const size_t clusterBegin = hardBoundaries[hardCluster];
+		const size_t clusterEnd = hardBoundaries[hardCluster + 1];
+
+		cache.flush();
+
+		size_t clusterMisses = 0;
+
+		for (size_t triangle = clusterBegin; triangle < clusterEnd; triangle++)
+		{
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				clusterMisses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+		}
+
+		const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / (clusterEnd - clusterBegin);
+
+		cache.flush();
+
+		size_t softBegin = clusterBegin;
+		size_t softMisses = 0;
+
+		for (size_t triangle = clusterBegin; triangle < clusterEnd; triangle++)
+		{
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				softMisses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+			}
+
+			const size_t softTriangleCount = triangle + 1 - softBegin;
+
+			if (triangle + 1 == clusterEnd || static_cast<float>(softMisses) <= clusterThreshold * softTriangleCount)
+			{
+				TriangleCluster cluster = { softBegin, softTriangleCount, 0.0f };
+				clusters.push_back(cluster);
+
+				softBegin = triangle + 1;
+				softMisses = 0;
+				cache.flush();
+			}
+		}
+	}
+
+	/*The centre of the mesh, clusters far out along their own normal are likely to cover the ones further in*/
+	glm::vec3 meshCentre(0.0f);
+	float meshArea = 0.0f;
+
+	std::vector<glm::vec3> clusterCentres(clusters.size(), glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3(0.0f));
+	std::vector<float> clusterAreas(clusters.size(), 0.0f);
+
+	for (size_t clusterIndex = 0; clusterIndex < clusters.size(); clusterIndex++)
+	{
+		const TriangleCluster& cluster = clusters[clusterIndex];
+
+		for (size_t triangle = cluster.firstTriangle; triangle < cluster.firstTriangle + cluster.triangleCount; triangle++)
+		{
+			const glm::vec3& position0 = vertices[indices[triangle * 3]].pos;
+			const glm::vec3& position1 = vertices[indices[triangle * 3 + 1]].pos;
+			const glm::vec3& position2 = vertices[indices[triangle * 3 + 2]].pos;
+
+			/*The cross product is the normal scaled by twice the area*/
+			const glm::vec3 scaledNormal = glm::cross(position1 - position0, position2 - position0);
+			const float area = glm::length(scaledNormal);
+			const glm::vec3 centre = (position0 + position1 + position2) / 3.0f;
+
+			clusterCentres[clusterIndex] += centre * area;
+			clusterNormals[clusterIndex] += scaledNormal;
+			clusterAreas[clusterIndex] += area;
+		}
+
+		meshCentre += clusterCentres[clusterIndex];
+		meshArea += clusterAreas[clusterIndex];
+	}
+
+	meshCentre = (meshArea > 0.0f) ? meshCentre / meshArea : meshCentre;
+
+	for (size_t clusterIndex = 0; clusterIndex < clusters.size(); clusterIndex++)
+	{
+		const float normalLength = glm::length(clusterNormals[clusterIndex]);
+
+		/*Degenerate clusters have no direction and keep a neutral key*/
+		if (clusterAreas[clusterIndex] > 0.0f && normalLength > 0.0f)
+		{
+			const glm::vec3 centre = clusterCentres[clusterIndex] / clusterAreas[clusterIndex];
+			clusters[clusterIndex].sortKey = glm::dot(centre - meshCentre, clusterNormals[clusterIndex] / normalLength);
+		}
+	}
+
+	/*Outermost first, the stable sort keeps neighbouring clusters with equal keys in cache order*/
+	std::stable_sort(clusters.begin(), clusters.end(), [](const TriangleCluster& first, const TriangleCluster& second) { return first.sortKey > second.sortKey; });
+
+	std::vector<uint32_t> reorderedIndices;
+	reorderedIndices.reserve(indices.size());
+
+	for (const TriangleCluster& cluster : clusters)
+	{
+		reorderedIndices.insert(reorderedIndices.end(), indices.begin() + cluster.firstTriangle * 3, indices.begin() + (cluster.firstTriangle + cluster.triangleCount) * 3);
+	}
+
+	indices.swap(reorderedIndices);
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	std::vector<uint32_t> remap(vertices.size(), invalidIndex);
+	uint32_t nextVertex = 0;
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == invalidIndex)
+		{
+			remap[index] = nextVertex++;
+		}
+
+		index = remap[index];
+	}
+
+	std::vector<Vertex> reorderedVertices(nextVertex);
+
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+	{
+		if (remap[vertex] != invalidIndex)
+		{
+			reorderedVertices[remap[vertex]] = vertices[vertex];
+		}
+	}
+
+	vertices.swap(reorderedVertices);
+}
+
+void optimizeSubmeshes(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const Submesh* submeshes, size_t submeshCount, float overdrawThreshold)
+{
+	/*Number of every vertex inside the current submesh, reset once the submesh is done*/
+	std::vector<uint32_t> localVertices(vertices.size(), invalidIndex);
+
+	std::vector<uint32_t> rangeIndices;
+	std::vector<Vertex> rangeVertices;
+	std::vector<uint32_t> globalVertices;
+
+	for (size_t submesh = 0; submesh < submeshCount; submesh++)
+	{
+		const uint32_t* const first = indices.data() + submeshes[submesh].indexOffset;
+		const uint32_t* const last = first + submeshes[submesh].indexCount;
+
+		rangeIndices.clear();
+		rangeVertices.clear();
+		globalVertices.clear();
+
+		for (const uint32_t* index = first; index != last; index++)
+		{
+			if (localVertices[*index] == invalidIndex)
+			{
+				localVertices[*index] = static_cast<uint32_t>(globalVertices.size());
+				globalVertices.push_back(*index);
+				rangeVertices.push_back(vertices[*index]);
+			}
+
+			rangeIndices.push_back(localVertices[*index]);
+		}
+
+		optimizeVertexCache(rangeIndices, rangeVertices.size());
+
+		if (overdrawThreshold > 0.0f)
+		{
+			optimizeOverdraw(rangeIndices, rangeVertices, overdrawThreshold);
+		}
+
+		for (size_t index = 0; index < rangeIndices.size(); index++)
+		{
+			indices[submeshes[submesh].indexOffset + index] = globalVertices[rangeIndices[index]];
+		}
+
+		for (const uint32_t vertex : globalVertices)
+		{
+			localVertices[vertex] = invalidIndex;
+		}
+	}
+}
+
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, float overdrawThreshold)
+{
+	/*A single submesh covers the whole index buffer, which needs no renumbering*/
+	if (submeshes.size() <= 1)
+	{
+		optimizeVertexCache(indices, vertices.size());
+
+		if (overdrawThreshold > 0.0f)
+		{
+			optimizeOverdraw(indices, vertices, overdrawThreshold);
+		}
+	}
+	else
+	{
+		optimizeSubmeshes(indices, vertices, submeshes.data(), submeshes.size(), overdrawThreshold);
+	}
+
+	optimizeVertexFetch(vertices, indices);
+}
+
+/*Rasterizes one triangle into the depth buffer, returns the amount of fragments which passed the depth test*/
+static size_t rasterizeTriangle(const glm::vec3& vertex0, const glm::vec3& vertex1, const glm::vec3& vertex2, std::vector<float>& depthBuffer)
+{
+	/*Twice the signed area, the sign only depends on the winding in the projection*/
+	const float area = (vertex1.x - vertex0.x) * (vertex2.y - vertex0.y) - (vertex1.y - vertex0.y) * (vertex2.x - vertex0.x);
+
+	if (area == 0.0f)
+	{
+		return 0;
+	}
+
+	const int minimumX = (std::max)(0, static_cast<int>(std::floor((std::min)({ vertex0.x, vertex1.x, vertex2.x }))));
+	const int maximumX = (std::min)(overdrawGridSize - 1, static_cast<int>(std::ceil((std::max)({ vertex0.x, vertex1.x, vertex2.x }))));
+	const int minimumY = (std::max)(0, static_cast<int>(std::floor((std::min)({ vertex0.y, vertex1.y, vertex2.y }))));
+	const int maximumY = (std::min)(overdrawGridSize - 1, static_cast<int>(std::ceil((std::max)({ vertex0.y, vertex1.y, vertex2.y }))));
+
+	size_t fragmentsShaded = 0;
+
+	for (int y = minimumY; y <= maximumY; y++)
+	{
+		for (int x = minimumX; x <= maximumX; x++)
+		{
+			const float pixelX = x + 0.5f;
+			const float pixelY = y + 0.5f;
+
+			/*Barycentric weights from the edge functions, all of them positive inside the triangle*/
+			const float weight0 = ((vertex1.x - pixelX) * (vertex2.y - pixelY) - (vertex1.y - pixelY) * (vertex2.x - pixelX)) / area;
+			const float weight1 = ((vertex2.x - pixelX) * (vertex0.y - pixelY) - (vertex2.y - pixelY) * (vertex0.x - pixelX)) / area;
+			const float weight2 = 1.0f - weight0 - weight1;
+
+			if (weight0 < 0.0f || weight1 < 0.0f || weight2 < 0.0f)
+			{
+				continue;
+			}
+
+			const float depth = weight0 * vertex0.z + weight1 * vertex1.z + weight2 * vertex2.z;
+			float& storedDepth = depthBuffer[y * overdrawGridSize + x];
+
+			if (depth < storedDepth)
+			{
+				storedDepth = depth;
+				fragmentsShaded++;
+			}
+		}
+	}
+
+	return fragmentsShaded;
+}
+
+OverdrawStatistics analyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	OverdrawStatistics statistics;
+
+	if (indices.empty())
+	{
+		return statistics;
+	}
+
+	/*The mesh gets scaled uniformly to fit the grid*/
+	glm::vec3 minimum(std::numeric_limits<float>::max());
+	glm::vec3 maximum(-std::numeric_limits<float>::max());
+
+	for (const uint32_t index : indices)
+	{
+		minimum = glm::min(minimum, vertices[index].pos);
+		maximum = glm::max(maximum, vertices[index].pos);
+	}
+
+	const glm::vec3 extent = maximum - minimum;
+	const float largestExtent = (std::max)({ extent.x, extent.y, extent.z });
+	const float scale = (largestExtent > 0.0f) ? (overdrawGridSize - 1) / largestExtent : 1.0f;
+
+	std::vector<float> depthBuffer(overdrawGridSize * overdrawGridSize);
+
+	/*Looking along each axis, from both sides*/
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		for (const float direction : { 1.0f, -1.0f })
+		{
+			std::fill(depthBuffer.begin(), depthBuffer.end(), std::numeric_limits<float>::max());
+
+			const unsigned int axisU = (axis + 1) % 3;
+			const unsigned int axisV = (axis + 2) % 3;
+
+			glm::vec3 viewDirection(0.0f);
+			viewDirection[axis] = direction;
+
+			for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+			{
+				const glm::vec3& position0 = vertices[indices[triangle * 3]].pos;
+				const glm::vec3& position1 = vertices[indices[triangle * 3 + 1]].pos;
+				const glm::vec3& position2 = vertices[indices[triangle * 3 + 2]].pos;
+
+				/*Back-face culling, triangles facing along the view direction are not visible*/
+				if (glm::dot(glm::cross(position1 - position0, position2 - position0), viewDirection) >= 0.0f)
+				{
+					continue;
+				}
+
+				glm::vec3 projected[3];
+				const glm::vec3* positions[3] = { &position0, &position1, &position2 };
+
+				for (unsigned int corner = 0; corner < 3; corner++)
+				{
+					const glm::vec3 relative = (*positions[corner] - minimum) * scale;
+					projected[corner] = glm::vec3(relative[axisU], relative[axisV], relative[axis] * direction);
+				}
+
+				statistics.pixelsShaded += rasterizeTriangle(projected[0], projected[1], projected[2], depthBuffer);
+			}
+
+			statistics.pixelsCovered += std::count_if(depthBuffer.begin(), depthBuffer.end(), [](float depth) { return depth != std::numeric_limits<float>::max(); });
+		}
+	}
+
+	statistics.overdraw = (statistics.pixelsCovered != 0) ? static_cast<float>(statistics.pixelsShaded) / statistics.pixelsCovered : 0.0f;
+
+	return statistics;
+}
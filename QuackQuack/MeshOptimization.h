@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+#include "MeshData.h"
+
+/*
+	Reordering passes for indexed triangle meshes, run after import so the GPU does less work per frame.
+
+	None of them changes the triangles themselves, only the order in which they are drawn and
+	in which the vertices are stored:
+	  1. optimizeVertexCache orders the triangles so recently transformed vertices are reused,
+	  2. optimizeOverdraw moves whole runs of triangles so outward facing parts are drawn first,
+	     without giving up more than a small part of the cache efficiency,
+	  3. optimizeVertexFetch stores the vertices in the order they are first used.
+*/
+
+/*Post-transform cache efficiency of an index buffer*/
+struct VertexCacheStatistics
+{
+	float acmr = 0.0f; // Average cache miss ratio, transformed vertices per triangle. 0.5 is the ideal for large grids, 3 the worst
+	float atvr = 0.0f; // Average transformed to vertex ratio, 1 means every vertex is transformed only once
+};
+
+/*How often pixels get shaded more than once, measured with a software rasterizer*/
+struct OverdrawStatistics
+{
+	size_t pixelsShaded = 0; // Fragments which passed the depth test at the time they were drawn
+	size_t pixelsCovered = 0; // Pixels covered by the mesh in the end
+	float overdraw = 0.0f; // pixelsShaded / pixelsCovered, 1 is the ideal
+};
+
+/*Reorders the triangles for a post-transform vertex cache, with Tom Forsyth's linear-speed algorithm*/
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+/*
+	Reorders clusters of triangles to reduce overdraw, following Sander et al. "Fast Triangle Reordering".
+	The index buffer should be cache optimized already. threshold is how much worse the ACMR
+	may get, 1.05 allows 5 percent more vertex transforms in exchange for less overdraw.
+*/
+void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold);
+
+/*Stores the vertices in the order the indices first reference them, unreferenced vertices are dropped*/
+void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+/*
+	Runs the cache pass, and the overdraw pass if overdrawThreshold is above 0, on every submesh by itself, so
+	no triangle leaves its submesh. The vertices of each submesh are numbered from 0 for the passes, so a
+	submesh costs time in proportion to its own size rather than to the whole vertex buffer.
+*/
+void optimizeSubmeshes(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, const Submesh* submeshes, size_t submeshCount, float overdrawThreshold);
+
+/*Runs all three passes in the order above, the first two inside each submesh. A mesh without submeshes is treated as one*/
+void optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const std::vector<Submesh>& submeshes, float overdrawThreshold);
+
+/*Simulates a FIFO cache of the given size, as found in typical GPUs*/
+VertexCacheStatistics analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+/*Rasterizes the mesh in index order from the six axis directions with depth testing and back-face culling*/
+OverdrawStatistics analyzeOverdraw(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
@@ -0,0 +1,665 @@
+#include "MeshSimplification.h"
+#include "MeshOptimization.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <numeric>
+
+/*Border and seam edges count this much more than the triangles around them, so the outlines stay in place*/
+static const double boundaryWeight = 10.0;
+
+/*A collapse is rejected if a remaining triangle would turn further than about 75 degrees*/
+static const float flipThreshold = 0.25f;
+
+/*Rounds of collapses per simplification, each round collapses an independent set of edges*/
+static const unsigned int maximumPassCount = 100;
+
+static const uint32_t invalidIndex = ~0u;
+
+/*How a vertex may move when its edges are collapsed*/
+enum class VertexKind : uint8_t
+{
+	Manifold, // Surrounded by triangles on all sides, can collapse onto any neighbour
+	Border, // On an open edge of the mesh, only moves along the border
+	Seam, // One of two vertices with the same position, moves along the seam together with the other one
+	Locked // Corners of borders and seams, and anything more complicated
+};
+
+/*Sum of squared distances to a set of weighted planes, as a symmetric matrix A, a vector b and a constant c*/
+struct Quadric
+{
+	double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+	double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+	double c = 0.0;
+	double weight = 0.0; // Total weight of the planes
+};
+
+/*Adds the plane dot(normal, p) + distance = 0, the normal has to be unit length*/
+static void addPlane(Quadric& quadric, const glm::vec3& normal, float distance, double weight)
+{
+	const double x = normal.x;
+	const double y = normal.y;
+	const double z = normal.z;
+	const double d = distance;
+
+	quadric.a00 += weight * x * x;
+	quadric.a11 += weight * y * y;
+	quadric.a22 += weight * z * z;
+	quadric.a01 += weight * x * y;
+	quadric.a02 += weight * x * z;
+	quadric.a12 += weight * y * z;
+	quadric.b0 += weight * x * d;
+	quadric.b1 += weight * y * d;
+	quadric.b2 += weight * z * d;
+	quadric.c += weight * d * d;
+	quadric.weight += weight;
+}
+
+static void addQuadric(Quadric& quadric, const Quadric& other)
+{
+	quadric.a00 += other.a00;
+	quadric.a11 += other.a11;
+	quadric.a22 += other.a22;
+	quadric.a01 += other.a01;
+	quadric.a02 += other.a02;
+	quadric.a12 += other.a12;
+	quadric.b0 += other.b0;
+	quadric.b1 += other.b1;
+	quadric.b2 += other.b2;
+	quadric.c += other.c;
+	quadric.weight += other.weight;
+}
+
+/*Weighted mean of the squared distances from the point to the planes*/
+static double quadricError(const Quadric& quadric, const glm::vec3& point)
+{
+	if (quadric.weight <= 0.0)
+	{
+		return 0.0;
+	}
+
+	const double x = point.x;
+	const double y = point.y;
+	const double z = point.z;
+
+	const double error = quadric.a00 * x * x + quadric.a11 * y * y + quadric.a22 * z * z
+		+ 2.0 * (quadric.a01 * x * y + quadric.a02 * x * z + quadric.a12 * y * z)
+		+ 2.0 * (quadric.b0 * x + quadric.b1 * y + quadric.b2 * z)
+		+ quadric.c;
+
+	/*Rounding can push the sum of squares slightly below zero*/
+	return (std::max)(error, 0.0) / quadric.weight;
+}
+
+/*For every vertex, what follows it in the triangles it is used by, stored back to back*/
+struct Adjacency
+{
+	std::vector<uint32_t> offsets; // offsets[v] to offsets[v + 1] is the range of vertex v
+	std::vector<uint32_t> items;
+};
+
+/*Half-edges when edges is true, the next corner of every triangle around each vertex, otherwise the triangles themselves*/
+static void buildAdjacency(const std::vector<uint32_t>& indices, size_t vertexCount, bool edges, Adjacency& adjacency)
+{
+	adjacency.offsets.assign(vertexCount + 1, 0);
+
+	for (const uint32_t index : indices)
+	{
+		adjacency.offsets[index + 1]++;
+	}
+
+	std::partial_sum(adjacency.offsets.begin(), adjacency.offsets.end(), adjacency.offsets.begin());
+
+	adjacency.items.resize(indices.size());
+	std::vector<uint32_t> fill(adjacency.offsets.begin(), adjacency.offsets.end() - 1);
+
+	for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+	{
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			const uint32_t vertex = indices[triangle * 3 + corner];
+			const uint32_t next = indices[triangle * 3 + (corner + 1) % 3];
+
+			adjacency.items[fill[vertex]++] = edges ? next : static_cast<uint32_t>(triangle);
+		}
+	}
+}
+
+static bool hasEdge(const Adjacency& edges, uint32_t from, uint32_t to)
+{
+	for (uint32_t item = edges.offsets[from]; item < edges.offsets[from + 1]; item++)
+	{
+		if (edges.items[item] == to)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+	Vertices with the same position form a group. positionGroups[v] is the lowest vertex of the group,
+	and wedges links the vertices of each group into a ring.
+*/
+static void buildPositionGroups(const std::vector<Vertex>& vertices, std::vector<uint32_t>& positionGroups, std::vector<uint32_t>& wedges)
+{
+	std::vector<uint32_t> order(vertices.size());
+	std::iota(order.begin(), order.end(), 0u);
+
+	auto lessPosition = [&vertices](uint32_t first, uint32_t second)
+	{
+		const glm::vec3& a = vertices[first].pos;
+		const glm::vec3& b = vertices[second].pos;
+
+		if (a.x != b.x) return a.x < b.x;
+		if (a.y != b.y) return a.y < b.y;
+		if (a.z != b.z) return a.z < b.z;
+
+		return first < second;
+	};
+
+	std::sort(order.begin(), order.end(), lessPosition);
+
+	positionGroups.resize(vertices.size());
+	wedges.resize(vertices.size());
+
+	for (size_t begin = 0; begin < order.size();)
+	{
+		size_t end = begin + 1;
+
+		while (end < order.size() && vertices[order[end]].pos == vertices[order[begin]].pos)
+		{
+			end++;
+		}
+
+		for (size_t position = begin; position < end; position++)
+		{
+			positionGroups[order[position]] = order[begin];
+			wedges[order[position]] = order[(position + 1 < end) ? position + 1 : begin];
+		}
+
+		begin = end;
+	}
+}
+
+/*Whether there is an edge between the positions of from and to, through any of the vertices at those positions*/
+static bool hasPositionEdge(const Adjacency& edges, const std::vector<uint32_t>& positionGroups, const std::vector<uint32_t>& wedges, uint32_t from, uint32_t to)
+{
+	uint32_t wedge = from;
+
+	do
+	{
+		for (uint32_t item = edges.offsets[wedge]; item < edges.offsets[wedge + 1]; item++)
+		{
+			if (positionGroups[edges.items[item]] == positionGroups[to])
+			{
+				return true;
+			}
+		}
+
+		wedge = wedges[wedge];
+	} while (wedge != from);
+
+	return false;
+}
+
+/*
+	Sorts the vertices into the kinds above. Open edges are half-edges without a twin, on a border
+	there is no twin at all, on a seam the twin runs between other vertices at the same positions.
+	loops[v] is where the open edge leaving v goes, and loopBacks[v] where the open edge into v comes from.
+*/
+static void classifyVertices(const std::vector<uint32_t>& indices, const Adjacency& edges, const std::vector<uint32_t>& positionGroups, const std::vector<uint32_t>& wedges,
+	std::vector<VertexKind>& kinds, std::vector<uint32_t>& loops, std::vector<uint32_t>& loopBacks)
+{
+	const size_t vertexCount = positionGroups.size();
+
+	std::vector<uint32_t> openOutCounts(vertexCount, 0);
+	std::vector<uint32_t> openInCounts(vertexCount, 0);
+	std::vector<uint8_t> onBorder(vertexCount, 0);
+
+	loops.assign(vertexCount, invalidIndex);
+	loopBacks.assign(vertexCount, invalidIndex);
+
+	for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+	{
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			const uint32_t from = indices[triangle * 3 + corner];
+			const uint32_t to = indices[triangle * 3 + (corner + 1) % 3];
+
+			if (hasEdge(edges, to, from))
+			{
+				continue;
+			}
+
+			openOutCounts[from]++;
+			openInCounts[to]++;
+			loops[from] = to;
+			loopBacks[to] = from;
+
+			if (!hasPositionEdge(edges, positionGroups, wedges, to, from))
+			{
+				onBorder[from] = 1;
+				onBorder[to] = 1;
+			}
+		}
+	}
+
+	kinds.assign(vertexCount, VertexKind::Locked);
+
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		const bool singleOpenEdges = (openOutCounts[vertex] == 1) && (openInCounts[vertex] == 1);
+		const uint32_t wedge = wedges[vertex];
+
+		if (wedge == vertex)
+		{
+			/*The only vertex at its position, the end of a seam is treated as a corner*/
+			if (openOutCounts[vertex] == 0 && openInCounts[vertex] == 0)
+			{
+				kinds[vertex] = VertexKind::Manifold;
+			}
+			else if (singleOpenEdges && onBorder[vertex] && onBorder[loops[vertex]] && onBorder[loopBacks[vertex]])
+			{
+				kinds[vertex] = VertexKind::Border;
+			}
+		}
+		else if (wedges[wedge] == vertex)
+		{
+			/*Two vertices at one position, the open edges of each have to run along the open edges of the other in the opposite direction*/
+			const bool wedgeSingleOpenEdges = (openOutCounts[wedge] == 1) && (openInCounts[wedge] == 1);
+
+			if (singleOpenEdges && wedgeSingleOpenEdges && !onBorder[vertex] && !onBorder[wedge] &&
+				positionGroups[loops[vertex]] == positionGroups[loopBacks[wedge]] && positionGroups[loopBacks[vertex]] == positionGroups[loops[wedge]])
+			{
+				kinds[vertex] = VertexKind::Seam;
+			}
+		}
+	}
+}
+
+/*Where the other vertex of a seam has to collapse to, when vertex collapses onto target*/
+static uint32_t seamPartnerTarget(uint32_t vertex, uint32_t target, const std::vector<uint32_t>& wedges, const std::vector<uint32_t>& loops, const std::vector<uint32_t>& loopBacks)
+{
+	const uint32_t wedge = wedges[vertex];
+
+	return (target == loops[vertex]) ? loopBacks[wedge] : loops[wedge];
+}
+
+static bool canCollapse(uint32_t vertex, uint32_t target, const std::vector<VertexKind>& kinds, const std::vector<uint32_t>& positionGroups, const std::vector<uint32_t>& wedges,
+	const std::vector<uint32_t>& loops, const std::vector<uint32_t>& loopBacks)
+{
+	if (positionGroups[vertex] == positionGroups[target])
+	{
+		return false;
+	}
+
+	const bool alongOpenEdge = (target == loops[vertex]) || (target == loopBacks[vertex]);
+
+	switch (kinds[vertex])
+	{
+	case VertexKind::Manifold:
+		return true;
+
+	case VertexKind::Border:
+		return alongOpenEdge;
+
+	case VertexKind::Seam:
+		return alongOpenEdge && (positionGroups[seamPartnerTarget(vertex, target, wedges, loops, loopBacks)] == positionGroups[target]);
+
+	default:
+		return false;
+	}
+}
+
+/*Whether moving vertex to the position turns any of its triangles too far, triangles which collapse with the edge are skipped*/
+static bool collapseFlipsTriangles(uint32_t vertex, const glm::vec3& position, uint32_t targetGroup, const std::vector<uint32_t>& indices, const Adjacency& triangles,
+	const std::vector<Vertex>& vertices, const std::vector<uint32_t>& positionGroups)
+{
+	for (uint32_t item = triangles.offsets[vertex]; item < triangles.offsets[vertex + 1]; item++)
+	{
+		const uint32_t* corners = &indices[triangles.items[item] * 3];
+
+		if (positionGroups[corners[0]] == targetGroup || positionGroups[corners[1]] == targetGroup || positionGroups[corners[2]] == targetGroup)
+		{
+			continue;
+		}
+
+		glm::vec3 oldPositions[3];
+		glm::vec3 newPositions[3];
+
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			oldPositions[corner] = vertices[corners[corner]].pos;
+			newPositions[corner] = (corners[corner] == vertex) ? position : oldPositions[corner];
+		}
+
+		const glm::vec3 oldNormal = glm::cross(oldPositions[1] - oldPositions[0], oldPositions[2] - oldPositions[0]);
+		const glm::vec3 newNormal = glm::cross(newPositions[1] - newPositions[0], newPositions[2] - newPositions[0]);
+
+		if (glm::dot(oldNormal, newNormal) < flipThreshold * glm::length(oldNormal) * glm::length(newNormal))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*An edge collapse considered in one pass*/
+struct EdgeCollapse
+{
+	uint32_t vertex; // Removed by the collapse
+	uint32_t target; // What the vertex is replaced with
+	float cost; // Mean squared distance the surface around the vertex moves
+};
+
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error, std::vector<uint32_t>* triangleTags)
+{
+	assert((indices.size() % 3) == 0);
+
+	error = 0.0f;
+
+	std::vector<uint32_t> result = indices;
+	const size_t vertexCount = vertices.size();
+
+	if (result.size() <= targetIndexCount)
+	{
+		return result;
+	}
+
+	std::vector<uint32_t> positionGroups;
+	std::vector<uint32_t> wedges;
+	buildPositionGroups(vertices, positionGroups, wedges);
+
+	Adjacency edges;
+	buildAdjacency(result, vertexCount, true, edges);
+
+	std::vector<VertexKind> kinds;
+	std::vector<uint32_t> loops;
+	std::vector<uint32_t> loopBacks;
+	classifyVertices(result, edges, positionGroups, wedges, kinds, loops, loopBacks);
+
+	/*One quadric per position, from the planes of the triangles around it weighted by their area*/
+	std::vector<Quadric> quadrics(vertexCount);
+
+	for (size_t triangle = 0; triangle < result.size() / 3; triangle++)
+	{
+		const uint32_t* corners = &result[triangle * 3];
+		const glm::vec3 normal = glm::cross(vertices[corners[1]].pos - vertices[corners[0]].pos, vertices[corners[2]].pos - vertices[corners[0]].pos);
+		const float doubleArea = glm::length(normal);
+
+		if (doubleArea <= 0.0f)
+		{
+			continue;
+		}
+
+		const glm::vec3 unitNormal = normal / doubleArea;
+
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			addPlane(quadrics[positionGroups[corners[corner]]], unitNormal, -glm::dot(unitNormal, vertices[corners[corner]].pos), 0.5 * doubleArea);
+
+			/*Open edges also get a plane through the edge, at a right angle to the triangle, which keeps borders and seams from moving sideways*/
+			const uint32_t from = corners[corner];
+			const uint32_t to = corners[(corner + 1) % 3];
+
+			if (hasEdge(edges, to, from))
+			{
+				continue;
+			}
+
+			const glm::vec3 edge = vertices[to].pos - vertices[from].pos;
+			const float edgeLength = glm::length(edge);
+
+			if (edgeLength <= 0.0f)
+			{
+				continue;
+			}
+
+			const glm::vec3 edgeNormal = glm::normalize(glm::cross(edge, unitNormal));
+			const double edgeWeight = boundaryWeight * edgeLength * edgeLength;
+
+			addPlane(quadrics[positionGroups[from]], edgeNormal, -glm::dot(edgeNormal, vertices[from].pos), edgeWeight);
+			addPlane(quadrics[positionGroups[to]], edgeNormal, -glm::dot(edgeNormal, vertices[from].pos), edgeWeight);
+		}
+	}
+
+	Adjacency triangles;
+	std::vector<EdgeCollapse> collapses;
+	std::vector<uint32_t> collapseTargets(vertexCount);
+	std::vector<uint8_t> touchedGroups(vertexCount);
+	double largestCost = 0.0;
+
+	for (unsigned int pass = 0; pass < maximumPassCount && result.size() > targetIndexCount; pass++)
+	{
+		if (pass > 0)
+		{
+			buildAdjacency(result, vertexCount, true, edges);
+			classifyVertices(result, edges, positionGroups, wedges, kinds, loops, loopBacks);
+		}
+
+		buildAdjacency(result, vertexCount, false, triangles);
+
+		/*Every half-edge is a candidate in its own direction, open edges in both directions as they have no twin*/
+		collapses.clear();
+
+		auto addCollapse = [&](uint32_t vertex, uint32_t target)
+		{
+			if (canCollapse(vertex, target, kinds, positionGroups, wedges, loops, loopBacks))
+			{
+				const EdgeCollapse collapse = { vertex, target, static_cast<float>(quadricError(quadrics[positionGroups[vertex]], vertices[target].pos)) };
+				collapses.push_back(collapse);
+			}
+		};
+
+		for (size_t triangle = 0; triangle < result.size() / 3; triangle++)
+		{
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				const uint32_t from = result[triangle * 3 + corner];
+				const uint32_t to = result[triangle * 3 + (corner + 1) % 3];
+
+				addCollapse(from, to);
+
+				if (!hasEdge(edges, to, from))
+				{
+					addCollapse(to, from);
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const EdgeCollapse& first, const EdgeCollapse& second) { return first.cost < second.cost; });
+
+		/*Collapses which share no triangles, so every one of them sees the mesh as it was at the start of the pass*/
+		std::iota(collapseTargets.begin(), collapseTargets.end(), 0u);
+		std::fill(touchedGroups.begin(), touchedGroups.end(), 0);
+
+		const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+		size_t removedTriangles = 0;
+		size_t collapseCount = 0;
+
+		for (const EdgeCollapse& collapse : collapses)
+		{
+			if (removedTriangles >= trianglesToRemove)
+			{
+				break;
+			}
+
+			const uint32_t vertexGroup = positionGroups[collapse.vertex];
+			const uint32_t targetGroup = positionGroups[collapse.target];
+
+			if (touchedGroups[vertexGroup] || touchedGroups[targetGroup])
+			{
+				continue;
+			}
+
+			/*Both vertices of a seam move, each along its own side*/
+			uint32_t movingVertices[2] = { collapse.vertex, invalidIndex };
+			uint32_t movingTargets[2] = { collapse.target, invalidIndex };
+
+			if (kinds[collapse.vertex] == VertexKind::Seam)
+			{
+				movingVertices[1] = wedges[collapse.vertex];
+				movingTargets[1] = seamPartnerTarget(collapse.vertex, collapse.target, wedges, loops, loopBacks);
+			}
+
+			bool flips = false;
+
+			for (unsigned int side = 0; side < 2 && movingVertices[side] != invalidIndex; side++)
+			{
+				flips = flips || collapseFlipsTriangles(movingVertices[side], vertices[collapse.target].pos, targetGroup, result, triangles, vertices, positionGroups);
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			for (unsigned int side = 0; side < 2 && movingVertices[side] != invalidIndex; side++)
+			{
+				const uint32_t vertex = movingVertices[side];
+
+				collapseTargets[vertex] = movingTargets[side];
+
+				/*Nothing around the vertex may change again in this pass, the adjacency would be out of date*/
+				for (uint32_t item = triangles.offsets[vertex]; item < triangles.offsets[vertex + 1]; item++)
+				{
+					const uint32_t* corners = &result[triangles.items[item] * 3];
+					bool collapsesWithEdge = false;
+
+					for (unsigned int corner = 0; corner < 3; corner++)
+					{
+						touchedGroups[positionGroups[corners[corner]]] = 1;
+						collapsesWithEdge = collapsesWithEdge || (positionGroups[corners[corner]] == targetGroup);
+					}
+
+					removedTriangles += collapsesWithEdge ? 1 : 0;
+				}
+			}
+
+			addQuadric(quadrics[targetGroup], quadrics[vertexGroup]);
+			largestCost = (std::max)(largestCost, static_cast<double>(collapse.cost));
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+		{
+			break;
+		}
+
+		/*Move the collapsed vertices and drop the triangles which lost their area*/
+		size_t writePosition = 0;
+
+		for (size_t triangle = 0; triangle < result.size() / 3; triangle++)
+		{
+			const uint32_t a = collapseTargets[result[triangle * 3 + 0]];
+			const uint32_t b = collapseTargets[result[triangle * 3 + 1]];
+			const uint32_t c = collapseTargets[result[triangle * 3 + 2]];
+
+			if (positionGroups[a] == positionGroups[b] || positionGroups[b] == positionGroups[c] || positionGroups[c] == positionGroups[a])
+			{
+				continue;
+			}
+
+			if (triangleTags != nullptr)
+			{
+				(*triangleTags)[writePosition / 3] = (*triangleTags)[triangle];
+			}
+
+			result[writePosition++] = a;
+			result[writePosition++] = b;
+			result[writePosition++] = c;
+		}
+
+		result.resize(writePosition);
+
+		if (triangleTags != nullptr)
+		{
+			triangleTags->resize(writePosition / 3);
+		}
+	}
+
+	error = static_cast<float>(std::sqrt(largestCost));
+
+	return result;
+}
+
+void buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, unsigned int levelCount, std::vector<MeshLod>& lods, std::vector<Submesh>& submeshes)
+{
+	lods.clear();
+
+	MeshLod fullMesh;
+	fullMesh.indexCount = static_cast<uint32_t>(indices.size());
+	fullMesh.submeshCount = static_cast<uint32_t>(submeshes.size());
+	lods.push_back(fullMesh);
+
+	/*Every level is simplified from the one before, which is much faster than starting from the full mesh each time*/
+	std::vector<uint32_t> level(indices);
+	float error = 0.0f;
+
+	/*The submesh of every triangle of the level, in the order of the level submeshes*/
+	std::vector<uint32_t> levelSubmeshes;
+	levelSubmeshes.reserve(indices.size() / 3);
+
+	for (const Submesh& submesh : submeshes)
+	{
+		levelSubmeshes.insert(levelSubmeshes.end(), submesh.indexCount / 3, static_cast<uint32_t>(&submesh - submeshes.data()));
+	}
+
+	for (unsigned int levelIndex = 0; levelIndex < levelCount; levelIndex++)
+	{
+		const size_t targetIndexCount = (level.size() / 6) * 3;
+
+		float levelError = 0.0f;
+		std::vector<uint32_t> simplifiedSubmeshes(levelSubmeshes);
+		std::vector<uint32_t> simplified = simplifyMesh(vertices, level, targetIndexCount, levelError, &simplifiedSubmeshes);
+
+		if (simplified.empty() || simplified.size() * 10 > level.size() * 9)
+		{
+			break;
+		}
+
+		/*The remaining triangles kept their order, so they are still grouped by submesh and only the counts changed*/
+		MeshLod lod;
+		lod.indexOffset = static_cast<uint32_t>(indices.size());
+		lod.indexCount = static_cast<uint32_t>(simplified.size());
+		lod.firstSubmesh = static_cast<uint32_t>(submeshes.size());
+
+		uint32_t previousSubmesh = invalidIndex;
+
+		for (size_t triangle = 0; triangle < simplifiedSubmeshes.size(); triangle++)
+		{
+			if (simplifiedSubmeshes[triangle] != previousSubmesh)
+			{
+				previousSubmesh = simplifiedSubmeshes[triangle];
+
+				Submesh submesh;
+				submesh.indexOffset = lod.indexOffset + static_cast<uint32_t>(triangle * 3);
+				submesh.material = submeshes[previousSubmesh].material;
+				submesh.object = submeshes[previousSubmesh].object;
+				submeshes.push_back(submesh);
+			}
+
+			submeshes.back().indexCount += 3;
+
+			/*The next level is simplified from this one, so its triangles refer to the submeshes of this level*/
+			simplifiedSubmeshes[triangle] = static_cast<uint32_t>(submeshes.size() - 1);
+		}
+
+		lod.submeshCount = static_cast<uint32_t>(submeshes.size()) - lod.firstSubmesh;
+
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		optimizeSubmeshes(indices, vertices, submeshes.data() + lod.firstSubmesh, lod.submeshCount, 0.0f);
+
+		/*The quadrics only know the previous level, the distances add up at worst*/
+		error += levelError;
+		lod.error = error;
+		lods.push_back(lod);
+
+		level.assign(indices.begin() + lod.indexOffset, indices.end());
+		levelSubmeshes.swap(simplifiedSubmeshes);
+	}
+}
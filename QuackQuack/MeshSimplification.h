@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+#include "MeshData.h"
+
+/*
+	Mesh simplification with quadric error metrics, after Garland and Heckbert.
+
+	Edges are collapsed by moving one vertex onto its neighbour, so the simplified meshes only
+	reference vertices which already exist and can share the vertex buffer of the full mesh.
+	Every position keeps the summed squared distances to the planes of its original triangles,
+	and the collapses which move the surface the least are done first.
+
+	Borders of open meshes and seams, where vertices share a position but have different texture
+	coordinates or normals, only collapse along themselves. Both sides of a seam move together, so
+	no cracks open up and the attributes on either side stay intact. Corners of borders and seams
+	never move.
+*/
+
+/*
+	Simplifies the triangles until at most targetIndexCount indices are left, or until no more edges
+	can be collapsed without flipping triangles or breaking a border or seam. error receives the
+	largest distance a collapse moved the surface, in object space units. The remaining triangles keep their
+	order. If triangleTags holds a value for every triangle, such as its submesh, it is compacted the same way.
+*/
+std::vector<uint32_t> simplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float& error, std::vector<uint32_t>* triangleTags = nullptr);
+
+/*
+	Appends up to levelCount detail levels to indices, each with about half the triangles of the one before.
+	lods receives the index ranges of the full mesh and the new levels. The chain ends early if a level
+	cannot be reduced by at least a tenth. The error of each level includes the errors of the levels before it.
+
+	submeshes has to cover the full mesh on entry. Each level is simplified as a whole, so no cracks open up
+	between materials, and its triangles are then grouped by submesh again. The submeshes of every new level
+	are appended, and each level refers to its own.
+*/
+void buildLodChain(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, unsigned int levelCount, std::vector<MeshLod>& lods, std::vector<Submesh>& submeshes);
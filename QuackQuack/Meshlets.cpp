@@ -0,0 +1,175 @@
+#include "Meshlets.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+static_assert(maxMeshletVertices <= 255 && maxMeshletTriangles <= 255, "Meshlet sizes are stored in bytes");
+
+/*Marks vertices which are not part of the meshlet being built*/
+static const uint8_t notInMeshlet = 0xFF;
+
+/*Computes the bounds of the meshlet that was just completed, from its local vertex list and triangles*/
+static void finishMeshlet(const std::vector<Vertex>& vertices, MeshletData& meshlets)
+{
+	const size_t meshlet = meshlets.size() - 1;
+	const uint32_t* meshletVertices = &meshlets.vertices[meshlets.vertexOffsets[meshlet]];
+	const uint8_t* meshletTriangles = &meshlets.triangles[meshlets.triangleOffsets[meshlet] * 3];
+
+	/*A sphere around the center of the bounding box, not the smallest one but cheap and never far off for such small clusters*/
+	glm::vec3 minimum = vertices[meshletVertices[0]].pos;
+	glm::vec3 maximum = minimum;
+
+	for (unsigned int vertex = 1; vertex < meshlets.vertexCounts[meshlet]; vertex++)
+	{
+		minimum = glm::min(minimum, vertices[meshletVertices[vertex]].pos);
+		maximum = glm::max(maximum, vertices[meshletVertices[vertex]].pos);
+	}
+
+	const glm::vec3 center = 0.5f * (minimum + maximum);
+	float radius = 0.0f;
+
+	for (unsigned int vertex = 0; vertex < meshlets.vertexCounts[meshlet]; vertex++)
+	{
+		radius = (std::max)(radius, glm::length(vertices[meshletVertices[vertex]].pos - center));
+	}
+
+	meshlets.boundingSpheres.push_back(glm::vec4(center, radius));
+
+	/*The cone axis is the average direction of the triangles, its opening the angle to the furthest one*/
+	std::vector<glm::vec3> normals;
+	normals.reserve(meshlets.triangleCounts[meshlet]);
+
+	glm::vec3 normalSum(0.0f);
+
+	for (unsigned int triangle = 0; triangle < meshlets.triangleCounts[meshlet]; triangle++)
+	{
+		const glm::vec3& a = vertices[meshletVertices[meshletTriangles[triangle * 3 + 0]]].pos;
+		const glm::vec3& b = vertices[meshletVertices[meshletTriangles[triangle * 3 + 1]]].pos;
+		const glm::vec3& c = vertices[meshletVertices[meshletTriangles[triangle * 3 + 2]]].pos;
+
+		const glm::vec3 normal = glm::cross(b - a, c - a);
+		const float length = glm::length(normal);
+
+		/*Triangles without area face nowhere*/
+		if (length > 0.0f)
+		{
+			normals.push_back(normal / length);
+			normalSum += normal / length;
+		}
+	}
+
+	const float axisLength = glm::length(normalSum);
+
+	if (normals.empty() || axisLength <= 0.0f)
+	{
+		meshlets.normalCones.push_back(glm::vec4(0.0f, 0.0f, 1.0f, 1.0f)); // Never culled
+		return;
+	}
+
+	const glm::vec3 axis = normalSum / axisLength;
+	float smallestDot = 1.0f;
+
+	for (const glm::vec3& normal : normals)
+	{
+		smallestDot = (std::min)(smallestDot, glm::dot(axis, normal));
+	}
+
+	/*A cone of 90 degrees or more always has a triangle facing the camera*/
+	const float cutoff = (smallestDot <= 0.0f) ? 1.0f : std::sqrt(1.0f - smallestDot * smallestDot);
+
+	meshlets.normalCones.push_back(glm::vec4(axis, cutoff));
+}
+
+void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t indexCount, const Submesh* submeshes, size_t submeshCount, MeshletData& meshlets)
+{
+	assert((indexCount % 3) == 0 && indexCount <= indices.size());
+
+	meshlets = MeshletData();
+
+	/*Position of every vertex in the vertex list of the current meshlet*/
+	std::vector<uint8_t> localIndices(vertices.size(), notInMeshlet);
+
+	/*A rough guess, the meshlets are mostly limited by their vertices*/
+	const size_t expectedMeshletCount = indexCount / (maxMeshletTriangles * 3) + 1;
+	meshlets.vertexOffsets.reserve(expectedMeshletCount);
+	meshlets.triangleOffsets.reserve(expectedMeshletCount);
+	meshlets.triangles.reserve(indexCount);
+
+	/*The next submesh to start a meshlet at*/
+	size_t nextSubmesh = 0;
+
+	for (size_t triangle = 0; triangle < indexCount / 3; triangle++)
+	{
+		const uint32_t* corners = &indices[triangle * 3];
+
+		bool submeshStarts = false;
+
+		while (nextSubmesh < submeshCount && submeshes[nextSubmesh].indexOffset <= triangle * 3)
+		{
+			submeshStarts = true;
+			nextSubmesh++;
+		}
+
+		unsigned int newVertexCount = 0;
+
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			/*A triangle may use the same vertex twice, it only counts once*/
+			const bool repeated = (corner > 0 && corners[corner] == corners[0]) || (corner > 1 && corners[corner] == corners[1]);
+			newVertexCount += (localIndices[corners[corner]] == notInMeshlet && !repeated) ? 1 : 0;
+		}
+
+		const bool meshletFull = !meshlets.vertexCounts.empty() &&
+			(submeshStarts || meshlets.vertexCounts.back() + newVertexCount > maxMeshletVertices || meshlets.triangleCounts.back() + 1u > maxMeshletTriangles);
+
+		if (meshlets.vertexCounts.empty() || meshletFull)
+		{
+			if (meshletFull)
+			{
+				finishMeshlet(vertices, meshlets);
+
+				/*Reset only the vertices of the finished meshlet, clearing the whole array would make this quadratic*/
+				for (uint32_t item = meshlets.vertexOffsets.back(); item < meshlets.vertices.size(); item++)
+				{
+					localIndices[meshlets.vertices[item]] = notInMeshlet;
+				}
+			}
+
+			meshlets.vertexOffsets.push_back(static_cast<uint32_t>(meshlets.vertices.size()));
+			meshlets.triangleOffsets.push_back(static_cast<uint32_t>(triangle));
+			meshlets.vertexCounts.push_back(0);
+			meshlets.triangleCounts.push_back(0);
+		}
+
+		for (unsigned int corner = 0; corner < 3; corner++)
+		{
+			uint8_t& localIndex = localIndices[corners[corner]];
+
+			if (localIndex == notInMeshlet)
+			{
+				localIndex = meshlets.vertexCounts.back()++;
+				meshlets.vertices.push_back(corners[corner]);
+			}
+
+			meshlets.triangles.push_back(localIndex);
+		}
+
+		meshlets.triangleCounts.back()++;
+	}
+
+	if (!meshlets.vertexCounts.empty())
+	{
+		finishMeshlet(vertices, meshlets);
+	}
+}
+
+bool meshletFacesAway(const MeshletData& meshlets, size_t meshlet, const glm::vec3& cameraPosition)
+{
+	const glm::vec4& sphere = meshlets.boundingSpheres[meshlet];
+	const glm::vec4& cone = meshlets.normalCones[meshlet];
+
+	const glm::vec3 toCenter = glm::vec3(sphere) - cameraPosition;
+
+	return glm::dot(toCenter, glm::vec3(cone)) >= cone.w * glm::length(toCenter) + sphere.w;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <glm.hpp>
+
+#include "Vertex.h"
+#include "MeshData.h"
+
+/*Limits of a meshlet, the sizes commonly recommended for mesh shader hardware. The local indices have to fit a byte*/
+const unsigned int maxMeshletVertices = 64;
+const unsigned int maxMeshletTriangles = 124;
+
+/*
+	Splits the first indexCount indices into meshlets, in the order the triangles are drawn.
+
+	A meshlet is closed as soon as the next triangle would exceed one of the limits, so the meshlets
+	are as compact as the triangle order is, which is why the index buffer should be optimized for the
+	vertex cache first. Every meshlet gets a bounding sphere and a cone around the normals of its triangles.
+	A new meshlet is also started where each of the submeshes begins, so every meshlet has a single material.
+*/
+void buildMeshlets(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, size_t indexCount, const Submesh* submeshes, size_t submeshCount, MeshletData& meshlets);
+
+/*
+	True if every triangle of the meshlet faces away from a camera at the given object space position,
+	tested against the bounding sphere so it holds for any point inside the meshlet.
+	The normal cone cutoff is the sine of the angle between the axis and the furthest normal, or 1 if
+	the normals spread too far for the meshlet to ever face away completely.
+*/
+bool meshletFacesAway(const MeshletData& meshlets, size_t meshlet, const glm::vec3& cameraPosition);
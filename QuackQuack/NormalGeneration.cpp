@@ -0,0 +1,474 @@
+#include "NormalGeneration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+/*
+	The vertices are spread over this many buckets by position, and the corners over this many ranges of
+	positions. Fixed counts keep the result independent of the amount of threads
+*/
+static const unsigned int normalBucketCount = 256;
+
+/*Corners of one vertex whose normals are closer than this cosine share the vertex*/
+static const float sameNormalCosine = 0.99996f; // About half a degree
+
+/*Runs step for every index in [0, count), on the pool if there is one and on the calling thread otherwise*/
+static void forEachTask(ThreadPool* pool, size_t count, const std::function<void(size_t)>& step)
+{
+	if (pool != nullptr)
+	{
+		pool->parallelFor(count, step);
+	}
+	else
+	{
+		for (size_t index = 0; index < count; index++)
+		{
+			step(index);
+		}
+	}
+}
+
+/*Hash of the exact position. -0 and 0 are the same position but not the same bits*/
+static uint32_t hashPosition(const glm::vec3& position)
+{
+	uint32_t bits[3];
+
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		const float value = (position[axis] == 0.0f) ? 0.0f : position[axis];
+		std::memcpy(&bits[axis], &value, sizeof(value));
+	}
+
+	uint32_t hash = (bits[0] * 0x8DA6B343u) ^ (bits[1] * 0xD8163841u) ^ (bits[2] * 0xCB1AB31Fu);
+
+	/*Final mix of MurmurHash3, the buckets use the high bits and the tables inside them the low bits*/
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6Bu;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35u;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static uint32_t bucketOf(uint32_t hash)
+{
+	return static_cast<uint32_t>((static_cast<uint64_t>(hash) * normalBucketCount) >> 32);
+}
+
+/*arccos with an error below 1e-4 radians (Abramowitz and Stegun 4.4.45), plenty for a weight and far cheaper than std::acos*/
+static float fastAcos(float x)
+{
+	const float absolute = (std::min)(std::abs(x), 1.0f);
+
+	float result = -0.0187293f;
+	result = result * absolute + 0.0742610f;
+	result = result * absolute - 0.2121144f;
+	result = result * absolute + 1.5707288f;
+	result *= std::sqrt(1.0f - absolute);
+
+	return (x < 0.0f) ? 3.14159265f - result : result;
+}
+
+/*A vertex copied into its bucket with its position, so the bucket reads its records in order*/
+struct PositionRecord
+{
+	glm::vec3 position;
+	uint32_t vertex;
+};
+
+/*Splits [0, count) into blockCount nearly equal blocks and returns the first and last item of one*/
+static void blockRange(size_t count, size_t blockCount, size_t block, size_t& first, size_t& last)
+{
+	const size_t itemsPerBlock = (count + blockCount - 1) / blockCount;
+
+	first = (std::min)(block * itemsPerBlock, count);
+	last = (std::min)(first + itemsPerBlock, count);
+}
+
+/*
+	Scatters the items of every block into buckets, keeping the order of the items inside each bucket.
+	bucketOfItem(item) picks the bucket and write(item, slot) stores the item at its slot. bucketOffsets
+	receives where each bucket starts, with the total at the end
+*/
+template<typename BucketOf, typename Write>
+static void scatterToBuckets(ThreadPool* pool, size_t itemCount, size_t blockCount, const BucketOf& bucketOfItem, const Write& write, std::vector<size_t>& bucketOffsets)
+{
+	std::vector<size_t> blockOffsets(blockCount * normalBucketCount, 0);
+
+	forEachTask(pool, blockCount, [&](size_t block)
+	{
+		size_t first, last;
+		blockRange(itemCount, blockCount, block, first, last);
+
+		size_t* counts = &blockOffsets[block * normalBucketCount];
+
+		for (size_t item = first; item < last; item++)
+		{
+			counts[bucketOfItem(item)]++;
+		}
+	});
+
+	/*The blocks of a bucket follow each other, so every bucket lists its items in their original order*/
+	bucketOffsets.assign(normalBucketCount + 1, 0);
+	size_t offset = 0;
+
+	for (unsigned int bucket = 0; bucket < normalBucketCount; bucket++)
+	{
+		bucketOffsets[bucket] = offset;
+
+		for (size_t block = 0; block < blockCount; block++)
+		{
+			const size_t count = blockOffsets[block * normalBucketCount + bucket];
+
+			blockOffsets[block * normalBucketCount + bucket] = offset;
+			offset += count;
+		}
+	}
+
+	bucketOffsets[normalBucketCount] = offset;
+
+	forEachTask(pool, blockCount, [&](size_t block)
+	{
+		size_t first, last;
+		blockRange(itemCount, blockCount, block, first, last);
+
+		size_t* offsets = &blockOffsets[block * normalBucketCount];
+
+		for (size_t item = first; item < last; item++)
+		{
+			write(item, offsets[bucketOfItem(item)]++);
+		}
+	});
+}
+
+/*
+	Maps every vertex to the first vertex with the same position. Each bucket owns the positions
+	hashed into it and numbers them with a table of its own
+*/
+static void buildPositionRemap(const std::vector<Vertex>& vertices, ThreadPool* pool, size_t blockCount, std::vector<uint32_t>& remap)
+{
+	std::vector<PositionRecord> records(vertices.size());
+	std::vector<size_t> bucketOffsets;
+
+	scatterToBuckets(pool, vertices.size(), blockCount,
+		[&](size_t vertex) { return bucketOf(hashPosition(vertices[vertex].pos)); },
+		[&](size_t vertex, size_t slot) { records[slot].position = vertices[vertex].pos; records[slot].vertex = static_cast<uint32_t>(vertex); },
+		bucketOffsets);
+
+	remap.resize(vertices.size());
+
+	forEachTask(pool, normalBucketCount, [&](size_t bucket)
+	{
+		const PositionRecord* bucketRecords = records.data() + bucketOffsets[bucket];
+		const size_t recordCount = bucketOffsets[bucket + 1] - bucketOffsets[bucket];
+
+		size_t tableSize = 16;
+
+		while (tableSize < recordCount * 2)
+		{
+			tableSize *= 2;
+		}
+
+		/*Holds the record of the first vertex at each position*/
+		std::vector<uint32_t> table(tableSize, UINT32_MAX);
+
+		for (size_t record = 0; record < recordCount; record++)
+		{
+			const glm::vec3& position = bucketRecords[record].position;
+			size_t slot = hashPosition(position) & (tableSize - 1);
+
+			while (table[slot] != UINT32_MAX && bucketRecords[table[slot]].position != position)
+			{
+				slot = (slot + 1) & (tableSize - 1);
+			}
+
+			if (table[slot] == UINT32_MAX)
+			{
+				table[slot] = static_cast<uint32_t>(record);
+			}
+
+			remap[bucketRecords[record].vertex] = bucketRecords[table[slot]].vertex;
+		}
+	});
+}
+
+/*What one range of positions adds to the mesh, merged once every range is done*/
+struct NormalRangeResult
+{
+	std::vector<Vertex> addedVertices; // Copies of vertices whose corners were split by a crease
+	std::vector<std::pair<uint32_t, uint32_t>> addedCorners; // Corner and the added vertex it uses
+	size_t generatedCount = 0;
+};
+
+/*A normal given to the corners of one vertex*/
+struct NormalAssignment
+{
+	uint32_t vertex; // The vertex the corners referenced
+	uint32_t addedVertex; // Index into NormalRangeResult::addedVertices, UINT32_MAX if the vertex itself got the normal
+	glm::vec3 normal;
+};
+
+/*Triangle data shared by all ranges*/
+struct NormalTriangles
+{
+	std::vector<glm::vec3> faceNormals; // Unit normal of every triangle, 0 if it has no area
+	std::vector<float> cornerAngles; // Angle of the triangle at each corner, its weight in the sum
+	float creaseCosine;
+	float halfCreaseCosine;
+};
+
+/*
+	Computes the normals of the corners at one position and gives them to the vertices, listing the
+	corners in their order in the index buffer. Only this position's range touches these vertices
+*/
+static void smoothPosition(const uint32_t* corners, size_t cornerCount, const NormalTriangles& triangles, std::vector<Vertex>& vertices,
+	const std::vector<uint32_t>& indices, std::vector<NormalAssignment>& assignments, NormalRangeResult& result)
+{
+	assignments.clear();
+
+	glm::vec3 smoothSum(0.0f);
+
+	for (size_t item = 0; item < cornerCount; item++)
+	{
+		smoothSum += triangles.cornerAngles[corners[item]] * triangles.faceNormals[corners[item] / 3];
+	}
+
+	const float smoothLength = glm::length(smoothSum);
+	const glm::vec3 smoothNormal = (smoothLength > 0.0f) ? smoothSum / smoothLength : glm::vec3(0.0f, 0.0f, 1.0f);
+
+	/*
+		If every triangle lies within half the crease angle of the average, no two of them meet at a crease
+		and all corners get the average. This is the common case and skips comparing every pair
+	*/
+	bool smooth = true;
+
+	for (size_t item = 0; item < cornerCount && smooth; item++)
+	{
+		smooth = glm::dot(smoothNormal, triangles.faceNormals[corners[item] / 3]) >= triangles.halfCreaseCosine;
+	}
+
+	for (size_t item = 0; item < cornerCount; item++)
+	{
+		const uint32_t corner = corners[item];
+		glm::vec3 normal = smoothNormal;
+
+		if (!smooth)
+		{
+			/*Sum the triangles around the position which do not meet this one at a crease*/
+			const glm::vec3& faceNormal = triangles.faceNormals[corner / 3];
+			glm::vec3 normalSum(0.0f);
+
+			for (size_t otherItem = 0; otherItem < cornerCount; otherItem++)
+			{
+				const glm::vec3& otherNormal = triangles.faceNormals[corners[otherItem] / 3];
+
+				if (glm::dot(faceNormal, otherNormal) >= triangles.creaseCosine)
+				{
+					normalSum += triangles.cornerAngles[corners[otherItem]] * otherNormal;
+				}
+			}
+
+			/*A triangle without area has no direction of its own and takes the one of the whole position*/
+			const float length = glm::length(normalSum);
+			normal = (length > 0.0f) ? normalSum / length : smoothNormal;
+		}
+
+		/*Reuse a normal this vertex already got, or give it the new one*/
+		const uint32_t vertex = indices[corner];
+		bool vertexAssigned = false;
+		bool cornerAssigned = false;
+
+		for (const NormalAssignment& assignment : assignments)
+		{
+			if (assignment.vertex != vertex)
+			{
+				continue;
+			}
+
+			vertexAssigned = true;
+
+			if (glm::dot(assignment.normal, normal) >= sameNormalCosine)
+			{
+				if (assignment.addedVertex != UINT32_MAX)
+				{
+					result.addedCorners.push_back(std::make_pair(corner, assignment.addedVertex));
+				}
+
+				cornerAssigned = true;
+				break;
+			}
+		}
+
+		if (cornerAssigned)
+		{
+			continue;
+		}
+
+		if (!vertexAssigned)
+		{
+			/*The obj file gave this vertex a normal*/
+			if (vertices[vertex].norm != glm::vec3(0.0f))
+			{
+				continue;
+			}
+
+			vertices[vertex].norm = normal;
+			assignments.push_back({ vertex, UINT32_MAX, normal });
+		}
+		else
+		{
+			/*A crease runs through the vertex, the corners on this side get a copy*/
+			const uint32_t addedVertex = static_cast<uint32_t>(result.addedVertices.size());
+
+			result.addedVertices.push_back(vertices[vertex]);
+			result.addedVertices.back().norm = normal;
+			result.addedCorners.push_back(std::make_pair(corner, addedVertex));
+
+			assignments.push_back({ vertex, addedVertex, normal });
+		}
+
+		result.generatedCount++;
+	}
+}
+
+bool hasMissingNormals(const std::vector<Vertex>& vertices)
+{
+	return std::any_of(vertices.begin(), vertices.end(), [](const Vertex& vertex) { return vertex.norm == glm::vec3(0.0f); });
+}
+
+size_t generateNormals(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float creaseAngle, ThreadPool* pool)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	if (triangleCount == 0 || !hasMissingNormals(vertices))
+	{
+		return 0;
+	}
+
+	/*A few blocks per thread even out the work*/
+	const size_t blockCount = (std::max)((pool != nullptr) ? pool->size() * 4 : 1, static_cast<size_t>(1));
+
+	NormalTriangles triangles;
+	triangles.faceNormals.resize(triangleCount);
+	triangles.cornerAngles.resize(triangleCount * 3);
+	triangles.creaseCosine = std::cos(creaseAngle * 0.0174532925f);
+	triangles.halfCreaseCosine = std::cos(creaseAngle * 0.5f * 0.0174532925f);
+
+	/*Normals and corner angles of the triangles*/
+	forEachTask(pool, blockCount, [&](size_t block)
+	{
+		size_t firstTriangle, lastTriangle;
+		blockRange(triangleCount, blockCount, block, firstTriangle, lastTriangle);
+
+		for (size_t triangle = firstTriangle; triangle < lastTriangle; triangle++)
+		{
+			const glm::vec3 positions[3] =
+			{
+				vertices[indices[triangle * 3 + 0]].pos, vertices[indices[triangle * 3 + 1]].pos, vertices[indices[triangle * 3 + 2]].pos
+			};
+
+			const glm::vec3 normal = glm::cross(positions[1] - positions[0], positions[2] - positions[0]);
+			const float length = glm::length(normal);
+
+			triangles.faceNormals[triangle] = (length > 0.0f) ? normal / length : glm::vec3(0.0f);
+
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				const glm::vec3 toNext = positions[(corner + 1) % 3] - positions[corner];
+				const glm::vec3 toPrevious = positions[(corner + 2) % 3] - positions[corner];
+				const float edgeLengths = std::sqrt(glm::dot(toNext, toNext) * glm::dot(toPrevious, toPrevious));
+
+				/*Triangles without area carry no weight*/
+				triangles.cornerAngles[triangle * 3 + corner] = (length > 0.0f && edgeLengths > 0.0f) ? fastAcos(glm::dot(toNext, toPrevious) / edgeLengths) : 0.0f;
+			}
+		}
+	});
+
+	/*Vertices which only differ in texture coordinates share a position and are smoothed together*/
+	std::vector<uint32_t> positionRemap;
+	buildPositionRemap(vertices, pool, blockCount, positionRemap);
+
+	/*
+		Split the positions into ranges of their first vertex and list the corners of each range. The vertices
+		are stored roughly in the order the triangles use them, so a range covers one part of the mesh
+	*/
+	const size_t positionsPerRange = (vertices.size() + normalBucketCount - 1) / normalBucketCount;
+	std::vector<uint32_t> rangeCorners(triangleCount * 3);
+	std::vector<size_t> rangeOffsets;
+
+	scatterToBuckets(pool, triangleCount * 3, blockCount,
+		[&](size_t corner) { return positionRemap[indices[corner]] / positionsPerRange; },
+		[&](size_t corner, size_t slot) { rangeCorners[slot] = static_cast<uint32_t>(corner); },
+		rangeOffsets);
+
+	std::vector<NormalRangeResult> results(normalBucketCount);
+
+	forEachTask(pool, normalBucketCount, [&](size_t range)
+	{
+		const uint32_t* corners = rangeCorners.data() + rangeOffsets[range];
+		const size_t cornerCount = rangeOffsets[range + 1] - rangeOffsets[range];
+		const size_t firstPosition = range * positionsPerRange;
+
+		/*Sort the corners of the range by position, keeping their order at each position*/
+		std::vector<uint32_t> positionStarts(positionsPerRange + 1, 0);
+
+		for (size_t item = 0; item < cornerCount; item++)
+		{
+			positionStarts[positionRemap[indices[corners[item]]] - firstPosition + 1]++;
+		}
+
+		for (size_t position = 0; position < positionsPerRange; position++)
+		{
+			positionStarts[position + 1] += positionStarts[position];
+		}
+
+		std::vector<uint32_t> sortedCorners(cornerCount);
+		std::vector<uint32_t> positionEnds(positionStarts.begin(), positionStarts.end() - 1);
+
+		for (size_t item = 0; item < cornerCount; item++)
+		{
+			sortedCorners[positionEnds[positionRemap[indices[corners[item]]] - firstPosition]++] = corners[item];
+		}
+
+		std::vector<NormalAssignment> assignments;
+
+		for (size_t position = 0; position < positionsPerRange; position++)
+		{
+			if (positionStarts[position + 1] > positionStarts[position])
+			{
+				smoothPosition(&sortedCorners[positionStarts[position]], positionStarts[position + 1] - positionStarts[position], triangles, vertices, indices, assignments, results[range]);
+			}
+		}
+	});
+
+	/*Append the vertices the creases added, range by range*/
+	std::vector<size_t> addedOffsets(normalBucketCount);
+	size_t vertexCount = vertices.size();
+	size_t generatedCount = 0;
+
+	for (unsigned int range = 0; range < normalBucketCount; range++)
+	{
+		addedOffsets[range] = vertexCount;
+		vertexCount += results[range].addedVertices.size();
+		generatedCount += results[range].generatedCount;
+	}
+
+	vertices.resize(vertexCount);
+
+	forEachTask(pool, normalBucketCount, [&](size_t range)
+	{
+		const NormalRangeResult& result = results[range];
+
+		std::copy(result.addedVertices.begin(), result.addedVertices.end(), vertices.begin() + addedOffsets[range]);
+
+		for (const std::pair<uint32_t, uint32_t>& addedCorner : result.addedCorners)
+		{
+			indices[addedCorner.first] = static_cast<uint32_t>(addedOffsets[range] + addedCorner.second);
+		}
+	});
+
+	return generatedCount;
+}
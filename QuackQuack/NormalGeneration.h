@@ -0,0 +1,34 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+#include "ThreadPool.h"
+
+/*
+	Smooth normals for vertices which were imported without one.
+
+	The normal of a corner is the sum of the normals of the triangles around its position, each
+	weighted by the angle the triangle has at that position, so the result does not depend on how
+	the surface was triangulated. Triangles whose normals differ by more than the crease angle are
+	left out of each other's sums, so hard edges stay hard. Vertices whose corners end up with
+	different normals are duplicated, vertices which already have a normal are left alone.
+
+	Corners are grouped by position rather than by vertex, so vertices which only differ in their
+	texture coordinates are smoothed together and texture seams do not show in the lighting.
+*/
+
+/*True if any vertex has no normal, so generateNormals has something to do*/
+bool hasMissingNormals(const std::vector<Vertex>& vertices);
+
+/*
+	Gives every vertex without a normal the smooth normal of its corners, adding vertices where
+	creases split them. creaseAngle is in degrees. Returns the amount of vertices which got a
+	normal, including the added ones.
+
+	The triangles are processed in blocks and the corners in ranges of positions on the pool if
+	there is one. Each range owns the vertices at its positions, so no two tasks write the same
+	data and no atomics are needed. The result does not depend on the amount of threads.
+*/
+size_t generateNormals(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float creaseAngle, ThreadPool* pool);
@@ -0,0 +1,340 @@
+#include "OBJNumberParsing.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <cmath>
+#include <string>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define OBJ_NUMBER_PARSING_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/*Every power of ten which a double represents exactly*/
+static const double exactDoublePowersOfTen[23] =
+{
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*Every power of ten which a float represents exactly*/
+static const float exactFloatPowersOfTen[11] =
+{
+	1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f
+};
+
+/*Index of the lowest set bit, the mask must not be 0*/
+static unsigned int lowestSetBit(uint32_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return static_cast<unsigned int>(index);
+#else
+	return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+static bool isDigit(const char character)
+{
+	return (character >= '0') && (character <= '9');
+}
+
+/*Amount of decimal digits at the start of the range*/
+static size_t countDigits(const char* cursor, const char* end)
+{
+	size_t count = 0;
+
+#ifdef OBJ_NUMBER_PARSING_SSE2
+	const __m128i zeros = _mm_set1_epi8('0');
+	const __m128i nines = _mm_set1_epi8('9');
+
+	/*Only whole blocks inside the range are loaded, a mapped file may end right at a page boundary*/
+	while (end - (cursor + count) >= 16)
+	{
+		const __m128i characters = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cursor + count));
+
+		/*Bytes above 127 are negative as signed bytes, so they also count as below '0'*/
+		const __m128i notDigits = _mm_or_si128(_mm_cmplt_epi8(characters, zeros), _mm_cmpgt_epi8(characters, nines));
+		const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(notDigits));
+
+		if (mask != 0)
+		{
+			return count + lowestSetBit(mask);
+		}
+
+		count += 16;
+	}
+#endif
+
+	while ((cursor + count < end) && isDigit(cursor[count]))
+	{
+		count++;
+	}
+
+	return count;
+}
+
+/*Converts eight digits with a few multiplications instead of one per digit, the characters are read as one little endian word*/
+static uint32_t parseEightDigits(const char* digits)
+{
+	uint64_t value;
+	std::memcpy(&value, digits, sizeof(value));
+
+	value -= 0x3030303030303030ull;
+
+	/*Combine neighbouring digits into pairs, then the pairs into groups of four, then both groups*/
+	value = (value * 10) + (value >> 8);
+	value = (((value & 0x000000FF000000FFull) * (100 + (1000000ull << 32))) + (((value >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))) >> 32;
+
+	return static_cast<uint32_t>(value);
+}
+
+/*Appends count digits to the value, the caller makes sure the result fits*/
+static uint64_t accumulateDigits(uint64_t value, const char* digits, size_t count)
+{
+	while (count >= 8)
+	{
+		value = (value * 100000000ull) + parseEightDigits(digits);
+		digits += 8;
+		count -= 8;
+	}
+
+	while (count > 0)
+	{
+		value = (value * 10) + static_cast<uint64_t>(*digits - '0');
+		digits++;
+		count--;
+	}
+
+	return value;
+}
+
+/*Amount of '0' characters at the start of the digits*/
+static size_t countLeadingZeros(const char* digits, size_t count)
+{
+	size_t zeros = 0;
+
+	while ((zeros < count) && (digits[zeros] == '0'))
+	{
+		zeros++;
+	}
+
+	return zeros;
+}
+
+/*The general conversion for everything the fast paths cannot do exactly*/
+static float convertWithStrtof(const char* begin, const char* end)
+{
+	const size_t length = end - begin;
+
+	/*The number has been validated already, so strtof consumes exactly these characters*/
+	char buffer[128];
+
+	if (length < sizeof(buffer))
+	{
+		std::memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+
+		return strtof(buffer, nullptr);
+	}
+
+	return strtof(std::string(begin, end).c_str(), nullptr);
+}
+
+/*
+	Converts mantissa * 10^exponent to the nearest float, returns false if no fast path applies.
+
+	A single float operation on exact operands is correctly rounded, so small mantissas with small
+	exponents need nothing else. Otherwise the value is correctly rounded to a double first. Rounding
+	that double to float gives the same float as rounding the exact value, unless the double landed
+	precisely halfway between two floats, in which case the exact value could be on either side.
+*/
+static bool convertFast(uint64_t mantissa, int exponent, float& value)
+{
+	if ((mantissa <= (1ull << 24)) && (exponent >= -10) && (exponent <= 10))
+	{
+		const float floatMantissa = static_cast<float>(mantissa);
+		value = (exponent < 0) ? (floatMantissa / exactFloatPowersOfTen[-exponent]) : (floatMantissa * exactFloatPowersOfTen[exponent]);
+
+		return true;
+	}
+
+	if ((mantissa <= (1ull << 53)) && (exponent >= -22) && (exponent <= 22))
+	{
+		const double doubleMantissa = static_cast<double>(mantissa);
+		const double rounded = (exponent < 0) ? (doubleMantissa / exactDoublePowersOfTen[-exponent]) : (doubleMantissa * exactDoublePowersOfTen[exponent]);
+
+		/*Subnormal and overflowing floats round at other bit positions, leave them to strtof*/
+		if ((rounded < FLT_MIN) || (rounded > FLT_MAX))
+		{
+			return false;
+		}
+
+		uint64_t bits;
+		std::memcpy(&bits, &rounded, sizeof(bits));
+
+		/*A double has 29 more mantissa bits than a float, the halfway point sets only the highest of them*/
+		const uint64_t droppedBits = bits & ((1ull << 29) - 1);
+
+		if (droppedBits == (1ull << 28))
+		{
+			return false;
+		}
+
+		value = static_cast<float>(rounded);
+
+		return true;
+	}
+
+	return false;
+}
+
+bool parseObjFloat(const char*& cursor, const char* end, float& value)
+{
+	const char* position = cursor;
+
+	bool negative = false;
+
+	if ((position < end) && (*position == '-' || *position == '+'))
+	{
+		negative = (*position == '-');
+		position++;
+	}
+
+	const char* const integerDigits = position;
+	const size_t integerDigitCount = countDigits(position, end);
+	position += integerDigitCount;
+
+	const char* fractionDigits = position;
+	size_t fractionDigitCount = 0;
+
+	if ((position < end) && (*position == '.'))
+	{
+		fractionDigits = position + 1;
+		fractionDigitCount = countDigits(fractionDigits, end);
+		position = fractionDigits + fractionDigitCount;
+	}
+
+	/*A sign or a point on its own is not a number*/
+	if (integerDigitCount + fractionDigitCount == 0)
+	{
+		return false;
+	}
+
+	/*The exponent only belongs to the number if at least one digit follows*/
+	int64_t exponent = 0;
+	bool exponentTooLarge = false;
+
+	if ((position < end) && (*position == 'e' || *position == 'E'))
+	{
+		const char* exponentPosition = position + 1;
+		bool negativeExponent = false;
+
+		if ((exponentPosition < end) && (*exponentPosition == '-' || *exponentPosition == '+'))
+		{
+			negativeExponent = (*exponentPosition == '-');
+			exponentPosition++;
+		}
+
+		const size_t exponentDigitCount = countDigits(exponentPosition, end);
+
+		if (exponentDigitCount > 0)
+		{
+			const size_t exponentZeros = countLeadingZeros(exponentPosition, exponentDigitCount);
+
+			/*Anything beyond a few digits is far outside the float range, strtof deals with it*/
+			exponentTooLarge = (exponentDigitCount - exponentZeros) > 6;
+
+			if (!exponentTooLarge)
+			{
+				exponent = static_cast<int64_t>(accumulateDigits(0, exponentPosition, exponentDigitCount));
+				exponent = negativeExponent ? -exponent : exponent;
+			}
+
+			position = exponentPosition + exponentDigitCount;
+		}
+	}
+
+	const char* const numberEnd = position;
+
+	/*Leading zeros do not count towards the 19 digits which fit into the 64-bit mantissa*/
+	size_t significantDigitCount = integerDigitCount + fractionDigitCount;
+	const size_t integerZeros = countLeadingZeros(integerDigits, integerDigitCount);
+
+	significantDigitCount -= integerZeros;
+
+	if (integerZeros == integerDigitCount)
+	{
+		significantDigitCount -= countLeadingZeros(fractionDigits, fractionDigitCount);
+	}
+
+	bool converted = false;
+
+	if (!exponentTooLarge && (significantDigitCount <= 19))
+	{
+		uint64_t mantissa = accumulateDigits(0, integerDigits, integerDigitCount);
+		mantissa = accumulateDigits(mantissa, fractionDigits, fractionDigitCount);
+
+		if (mantissa == 0)
+		{
+			value = 0.0f;
+			converted = true;
+		}
+		else
+		{
+			converted = convertFast(mantissa, static_cast<int>(exponent - static_cast<int64_t>(fractionDigitCount)), value);
+		}
+
+		value = (converted && negative) ? -value : value;
+	}
+
+	if (!converted)
+	{
+		value = convertWithStrtof(cursor, numberEnd);
+	}
+
+	cursor = numberEnd;
+
+	return true;
+}
+
+bool parseObjInteger(const char*& cursor, const char* end, int64_t& value)
+{
+	const char* position = cursor;
+
+	bool negative = false;
+
+	if ((position < end) && (*position == '-' || *position == '+'))
+	{
+		negative = (*position == '-');
+		position++;
+	}
+
+	const size_t digitCount = countDigits(position, end);
+
+	if (digitCount == 0)
+	{
+		return false;
+	}
+
+	/*18 digits always fit into a signed 64-bit value*/
+	if ((digitCount - countLeadingZeros(position, digitCount)) > 18)
+	{
+		value = negative ? INT64_MIN : INT64_MAX;
+	}
+	else
+	{
+		const int64_t magnitude = static_cast<int64_t>(accumulateDigits(0, position, digitCount));
+		value = negative ? -magnitude : magnitude;
+	}
+
+	cursor = position + digitCount;
+
+	return true;
+}
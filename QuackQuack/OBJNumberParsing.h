@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+	Number conversion for the obj readers, working directly on the bytes of the file.
+
+	The digits of a number are located sixteen characters at a time with SSE2 and converted
+	eight at a time. Floats which fit the exact fast paths are computed from the decimal mantissa
+	and a power of ten, the rare remaining ones are handed to strtof, so the result is always the
+	correctly rounded float strtof would produce.
+
+	Both functions expect cursor to point at the first character of the number, on success the
+	cursor is moved past it. On failure the cursor is left unchanged.
+*/
+
+/*Parses [sign] digits [. digits] [e|E [sign] digits], at least one digit has to be present in the mantissa*/
+bool parseObjFloat(const char*& cursor, const char* end, float& value);
+
+/*Parses [sign] digits. Values too large for 64 bits saturate to the largest representable one*/
+bool parseObjInteger(const char*& cursor, const char* end, int64_t& value);
@@ -0,0 +1,1070 @@
+#include "OBJReaderBenchmark.h"
+
+#include "OBJReaderClass.h"
+#include "OBJNumberParsing.h"
+#include "CompactVertex.h"
+#include "SpatialChunks.h"
+#include "NormalGeneration.h"
+#include "VertexWelding.h"
+#include "MeshBatch.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <functional>
+#include <array>
+#include <cmath>
+
+#include <gtc/matrix_transform.hpp>
+
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+
+/*Human readable names for the read modes*/
+static const char* readModeName(const OBJReadMode mode)
+{
+	switch (mode)
+	{
+	case OBJReadMode::Stream:
+		return "Stream";
+	case OBJReadMode::MemoryMapped:
+		return "MemoryMapped";
+	case OBJReadMode::Parallel:
+		return "Parallel";
+	}
+
+	return "Unknown";
+}
+
+/*The most memory the process has used so far, the operating system offers no way to reset it*/
+static size_t peakWorkingSetBytes()
+{
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+
+	return static_cast<size_t>(counters.PeakWorkingSetSize);
+}
+
+/*
+	Two meshes are the same if they describe the same triangles, split into the same submeshes, objects and materials.
+	The vertex arrays themselves may differ, deduplicating by indices keeps corners apart which reference equal values through different indices.
+*/
+static bool meshesMatch(const OBJReaderClass& reference, const OBJReaderClass& other)
+{
+	const bool sameSubmeshes = std::equal(reference.getSubmeshes().begin(), reference.getSubmeshes().end(), other.getSubmeshes().begin(), other.getSubmeshes().end(), [](const Submesh& a, const Submesh& b)
+	{
+		return a.indexOffset == b.indexOffset && a.indexCount == b.indexCount && a.material == b.material && a.object == b.object && a.minimum == b.minimum && a.maximum == b.maximum;
+	});
+
+	const bool sameMaterials = std::equal(reference.getMaterials().begin(), reference.getMaterials().end(), other.getMaterials().begin(), other.getMaterials().end(), [](const Material& a, const Material& b)
+	{
+		return a.ambient == b.ambient && a.diffuse == b.diffuse && a.specular == b.specular;
+	});
+
+	const bool sameObjects = std::equal(reference.getObjects().begin(), reference.getObjects().end(), other.getObjects().begin(), other.getObjects().end(), [](const MeshObject& a, const MeshObject& b)
+	{
+		return a.minimum == b.minimum && a.maximum == b.maximum;
+	});
+
+	if (!sameSubmeshes || !sameMaterials || !sameObjects || reference.getObjectNames() != other.getObjectNames())
+	{
+		return false;
+	}
+
+	const std::vector<Vertex>& referenceVertices = reference.getVertices();
+	const std::vector<uint32_t>& referenceIndices = reference.getIndices();
+	const std::vector<Vertex>& otherVertices = other.getVertices();
+	const std::vector<uint32_t>& otherIndices = other.getIndices();
+
+	if (referenceIndices.size() != otherIndices.size())
+	{
+		return false;
+	}
+
+	for (size_t index = 0; index < referenceIndices.size(); index++)
+	{
+		if (!(referenceVertices[referenceIndices[index]] == otherVertices[otherIndices[index]]))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*The hash the vertex map used before it covered every float, kept to show how the bucket load changed*/
+struct LegacyKeyHasher
+{
+	std::size_t operator()(const Vertex& v) const
+	{
+		return ((std::hash<float>()(v.pos.x) ^ (std::hash<float>()(v.texCoord.y) << 1)) >> 1) ^ (std::hash<float>()(v.norm.z) << 1);
+	}
+};
+
+/*Inserts every triangle vertex into a map with the given hasher, returns the seconds it took and the bucket statistics*/
+template<typename Hasher>
+static double measureVertexHash(const std::vector<Vertex>& triangleVertices, HashTableStatistics& statistics)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	std::unordered_map<Vertex, uint32_t, Hasher> verticesToIndexesMap;
+
+	for (const Vertex& vertex : triangleVertices)
+	{
+		verticesToIndexesMap.emplace(vertex, static_cast<uint32_t>(verticesToIndexesMap.size()));
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+
+	statistics = collectBucketStatistics(verticesToIndexesMap);
+
+	return std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+}
+
+/*One line describing the occupancy of a hash table*/
+static void printHashStatistics(const char* name, double seconds, const HashTableStatistics& statistics)
+{
+	std::cout << std::setw(14) << name << ": "
+		<< std::fixed << std::setprecision(3) << seconds << " s, "
+		<< statistics.entryCount << " entries in " << statistics.occupiedBucketCount << "/" << statistics.bucketCount << " buckets, "
+		<< "largest bucket " << statistics.largestBucketSize << ", "
+		<< "probe length " << std::setprecision(2) << statistics.averageProbeLength << " avg / " << statistics.maximumProbeLength << " max" << std::endl;
+}
+
+/*Two meshes contain the same triangles, in any order. The optimization passes reorder triangles but never rotate their corners*/
+static bool sameTriangles(const OBJReaderClass& reference, const OBJReaderClass& other)
+{
+	typedef std::array<Vertex, 3> Triangle;
+
+	auto collectTriangles = [](const OBJReaderClass& reader)
+	{
+		std::vector<Triangle> triangles(reader.getIndices().size() / 3);
+
+		for (size_t triangle = 0; triangle < triangles.size(); triangle++)
+		{
+			for (unsigned int corner = 0; corner < 3; corner++)
+			{
+				triangles[triangle][corner] = reader.getVertices()[reader.getIndices()[triangle * 3 + corner]];
+			}
+		}
+
+		/*Any strict order over the bytes works for comparing the sorted lists*/
+		std::sort(triangles.begin(), triangles.end(), [](const Triangle& first, const Triangle& second) { return std::memcmp(first.data(), second.data(), sizeof(Triangle)) < 0; });
+
+		return triangles;
+	};
+
+	const std::vector<Triangle> referenceTriangles = collectTriangles(reference);
+	const std::vector<Triangle> otherTriangles = collectTriangles(other);
+
+	return (referenceTriangles.size() == otherTriangles.size()) && (std::memcmp(referenceTriangles.data(), otherTriangles.data(), referenceTriangles.size() * sizeof(Triangle)) == 0);
+}
+
+/*Human readable names for the deduplication methods*/
+static const char* deduplicationName(const OBJDeduplication deduplication)
+{
+	switch (deduplication)
+	{
+	case OBJDeduplication::VertexValues:
+		return "VertexValues";
+	case OBJDeduplication::IndexTriplets:
+		return "IndexTriplets";
+	}
+
+	return "Unknown";
+}
+
+/*Loads the file the requested amount of times, returns the fastest load and whether the first result equals the reference*/
+static bool measureLoad(const std::string& path, const OBJReaderOptions& options, unsigned int iterations, const OBJReaderClass& reference, double& bestSeconds)
+{
+	bool matchesReference = true;
+
+	for (unsigned int iteration = 0; iteration < iterations; iteration++)
+	{
+		const OBJReaderClass reader(path, options);
+		const OBJLoadStatistics statistics = reader.getLoadStatistics();
+
+		if (iteration == 0 || statistics.loadSeconds < bestSeconds)
+		{
+			bestSeconds = statistics.loadSeconds;
+		}
+
+		/*Only the first run needs to be compared, the others parse the same bytes*/
+		if (iteration == 0)
+		{
+			matchesReference = meshesMatch(reference, reader);
+		}
+	}
+
+	return matchesReference;
+}
+
+/*Options for a load which has to parse the obj file, the binary cache would skip the passes being measured*/
+static OBJReaderOptions parsingOptions()
+{
+	OBJReaderOptions options;
+	options.useMeshCache = false;
+
+	return options;
+}
+
+/*Axis aligned bounds of the vertex positions, a point at the origin if there are none*/
+static void positionBounds(const std::vector<Vertex>& vertices, glm::vec3& minimum, glm::vec3& maximum)
+{
+	minimum = glm::vec3(0.0f);
+	maximum = glm::vec3(0.0f);
+
+	if (!vertices.empty())
+	{
+		minimum = maximum = vertices[0].pos;
+	}
+
+	for (const Vertex& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.pos);
+		maximum = glm::max(maximum, vertex.pos);
+	}
+}
+
+/*Doubles the threads from one up to the amount of hardware threads*/
+static std::vector<unsigned int> scalingThreadCounts(unsigned int hardwareThreads)
+{
+	std::vector<unsigned int> threadCounts;
+
+	for (unsigned int threadCount = 1; threadCount < hardwareThreads; threadCount *= 2)
+	{
+		threadCounts.push_back(threadCount);
+	}
+
+	threadCounts.push_back(hardwareThreads);
+
+	return threadCounts;
+}
+
+/*Throughput of every read mode*/
+static void benchmarkReadModes(const std::string& path, unsigned int iterations, const OBJReaderClass& reference, double megabytes)
+{
+	const OBJReadMode modes[] = { OBJReadMode::Stream, OBJReadMode::MemoryMapped, OBJReadMode::Parallel };
+
+	for (const OBJReadMode mode : modes)
+	{
+		OBJReaderOptions options = parsingOptions();
+		options.readMode = mode;
+
+		double bestSeconds = 0.0;
+		const bool matchesReference = measureLoad(path, options, iterations, reference, bestSeconds);
+
+		std::cout << std::setw(14) << readModeName(mode) << ": "
+			<< std::fixed << std::setprecision(1) << (megabytes / bestSeconds) << " MB/s, "
+			<< std::setprecision(3) << bestSeconds << " s"
+			<< (matchesReference ? "" : " (OUTPUT DIFFERS FROM STREAM READER)") << std::endl;
+	}
+}
+
+/*
+	The parallel reader on a file whose o, g and usemtl lines come after the last face of the first chunk,
+	so they only take effect in the next one. The serial reader gives the reference.
+*/
+static void benchmarkChunkBoundaries(const std::string& path)
+{
+	const std::string boundaryPath = path + ".boundaries.obj";
+
+	{
+		std::ofstream file(boundaryPath, std::ios::binary | std::ios::trunc);
+		const size_t facesPerHalf = 128 * 1024; // Two megabytes each, which two threads split into four chunks with a boundary in the middle
+
+		file << "v 0 0 0\nv 1 0 0\nv 0 1 0\nvn 0 0 1\no first\nusemtl first\n"; // With a normal the load does not generate any for the shared vertices
+
+		for (size_t face = 0; face < facesPerHalf; face++)
+		{
+			file << "f 1//1 2//1 3//1\n";
+		}
+
+		/*The records sit in front of the comments the middle of the file falls into, which end the first chunk*/
+		file << "o second\ng part\nusemtl second\n";
+
+		for (unsigned int comment = 0; comment < 64; comment++)
+		{
+			file << "# chunk boundary\n";
+		}
+
+		for (size_t face = 0; face < facesPerHalf; face++)
+		{
+			file << "f 3//1 2//1 1//1\n";
+		}
+	}
+
+	const OBJReaderClass serial(boundaryPath, parsingOptions());
+
+	OBJReaderOptions options = parsingOptions();
+	options.readMode = OBJReadMode::Parallel;
+	options.threadCount = 2;
+
+	const OBJReaderClass parallel(boundaryPath, options);
+
+	std::remove(boundaryPath.c_str());
+
+	std::cout << std::setw(14) << "Boundaries" << ": " << parallel.getSubmeshes().size() << " submeshes"
+		<< (meshesMatch(serial, parallel) ? "" : " (OUTPUT DIFFERS FROM STREAM READER)") << std::endl;
+}
+
+/*Only the step which finds the unique vertices, on the same parsed data, followed by the occupancy of the tables it uses*/
+static void benchmarkDeduplication(const std::string& path, unsigned int iterations, const OBJReaderClass& reference)
+{
+	const OBJDeduplication deduplications[] = { OBJDeduplication::VertexValues, OBJDeduplication::IndexTriplets };
+
+	std::cout << "Vertex deduplication:" << std::endl;
+
+	for (const OBJDeduplication deduplication : deduplications)
+	{
+		OBJReaderOptions options = parsingOptions();
+		options.readMode = OBJReadMode::MemoryMapped;
+		options.deduplication = deduplication;
+
+		double bestSeconds = 0.0;
+		bool matchesReference = true;
+		size_t uniqueVertexCount = 0;
+
+		for (unsigned int iteration = 0; iteration < iterations; iteration++)
+		{
+			const OBJReaderClass reader(path, options);
+			const double indexingSeconds = reader.getLoadStatistics().indexingSeconds;
+
+			if (iteration == 0 || indexingSeconds < bestSeconds)
+			{
+				bestSeconds = indexingSeconds;
+			}
+
+			if (iteration == 0)
+			{
+				matchesReference = meshesMatch(reference, reader);
+				uniqueVertexCount = reader.getVertices().size();
+			}
+		}
+
+		std::cout << std::setw(14) << deduplicationName(deduplication) << ": "
+			<< std::fixed << std::setprecision(3) << bestSeconds << " s, "
+			<< uniqueVertexCount << " unique vertices for " << reference.getIndices().size() << " indices"
+			<< (matchesReference ? "" : " (OUTPUT DIFFERS FROM STREAM READER)") << std::endl;
+	}
+
+	/*The vertex hashes on the triangle vertices of the reference mesh, and the index triplet table for comparison*/
+	std::vector<Vertex> triangleVertices;
+	triangleVertices.reserve(reference.getIndices().size());
+
+	for (const uint32_t index : reference.getIndices())
+	{
+		triangleVertices.push_back(reference.getVertices()[index]);
+	}
+
+	std::cout << "Deduplication tables:" << std::endl;
+
+	HashTableStatistics legacyStatistics;
+	const double legacySeconds = measureVertexHash<LegacyKeyHasher>(triangleVertices, legacyStatistics);
+	printHashStatistics("LegacyHash", legacySeconds, legacyStatistics);
+
+	HashTableStatistics fullWidthStatistics;
+	const double fullWidthSeconds = measureVertexHash<KeyHasher>(triangleVertices, fullWidthStatistics);
+	printHashStatistics("KeyHasher", fullWidthSeconds, fullWidthStatistics);
+
+	OBJReaderOptions options = parsingOptions();
+	options.deduplication = OBJDeduplication::IndexTriplets;
+	options.collectHashStatistics = true;
+
+	const OBJReaderClass reader(path, options);
+	printHashStatistics("IndexTriplets", reader.getLoadStatistics().indexingSeconds, reader.getLoadStatistics().hashStatistics);
+}
+
+/*A launch without the binary cache, which parses the file and writes the cache, against launches which load the cache*/
+static void benchmarkMeshCache(const std::string& path, unsigned int iterations, const OBJReaderClass& reference)
+{
+	std::remove(meshCachePath(path).c_str());
+
+	const OBJReaderClass coldReader(path);
+
+	double warmSeconds = 0.0;
+	const bool matchesReference = measureLoad(path, OBJReaderOptions(), iterations, reference, warmSeconds);
+
+	/*The cold run left the cache in place, check it was actually used*/
+	const bool warmFromCache = OBJReaderClass(path).getLoadStatistics().loadedFromCache;
+
+	std::cout << "Mesh cache:" << std::endl
+		<< std::setw(14) << "Cold" << ": " << std::fixed << std::setprecision(3) << coldReader.getLoadStatistics().loadSeconds << " s (parse and write the cache)" << std::endl
+		<< std::setw(14) << "Warm" << ": " << std::fixed << std::setprecision(3) << warmSeconds << " s"
+		<< (warmFromCache ? "" : " (CACHE WAS NOT USED)")
+		<< (matchesReference ? "" : " (OUTPUT DIFFERS FROM STREAM READER)") << std::endl;
+}
+
+/*The mtl files and the sort of the triangles into one submesh per object and material, which the draws are culled and switched by*/
+static void benchmarkSubmeshes(const std::string& path)
+{
+	const OBJReaderClass reader(path, parsingOptions());
+
+	std::cout << "Submeshes: " << std::fixed << std::setprecision(3) << reader.getLoadStatistics().submeshSeconds << " s, "
+		<< reader.getObjects().size() << " objects and " << reader.getMaterials().size() << " materials in " << reader.getSubmeshes().size() << " submeshes" << std::endl;
+}
+
+/*
+	The optimization passes, measured on the same import with and without them. The chunks main.cpp uses
+	give the triangles their final order, so the metrics are reported for that order as well
+*/
+static void benchmarkOptimization(const std::string& path)
+{
+	OBJReaderOptions options = parsingOptions();
+
+	const OBJReaderClass unoptimized(path, options);
+
+	options.optimizeMesh = true;
+
+	const OBJReaderClass optimized(path, options);
+
+	options.trianglesPerChunk = 1024;
+
+	const OBJReaderClass chunked(path, options);
+
+	const VertexCacheStatistics cacheBefore = analyzeVertexCache(unoptimized.getIndices(), unoptimized.getVertices().size());
+	const VertexCacheStatistics cacheAfter = analyzeVertexCache(optimized.getIndices(), optimized.getVertices().size());
+	const VertexCacheStatistics cacheChunked = analyzeVertexCache(chunked.getIndices(), chunked.getVertices().size());
+	const OverdrawStatistics overdrawBefore = analyzeOverdraw(unoptimized.getIndices(), unoptimized.getVertices());
+	const OverdrawStatistics overdrawAfter = analyzeOverdraw(optimized.getIndices(), optimized.getVertices());
+	const OverdrawStatistics overdrawChunked = analyzeOverdraw(chunked.getIndices(), chunked.getVertices());
+
+	std::cout << "Mesh optimization: " << std::fixed << std::setprecision(3) << optimized.getLoadStatistics().optimizationSeconds << " s"
+		<< (sameTriangles(unoptimized, optimized) && sameTriangles(unoptimized, chunked) ? "" : " (TRIANGLES DIFFER FROM THE IMPORT)") << std::endl
+		<< std::setw(14) << "ACMR" << ": " << cacheBefore.acmr << " -> " << cacheAfter.acmr << ", " << cacheChunked.acmr << " in chunks of " << options.trianglesPerChunk << std::endl
+		<< std::setw(14) << "ATVR" << ": " << cacheBefore.atvr << " -> " << cacheAfter.atvr << ", " << cacheChunked.atvr << " in chunks of " << options.trianglesPerChunk << std::endl
+		<< std::setw(14) << "Overdraw" << ": " << overdrawBefore.overdraw << " -> " << overdrawAfter.overdraw << ", " << overdrawChunked.overdraw << " in chunks of " << options.trianglesPerChunk << std::endl;
+}
+
+/*The detail levels, with the time it takes to build them*/
+static void benchmarkDetailLevels(const std::string& path)
+{
+	OBJReaderOptions options = parsingOptions();
+	options.optimizeMesh = true;
+	options.lodLevelCount = 4;
+
+	const OBJReaderClass reader(path, options);
+
+	std::cout << "Detail levels: " << std::fixed << std::setprecision(3) << reader.getLoadStatistics().simplificationSeconds << " s" << std::endl;
+
+	for (size_t lod = 0; lod < reader.getLods().size(); lod++)
+	{
+		std::cout << std::setw(12) << "LOD " << lod << ": " << std::setw(9) << reader.getLods()[lod].indexCount / 3 << " triangles in " << reader.getLods()[lod].submeshCount << " submeshes, error "
+			<< std::scientific << std::setprecision(2) << reader.getLods()[lod].error << std::fixed << std::endl;
+	}
+}
+
+/*Sizes of the meshlets, and how many of them the normal cones can cull when looking at the mesh from the six axis directions*/
+static void benchmarkMeshlets(const std::string& path)
+{
+	OBJReaderOptions options = parsingOptions();
+	options.optimizeMesh = true;
+	options.buildMeshlets = true;
+
+	const OBJReaderClass reader(path, options);
+	const MeshletData& meshlets = reader.getMeshlets();
+
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+	positionBounds(reader.getVertices(), minimum, maximum);
+
+	const glm::vec3 center = 0.5f * (minimum + maximum);
+	const float viewDistance = 2.0f * glm::length(maximum - minimum) + 1.0f;
+
+	size_t culledMeshlets = 0;
+
+	for (unsigned int view = 0; view < 6; view++)
+	{
+		glm::vec3 direction(0.0f);
+		direction[view / 2] = (view % 2) ? -1.0f : 1.0f;
+
+		for (size_t meshlet = 0; meshlet < meshlets.size(); meshlet++)
+		{
+			culledMeshlets += meshletFacesAway(meshlets, meshlet, center + direction * viewDistance) ? 1 : 0;
+		}
+	}
+
+	const size_t meshletCount = (std::max)(meshlets.size(), static_cast<size_t>(1));
+
+	std::cout << "Meshlets: " << std::fixed << std::setprecision(3) << reader.getLoadStatistics().meshletSeconds << " s" << std::endl
+		<< std::setw(14) << "Count" << ": " << meshlets.size() << std::endl
+		<< std::setw(14) << "Vertices" << ": " << std::setprecision(1) << static_cast<float>(meshlets.vertices.size()) / meshletCount << " per meshlet" << std::endl
+		<< std::setw(14) << "Triangles" << ": " << static_cast<float>(meshlets.triangles.size() / 3) / meshletCount << " per meshlet" << std::endl
+		<< std::setw(14) << "Back-facing" << ": " << 100.0f * culledMeshlets / (6 * meshletCount) << "% from the axis views" << std::endl
+		<< std::setprecision(3);
+}
+
+/*Views standing just outside the bounds and looking at random points inside them, so most of them see part of the mesh*/
+static std::vector<glm::mat4> randomViews(const std::vector<Vertex>& vertices, unsigned int viewCount)
+{
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+	positionBounds(vertices, minimum, maximum);
+
+	const glm::vec3 center = 0.5f * (minimum + maximum);
+	const float radius = (std::max)(0.5f * glm::length(maximum - minimum), 1e-6f);
+
+	std::vector<glm::mat4> views(viewCount);
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	for (glm::mat4& view : views)
+	{
+		glm::vec3 direction;
+
+		do
+		{
+			direction = glm::vec3(unit(random), unit(random), unit(random));
+		} while (glm::length(direction) < 0.1f || glm::length(direction) > 1.0f);
+
+		const glm::vec3 eye = center + glm::normalize(direction) * (1.2f * radius);
+		const glm::vec3 target = center + glm::vec3(unit(random), unit(random), unit(random)) * (0.5f * radius);
+		const glm::vec3 up = (std::abs(glm::normalize(target - eye).z) > 0.9f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+		glm::mat4 projection = glm::perspective(glm::radians(45.0f), 4.0f / 3.0f, 0.01f * radius, 10.0f * radius);
+		projection[1][1] *= -1; // Same as the renderer
+
+		view = projection * glm::lookAt(eye, target, up);
+	}
+
+	return views;
+}
+
+/*Cost of the frustum test against the amount of chunks, and the share of the triangles which are still submitted, which is what the GPU saves*/
+static void benchmarkFrustumCulling(const std::string& path, unsigned int iterations)
+{
+	OBJReaderOptions options = parsingOptions();
+	options.optimizeMesh = true;
+
+	const OBJReaderClass reader(path, options);
+
+	const unsigned int viewCount = 64;
+	const std::vector<glm::mat4> views = randomViews(reader.getVertices(), viewCount);
+
+	std::cout << "Frustum culling: " << viewCount << " views" << std::endl;
+
+	const size_t triangleCount = reader.getIndices().size() / 3;
+	const unsigned int chunkSizes[] = { 256, 1024, 4096, 16384, 65536 };
+
+	for (const unsigned int trianglesPerChunk : chunkSizes)
+	{
+		std::vector<uint32_t> indices = reader.getIndices();
+		std::vector<MeshLod> lods;
+		SpatialChunks chunks;
+
+		const auto buildStartTime = std::chrono::high_resolution_clock::now();
+
+		buildSpatialChunks(reader.getVertices(), indices, lods, reader.getSubmeshes(), trianglesPerChunk, chunks);
+
+		const auto buildEndTime = std::chrono::high_resolution_clock::now();
+
+		/*Both versions have to agree on every view*/
+		std::vector<DrawRange> ranges;
+		std::vector<DrawRange> scalarRanges;
+		bool matchesScalar = true;
+		size_t rangeCount = 0;
+		size_t drawnTriangles = 0;
+
+		for (const glm::mat4& view : views)
+		{
+			ranges.clear();
+			scalarRanges.clear();
+
+			cullChunks(chunks, 0, static_cast<uint32_t>(chunks.size()), view, ranges);
+			cullChunksScalar(chunks, 0, static_cast<uint32_t>(chunks.size()), view, scalarRanges);
+
+			matchesScalar = matchesScalar && ranges.size() == scalarRanges.size() &&
+				std::equal(ranges.begin(), ranges.end(), scalarRanges.begin(), [](const DrawRange& a, const DrawRange& b) { return a.indexOffset == b.indexOffset && a.indexCount == b.indexCount; });
+
+			rangeCount += ranges.size();
+
+			for (const DrawRange& range : ranges)
+			{
+				drawnTriangles += range.indexCount / 3;
+			}
+		}
+
+		/*The test takes microseconds, so every run culls all views many times and the fastest run counts*/
+		const unsigned int repeats = 100;
+		double bestSeconds = 0.0;
+		double bestScalarSeconds = 0.0;
+
+		for (unsigned int iteration = 0; iteration < (std::max)(iterations, 1u); iteration++)
+		{
+			const auto startTime = std::chrono::high_resolution_clock::now();
+
+			for (unsigned int repeat = 0; repeat < repeats; repeat++)
+			{
+				for (const glm::mat4& view : views)
+				{
+					ranges.clear();
+					cullChunks(chunks, 0, static_cast<uint32_t>(chunks.size()), view, ranges);
+				}
+			}
+
+			const auto scalarStartTime = std::chrono::high_resolution_clock::now();
+
+			for (unsigned int repeat = 0; repeat < repeats; repeat++)
+			{
+				for (const glm::mat4& view : views)
+				{
+					scalarRanges.clear();
+					cullChunksScalar(chunks, 0, static_cast<uint32_t>(chunks.size()), view, scalarRanges);
+				}
+			}
+
+			const auto endTime = std::chrono::high_resolution_clock::now();
+			const double seconds = std::chrono::duration<double, std::chrono::seconds::period>(scalarStartTime - startTime).count();
+			const double scalarSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - scalarStartTime).count();
+
+			bestSeconds = (iteration == 0) ? seconds : (std::min)(bestSeconds, seconds);
+			bestScalarSeconds = (iteration == 0) ? scalarSeconds : (std::min)(bestScalarSeconds, scalarSeconds);
+		}
+
+		const double cullsPerRun = static_cast<double>(repeats) * viewCount;
+
+		std::cout << std::setw(8) << trianglesPerChunk << " triangles per chunk: " << std::setw(6) << chunks.size() << " chunks, built in "
+			<< std::fixed << std::setprecision(3) << std::chrono::duration<double, std::chrono::seconds::period>(buildEndTime - buildStartTime).count() << " s, "
+			<< std::setprecision(2) << 1000000.0 * bestSeconds / cullsPerRun << " us per cull (scalar " << 1000000.0 * bestScalarSeconds / cullsPerRun << " us), "
+			<< std::setprecision(1) << static_cast<double>(rangeCount) / viewCount << " draws, "
+			<< 100.0 * drawnTriangles / ((std::max)(triangleCount, static_cast<size_t>(1)) * viewCount) << "% of the triangles drawn"
+			<< (matchesScalar ? "" : " (SIMD DIFFERS FROM SCALAR)") << std::endl;
+	}
+
+	std::cout << std::setprecision(3);
+}
+
+/*
+	Welding at tolerances relative to the size of the mesh. The smallest ones only catch rounding noise,
+	the larger ones start to merge vertices the mesh was built with
+*/
+static void benchmarkWelding(const OBJReaderClass& reference)
+{
+	const std::vector<Vertex>& vertices = reference.getVertices();
+
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+	positionBounds(vertices, minimum, maximum);
+
+	const float diagonal = glm::length(maximum - minimum);
+	const float relativeTolerances[] = { 1e-6f, 1e-5f, 1e-4f, 1e-3f };
+
+	std::cout << "Vertex welding: " << vertices.size() << " vertices" << std::endl;
+
+	for (const float relativeTolerance : relativeTolerances)
+	{
+		WeldTolerances tolerances;
+		tolerances.position = relativeTolerance * diagonal;
+
+		std::vector<Vertex> weldedVertices = vertices;
+		std::vector<uint32_t> weldedIndices = reference.getIndices();
+		std::vector<Submesh> weldedSubmeshes = reference.getSubmeshes();
+
+		const auto startTime = std::chrono::high_resolution_clock::now();
+
+		const WeldResult weld = weldVertices(weldedVertices, weldedIndices, weldedSubmeshes, tolerances);
+
+		const auto endTime = std::chrono::high_resolution_clock::now();
+
+		const size_t savedBytes = weld.mergedVertexCount * sizeof(Vertex) + weld.removedTriangleCount * 3 * sizeof(uint32_t);
+
+		std::cout << std::setw(14) << std::scientific << std::setprecision(0) << relativeTolerance << ": "
+			<< std::fixed << std::setprecision(3) << std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count() << " s, "
+			<< weld.mergedVertexCount << " vertices merged, " << weld.removedTriangleCount << " triangles collapsed, "
+			<< savedBytes / 1024 << " KB saved" << std::endl;
+	}
+}
+
+/*Memory of the compact vertex format, and the largest error the encoding introduces*/
+static void benchmarkCompactVertices(const OBJReaderClass& reference)
+{
+	const std::vector<Vertex>& vertices = reference.getVertices();
+
+	const VertexDecode decode = makeVertexDecode(vertices, VertexFormat::Compact);
+	const std::vector<CompactVertex> compactVertices = encodeCompactVertices(vertices, decode);
+
+	float positionError = 0.0f;
+	float normalError = 0.0f;
+	float textureCoordinateError = 0.0f;
+
+	for (size_t index = 0; index < vertices.size(); index++)
+	{
+		const Vertex decoded = decodeCompactVertex(compactVertices[index], decode);
+		const glm::vec3 positionDifference = glm::abs(decoded.pos - vertices[index].pos);
+		const glm::vec2 textureCoordinateDifference = glm::abs(decoded.texCoord - vertices[index].texCoord);
+
+		positionError = (std::max)(positionError, (std::max)(positionDifference.x, (std::max)(positionDifference.y, positionDifference.z)));
+		textureCoordinateError = (std::max)(textureCoordinateError, (std::max)(textureCoordinateDifference.x, textureCoordinateDifference.y));
+
+		/*Angle between the normals, meshes without normals are not measured*/
+		if (glm::length(vertices[index].norm) > 0.0f)
+		{
+			const float cosine = glm::dot(decoded.norm, glm::normalize(vertices[index].norm));
+			normalError = (std::max)(normalError, std::acos((std::min)(cosine, 1.0f)) * 57.2957795f);
+		}
+	}
+
+	const glm::vec3 extent = glm::vec3(decode.positionScale);
+	const float largestExtent = (std::max)(extent.x, (std::max)(extent.y, extent.z));
+	const size_t indexSize = (vertices.size() <= 65536) ? sizeof(uint16_t) : sizeof(uint32_t);
+
+	std::cout << "Compact vertices:" << std::endl
+		<< std::setw(14) << "Vertices" << ": " << vertices.size() * sizeof(Vertex) / 1024 << " KB -> " << vertices.size() * sizeof(CompactVertex) / 1024 << " KB" << std::endl
+		<< std::setw(14) << "Indices" << ": " << reference.getIndices().size() * sizeof(uint32_t) / 1024 << " KB -> " << reference.getIndices().size() * indexSize / 1024 << " KB" << std::endl
+		<< std::setw(14) << "Position" << ": " << std::scientific << std::setprecision(2) << positionError << " (" << ((largestExtent > 0.0f) ? positionError / largestExtent : 0.0f) << " of the bounds)" << std::endl
+		<< std::setw(14) << "Normal" << ": " << std::fixed << std::setprecision(4) << normalError << " degrees" << std::endl
+		<< std::setw(14) << "TexCoord" << ": " << std::scientific << std::setprecision(2) << textureCoordinateError << std::fixed << std::endl;
+}
+
+/*Scaling of the parallel reader with the amount of threads*/
+static void benchmarkParallelScaling(const std::string& path, unsigned int iterations, const OBJReaderClass& reference, double megabytes, const std::vector<unsigned int>& threadCounts)
+{
+	std::cout << "Parallel scaling:" << std::endl;
+
+	double singleThreadSeconds = 0.0;
+
+	for (const unsigned int threadCount : threadCounts)
+	{
+		OBJReaderOptions options = parsingOptions();
+		options.readMode = OBJReadMode::Parallel;
+		options.threadCount = threadCount;
+
+		double bestSeconds = 0.0;
+		const bool matchesReference = measureLoad(path, options, iterations, reference, bestSeconds);
+
+		if (threadCount == 1)
+		{
+			singleThreadSeconds = bestSeconds;
+		}
+
+		std::cout << std::setw(6) << threadCount << " threads: "
+			<< std::fixed << std::setprecision(1) << (megabytes / bestSeconds) << " MB/s, "
+			<< std::setprecision(3) << bestSeconds << " s, "
+			<< std::setprecision(2) << (singleThreadSeconds / bestSeconds) << "x"
+			<< (matchesReference ? "" : " (OUTPUT DIFFERS FROM STREAM READER)") << std::endl;
+	}
+}
+
+/*
+	Normal generation on the same thread counts, with the normals of the file removed. Every thread count
+	has to give the same mesh, and if the file had normals the generated ones are compared against them
+*/
+static void benchmarkNormalGeneration(const std::string& path, unsigned int iterations, const std::vector<unsigned int>& threadCounts)
+{
+	OBJReaderOptions options = parsingOptions();
+	options.generateNormals = false;
+
+	const OBJReaderClass reader(path, options);
+
+	std::vector<Vertex> withoutNormals = reader.getVertices();
+
+	for (Vertex& vertex : withoutNormals)
+	{
+		vertex.norm = glm::vec3(0.0f);
+	}
+
+	std::cout << "Normal generation: " << options.creaseAngle << " degree crease angle" << std::endl;
+
+	std::vector<Vertex> firstVertices;
+	std::vector<uint32_t> firstIndices;
+	double singleThreadNormalSeconds = 0.0;
+
+	for (const unsigned int threadCount : threadCounts)
+	{
+		ThreadPool pool(threadCount);
+
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+		size_t generatedCount = 0;
+		double bestSeconds = 0.0;
+
+		for (unsigned int iteration = 0; iteration < (std::max)(iterations, 1u); iteration++)
+		{
+			vertices = withoutNormals;
+			indices = reader.getIndices();
+
+			const auto startTime = std::chrono::high_resolution_clock::now();
+
+			generatedCount = generateNormals(vertices, indices, options.creaseAngle, &pool);
+
+			const auto endTime = std::chrono::high_resolution_clock::now();
+			const double seconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+
+			bestSeconds = (iteration == 0) ? seconds : (std::min)(bestSeconds, seconds);
+		}
+
+		if (threadCount == 1)
+		{
+			firstVertices = vertices;
+			firstIndices = indices;
+			singleThreadNormalSeconds = bestSeconds;
+		}
+
+		const bool matchesFirst = indices == firstIndices && vertices.size() == firstVertices.size() &&
+			std::equal(vertices.begin(), vertices.end(), firstVertices.begin(), [](const Vertex& a, const Vertex& b) { return a.norm == b.norm; });
+
+		std::cout << std::setw(6) << threadCount << " threads: "
+			<< std::fixed << std::setprecision(1) << reader.getIndices().size() / (3000000.0 * bestSeconds) << " M triangles/s, "
+			<< std::setprecision(3) << bestSeconds << " s, "
+			<< std::setprecision(2) << (singleThreadNormalSeconds / bestSeconds) << "x, "
+			<< vertices.size() - withoutNormals.size() << " vertices added at creases"
+			<< (generatedCount == 0 && !withoutNormals.empty() ? " (NO NORMALS GENERATED)" : "")
+			<< (matchesFirst ? "" : " (OUTPUT DIFFERS FROM ONE THREAD)") << std::endl;
+	}
+
+	/*The crease splits append vertices, the original ones keep their place and can be compared*/
+	double angleSum = 0.0;
+	size_t comparedCount = 0;
+
+	for (size_t vertex = 0; vertex < withoutNormals.size() && vertex < firstVertices.size(); vertex++)
+	{
+		const glm::vec3& fileNormal = reader.getVertices()[vertex].norm;
+
+		if (glm::length(fileNormal) > 0.0f)
+		{
+			const float cosine = glm::dot(firstVertices[vertex].norm, glm::normalize(fileNormal));
+			angleSum += std::acos((std::max)(-1.0f, (std::min)(cosine, 1.0f))) * 57.2957795f;
+			comparedCount++;
+		}
+	}
+
+	if (comparedCount > 0)
+	{
+		std::cout << std::setw(14) << "From the file" << ": " << std::setprecision(2) << angleSum / comparedCount << " degrees on average" << std::endl;
+	}
+
+	std::cout << std::setprecision(3);
+}
+
+/*A batch of copies of the file against importing the same list one file after another*/
+static void benchmarkBatchImport(const std::string& path, unsigned int fileCount)
+{
+	OBJReaderOptions options = parsingOptions();
+	options.threadCount = 1;
+
+	const std::vector<std::string> paths(fileCount, path);
+
+	const auto serialStartTime = std::chrono::high_resolution_clock::now();
+
+	for (const std::string& file : paths)
+	{
+		const OBJReaderClass reader(file, options);
+	}
+
+	const auto serialEndTime = std::chrono::high_resolution_clock::now();
+	const double serialSeconds = std::chrono::duration<double, std::chrono::seconds::period>(serialEndTime - serialStartTime).count();
+
+	const MeshBatch batch = importObjFiles(paths, options);
+
+	/*Every mesh has to hold the triangles of a single import, at its own offsets*/
+	const OBJReaderClass single(path, options);
+	bool matchesSingle = true;
+
+	for (const BatchMesh& batchMesh : batch.meshes)
+	{
+		matchesSingle = matchesSingle && batchMesh.vertexCount == single.getVertices().size() && batchMesh.indexCount == single.getIndices().size() &&
+			std::equal(single.getIndices().begin(), single.getIndices().end(), batch.indices.begin() + batchMesh.firstIndex) &&
+			std::equal(single.getVertices().begin(), single.getVertices().end(), batch.vertices.begin() + batchMesh.baseVertex);
+	}
+
+	std::cout << "Batch import: " << paths.size() << " files" << std::endl
+		<< std::setw(14) << "Serial" << ": " << std::fixed << std::setprecision(3) << serialSeconds << " s" << std::endl
+		<< std::setw(14) << "Batch" << ": " << batch.importSeconds << " s, " << std::setprecision(2) << (serialSeconds / batch.importSeconds) << "x, "
+		<< std::setprecision(3) << batch.packSeconds << " s packing " << batch.vertices.size() << " vertices and " << batch.indices.size() << " indices"
+		<< (matchesSingle ? "" : " (OUTPUT DIFFERS FROM A SINGLE IMPORT)") << std::endl;
+}
+
+void benchmarkObjReader(const std::string& path, unsigned int iterations)
+{
+	/*The original reader serves as the reference for the output of every other mode*/
+	OBJReaderOptions referenceOptions = parsingOptions();
+	referenceOptions.readMode = OBJReadMode::Stream;
+
+	/*The peak can only grow, so it is measured around the first load of the process, which is the reference load*/
+	const size_t peakBeforeLoad = peakWorkingSetBytes();
+
+	const OBJReaderClass reference(path, referenceOptions);
+
+	const size_t peakAfterLoad = peakWorkingSetBytes();
+
+	const double megabytes = reference.getLoadStatistics().fileSizeInBytes / (1024.0 * 1024.0);
+
+	std::cout << "OBJ reader benchmark: " << path << " (" << reference.getLoadStatistics().fileSizeInBytes << " bytes, best of " << iterations << ")" << std::endl;
+
+	std::cout << "Peak working set: " << std::fixed << std::setprecision(1) << peakBeforeLoad / (1024.0 * 1024.0) << " MB before and "
+		<< peakAfterLoad / (1024.0 * 1024.0) << " MB after the stream load, "
+		<< reference.getVertices().size() << " unique vertices" << std::endl;
+
+	const unsigned int hardwareThreads = (std::max)(1u, std::thread::hardware_concurrency());
+	const std::vector<unsigned int> threadCounts = scalingThreadCounts(hardwareThreads);
+
+	benchmarkReadModes(path, iterations, reference, megabytes);
+	benchmarkChunkBoundaries(path);
+	benchmarkDeduplication(path, iterations, reference);
+	benchmarkMeshCache(path, iterations, reference);
+	benchmarkSubmeshes(path);
+	benchmarkOptimization(path);
+	benchmarkDetailLevels(path);
+	benchmarkMeshlets(path);
+	benchmarkFrustumCulling(path, iterations);
+	benchmarkWelding(reference);
+	benchmarkCompactVertices(reference);
+	benchmarkParallelScaling(path, iterations, reference, megabytes, threadCounts);
+	benchmarkNormalGeneration(path, iterations, threadCounts);
+	benchmarkBatchImport(path, hardwareThreads); // One file per hardware thread
+}
+
+/*Space separated numbers generated by printing values with a format, as obj exporters do*/
+static std::string generateNumberText(const char* format, size_t count, const std::function<double(std::mt19937&)>& generateValue)
+{
+	std::mt19937 generator(1234); // Fixed seed, every run parses the same text
+	std::string text;
+
+	char buffer[64];
+
+	for (size_t index = 0; index < count; index++)
+	{
+		snprintf(buffer, sizeof(buffer), format, generateValue(generator));
+
+		text += buffer;
+		text += ' ';
+	}
+
+	return text;
+}
+
+/*Parses every number in the text with strtof and parseObjFloat, reports both rates and whether the results are identical*/
+static void measureFloatParsing(const char* name, const std::string& text, size_t count, unsigned int iterations)
+{
+	std::vector<float> referenceValues(count);
+	std::vector<float> values(count);
+
+	double bestReferenceSeconds = 0.0;
+	double bestSeconds = 0.0;
+
+	for (unsigned int iteration = 0; iteration < iterations; iteration++)
+	{
+		/*strtof relies on the terminating null of the string to stop*/
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		const char* cursor = text.c_str();
+
+		for (size_t index = 0; index < count; index++)
+		{
+			char* numberEnd = nullptr;
+			referenceValues[index] = strtof(cursor, &numberEnd);
+			cursor = numberEnd + 1;
+		}
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		const double referenceSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+
+		startTime = std::chrono::high_resolution_clock::now();
+
+		cursor = text.data();
+		const char* const end = text.data() + text.size();
+
+		for (size_t index = 0; index < count; index++)
+		{
+			parseObjFloat(cursor, end, values[index]);
+			cursor++;
+		}
+
+		endTime = std::chrono::high_resolution_clock::now();
+		const double seconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+
+		bestReferenceSeconds = (iteration == 0) ? referenceSeconds : (std::min)(bestReferenceSeconds, referenceSeconds);
+		bestSeconds = (iteration == 0) ? seconds : (std::min)(bestSeconds, seconds);
+	}
+
+	/*Compare the bits, so a different sign of zero would count as well*/
+	size_t mismatches = 0;
+
+	for (size_t index = 0; index < count; index++)
+	{
+		mismatches += (std::memcmp(&referenceValues[index], &values[index], sizeof(float)) != 0) ? 1 : 0;
+	}
+
+	std::cout << std::setw(20) << name << ": "
+		<< std::fixed << std::setprecision(1) << (count / bestReferenceSeconds) / 1e6 << " M/s strtof, "
+		<< (count / bestSeconds) / 1e6 << " M/s parseObjFloat, "
+		<< std::setprecision(2) << (bestReferenceSeconds / bestSeconds) << "x, "
+		<< mismatches << " mismatches" << std::endl;
+}
+
+void benchmarkNumberParsing(unsigned int iterations)
+{
+	const size_t count = 1000000;
+
+	std::cout << "Number parsing benchmark (" << count << " values, best of " << iterations << ")" << std::endl;
+
+	/*Typical attribute values of exported meshes*/
+	measureFloatParsing("Positions %.6f", generateNumberText("%.6f", count, [](std::mt19937& generator) { return std::uniform_real_distribution<double>(-100.0, 100.0)(generator); }), count, iterations);
+	measureFloatParsing("Tex coords %.6f", generateNumberText("%.6f", count, [](std::mt19937& generator) { return std::uniform_real_distribution<double>(0.0, 1.0)(generator); }), count, iterations);
+	measureFloatParsing("Normals %.4f", generateNumberText("%.4f", count, [](std::mt19937& generator) { return std::uniform_real_distribution<double>(-1.0, 1.0)(generator); }), count, iterations);
+	measureFloatParsing("Full precision %.9g", generateNumberText("%.9g", count, [](std::mt19937& generator) { return std::uniform_real_distribution<double>(-1000.0, 1000.0)(generator); }), count, iterations);
+	measureFloatParsing("Scientific %e", generateNumberText("%e", count, [](std::mt19937& generator) { return std::ldexp(std::uniform_real_distribution<double>(-1.0, 1.0)(generator), std::uniform_int_distribution<int>(-60, 60)(generator)); }), count, iterations);
+
+	/*Face indices of a mesh with a few million vertices*/
+	const std::string indexText = generateNumberText("%.0f", count, [](std::mt19937& generator) { return static_cast<double>(std::uniform_int_distribution<int>(1, 4000000)(generator)); });
+
+	std::vector<int64_t> referenceIndices(count);
+	std::vector<int64_t> indices(count);
+
+	double bestReferenceSeconds = 0.0;
+	double bestSeconds = 0.0;
+
+	for (unsigned int iteration = 0; iteration < iterations; iteration++)
+	{
+		auto startTime = std::chrono::high_resolution_clock::now();
+
+		const char* cursor = indexText.c_str();
+
+		for (size_t index = 0; index < count; index++)
+		{
+			char* numberEnd = nullptr;
+			referenceIndices[index] = strtoll(cursor, &numberEnd, 10);
+			cursor = numberEnd + 1;
+		}
+
+		auto endTime = std::chrono::high_resolution_clock::now();
+		const double referenceSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+
+		startTime = std::chrono::high_resolution_clock::now();
+
+		cursor = indexText.data();
+		const char* const end = indexText.data() + indexText.size();
+
+		for (size_t index = 0; index < count; index++)
+		{
+			parseObjInteger(cursor, end, indices[index]);
+			cursor++;
+		}
+
+		endTime = std::chrono::high_resolution_clock::now();
+		const double seconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
+
+		bestReferenceSeconds = (iteration == 0) ? referenceSeconds : (std::min)(bestReferenceSeconds, referenceSeconds);
+		bestSeconds = (iteration == 0) ? seconds : (std::min)(bestSeconds, seconds);
+	}
+
+	std::cout << std::setw(20) << "Face indices" << ": "
+		<< std::fixed << std::setprecision(1) << (count / bestReferenceSeconds) / 1e6 << " M/s strtoll, "
+		<< (count / bestSeconds) / 1e6 << " M/s parseObjInteger, "
+		<< std::setprecision(2) << (bestReferenceSeconds / bestSeconds) << "x, "
+		<< (referenceIndices == indices ? "identical" : "MISMATCHES") << std::endl;
+}
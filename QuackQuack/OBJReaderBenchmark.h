@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+
+/*
+	Measures the throughput of the obj loader and every pass of the import.
+
+	Every read mode loads the file the requested amount of times, the fastest run is
+	reported and the result is compared against the original stream reader. Each pass
+	after it reports its own timings and quality numbers.
+
+	The peak working set is reported around the first load, so the numbers are
+	only meaningful if this runs before anything else allocates much memory.
+*/
+void benchmarkObjReader(const std::string& path, unsigned int iterations);
+
+/*
+	Measures the number conversion of the mapped obj readers against the C library.
+
+	Values with the distributions typical for positions, texture coordinates, normals and
+	face indices are printed into text, parsed with both and compared bit for bit.
+*/
+void benchmarkNumberParsing(unsigned int iterations);
@@ -8,10 +8,227 @@
 #include <algorithm>
 
 #include <iterator>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <windows.h>
 
+#include "MappedFile.h"
+#include "OBJNumberParsing.h"
+#include "StartupTrace.h"
+#include <memory>
+
 struct Vertex;
 
+/*Spaces and tabs separate the values on a line*/
+static bool isHorizontalWhitespace(const char character)
+{
+	return (character == ' ') || (character == '\t');
+}
+
+/*Moves the cursor past any spaces and tabs, but never past the end of the current line*/
+static const char* skipHorizontalWhitespace(const char* cursor, const char* end)
+{
+	while ((cursor < end) && isHorizontalWhitespace(*cursor))
+	{
+		cursor++;
+	}
+
+	return cursor;
+}
+
+/*The text from the cursor to the end of the line without the whitespace around it, names of materials and files may contain spaces*/
+static std::string lineRemainder(const char* cursor, const char* end)
+{
+	cursor = skipHorizontalWhitespace(cursor, end);
+	const char* lineEnd = cursor;
+
+	while (lineEnd < end && *lineEnd != '\n' && *lineEnd != '\r')
+	{
+		lineEnd++;
+	}
+
+	while (lineEnd > cursor && isHorizontalWhitespace(lineEnd[-1]))
+	{
+		lineEnd--;
+	}
+
+	return std::string(cursor, lineEnd);
+}
+
+/*Moves the cursor to the first character of the next line*/
+static const char* skipToNextLine(const char* cursor, const char* end)
+{
+	const char* newLine = static_cast<const char*>(memchr(cursor, '\n', end - cursor));
+
+	return (newLine != nullptr) ? (newLine + 1) : end;
+}
+
+/*Parses a floating point value in place, after any spaces or tabs in front of it*/
+static bool parseFloat(const char*& cursor, const char* end, float& value)
+{
+	cursor = skipHorizontalWhitespace(cursor, end);
+
+	return parseObjFloat(cursor, end, value);
+}
+
+/*Parses a signed decimal integer in place, as used by the face indices*/
+static bool parseInteger(const char*& cursor, const char* end, int64_t& value)
+{
+	return parseObjInteger(cursor, end, value);
+}
+
+/*
+	Parses one index of a face corner. Positive indices are stored as they are, negative ones count
+	backwards from the last attribute read, so they are stored relative to the start of the chunk
+	and become absolute once the amount of attributes in the earlier chunks is known.
+*/
+static bool parseCornerIndex(const char*& cursor, const char* end, const size_t countInChunk, uint32_t& index, bool& relative)
+{
+	int64_t value = 0;
+
+	/*Obj indices start at 1, so 0 is never valid*/
+	if (!parseInteger(cursor, end, value) || value == 0 || value > UINT32_MAX)
+	{
+		return false;
+	}
+
+	relative = (value < 0);
+	index = static_cast<uint32_t>(relative ? (static_cast<int64_t>(countInChunk) + value + 1) : value);
+
+	return true;
+}
+
+/*
+	A corner is written as "v", "v/vt", "v//vn" or "v/vt/vn".
+	Indices which are not present are stored as 0. The mask gets a bit for every relative index,
+	which are counted from the given amounts of attributes read so far.
+*/
+static bool parseFaceCorner(const char*& cursor, const char* end, size_t positionCount, size_t textureCoordinateCount, size_t normalCount, objVertexData& corner, uint32_t& relativeMask)
+{
+	const char* position = skipHorizontalWhitespace(cursor, end);
+
+	bool relative = false;
+	relativeMask = 0;
+
+	/*The position index is mandatory*/
+	if (!parseCornerIndex(position, end, positionCount, corner.v, relative))
+	{
+		return false;
+	}
+
+	relativeMask |= relative ? 1 : 0;
+
+	corner.vt = 0;
+	corner.vn = 0;
+
+	if (position < end && *position == '/')
+	{
+		position++;
+
+		/*The texture coordinate can be left out, as in "v//vn"*/
+		if (position < end && *position != '/')
+		{
+			if (!parseCornerIndex(position, end, textureCoordinateCount, corner.vt, relative))
+			{
+				return false;
+			}
+
+			relativeMask |= relative ? 2 : 0;
+		}
+
+		if (position < end && *position == '/')
+		{
+			position++;
+
+			if (!parseCornerIndex(position, end, normalCount, corner.vn, relative))
+			{
+				return false;
+			}
+
+			relativeMask |= relative ? 4 : 0;
+		}
+	}
+
+	cursor = position;
+
+	return true;
+}
+
+
+/*
+	Deduplicates vertices by value while they arrive, so only the unique vertices are ever stored.
+
+	Every vertex is looked up in an unordered map, keyed either by the exact vertex or, if a weld step
+	is set, by the vertex snapped to a grid. A new key gets the next free index and its vertex is
+	appended to the unique vertices, the first vertex with a key is the one kept.
+*/
+class VertexValueIndexer
+{
+
+private:
+
+	std::unordered_map<Vertex, uint32_t, KeyHasher> exactMap; // Used without a weld step
+	std::unordered_map<QuantizedVertex, uint32_t, QuantizedKeyHasher> weldedMap; // Used with a weld step
+
+	const float weldStep;
+
+	std::vector<Vertex>& uniqueVertices;
+	std::vector<uint32_t>& indices;
+
+	template<typename Key, typename Hasher>
+	void add(std::unordered_map<Key, uint32_t, Hasher>& map, const Key& key, const Vertex& vertex)
+	{
+		/*Insert the vertex with the next free index, if it was already in the map the insertion fails and returns the stored element instead*/
+		const std::pair<typename std::unordered_map<Key, uint32_t, Hasher>::iterator, bool> insertion = map.emplace(key, static_cast<uint32_t>(uniqueVertices.size()));
+
+		if (insertion.second)
+		{
+			/*Add to the unique vertices array, which will get passed to Vulkan*/
+			uniqueVertices.push_back(vertex);
+		}
+
+		indices.push_back(insertion.first->second);
+	}
+
+public:
+
+	VertexValueIndexer(float step, std::vector<Vertex>& uniqueVertexArray, std::vector<uint32_t>& indexArray) : weldStep(step), uniqueVertices(uniqueVertexArray), indices(indexArray)
+	{
+	}
+
+	/*Appends the index of the vertex, and the vertex itself if it has not been seen before*/
+	void add(const Vertex& vertex)
+	{
+		if (weldStep > 0.0f)
+		{
+			add(weldedMap, QuantizedVertex(vertex, weldStep), vertex);
+		}
+		else
+		{
+			add(exactMap, vertex, vertex);
+		}
+	}
+
+	/*
+		Triangulates a face as a fan around its first vertex and adds the vertices of every triangle.
+		Points and lines do not produce any triangles.
+	*/
+	void addFace(const std::vector<Vertex>& face)
+	{
+		for (size_t vertexIndex = 1; vertexIndex + 1 < face.size(); vertexIndex++)
+		{
+			add(face[0]);
+			add(face[vertexIndex]);
+			add(face[vertexIndex + 1]);
+		}
+	}
+
+	HashTableStatistics collectStatistics() const
+	{
+		return (weldStep > 0.0f) ? collectBucketStatistics(weldedMap) : collectBucketStatistics(exactMap);
+	}
+};
 
 bool OBJReaderClass::readObjFile()
 {
@@ -28,8 +245,27 @@ bool OBJReaderClass::readObjFile()
 
 	if (ifs.is_open()) // If file has been successfuly opened for reading
 	{
+		/*Record the size of the file for the throughput statistics*/
+		ifs.seekg(0, std::ios::end);
+		loadStatistics.fileSizeInBytes = static_cast<size_t>(ifs.tellg());
+		ifs.seekg(0, std::ios::beg);
+
 		std::string string;
 
+		/*Reused for every face, so reading a face does not allocate once they have grown large enough*/
+		std::string line;
+		std::vector<Vertex> faceVertices;
+
+		VertexValueIndexer vertexIndexer(options.weldStep, outputMesh.vertices, outputMesh.indices);
+
+		/*Material of the faces being read, 0 until the first usemtl*/
+		uint32_t currentMaterial = 0;
+
+		/*Object of the faces being read, 0 until the first o or g*/
+		std::string objectName;
+		std::string groupName;
+		uint32_t currentObject = 0;
+
 		/*Extract the file contents string by string*/
 		while (ifs >> string)
 		{
@@ -84,42 +320,99 @@ bool OBJReaderClass::readObjFile()
 			/*Read in the faces*/
 			if (string == "f")
 			{
-
-				std::vector<std::string> miniVertexArray;
-				std::string line;
-
 				/*We now have the entire line after the line has been identified as describing a face*/
 				getline(ifs, line);
 
-				std::stringstream ss(line); // Create a stringstream from the string
+				const char* cursor = line.data();
+				const char* const lineEnd = line.data() + line.size();
 
-				while (ss.good())
-				{
-					/*Get the indivdual whitespace separated values in the line*/
-					std::string substring;
+				objVertexData corner(0, 0, 0);
+				uint32_t relativeMask = 0;
 
-					std::getline(ss, substring, ' '); // Split the string into substrings whenever a whitespace is met
+				faceVertices.clear();
 
-					if (substring != "") // There are numerous empty strings in between, we do not wish to store them
+				/*Create the vertices. Relative indices count back from the attributes read so far, which makes them absolute already*/
+				while (parseFaceCorner(cursor, lineEnd, vertexPositions.size(), vertexTextureCoordinates.size(), vertexNormals.size(), corner, relativeMask))
+				{
+					if (corner.v == 0 || corner.v > vertexPositions.size() || corner.vt > vertexTextureCoordinates.size() || corner.vn > vertexNormals.size())
 					{
-						miniVertexArray.push_back(substring);
+						OutputDebugString("The obj file contains a face with an out of range vertex index!");
+						return false;
 					}
+
+					faceVertices.push_back(makeVertex(corner));
 				}
 
-				/*Create the vertices*/
-				std::vector<Vertex> intermediateVertexArray = makeVertices(miniVertexArray);
+				/*Anything which is not a valid corner before the end of the line means the indices are broken, as in parseChunk*/
+				cursor = skipHorizontalWhitespace(cursor, lineEnd);
 
-				/*Triangulate the vertices and return an array of triangualted faces*/
-				std::vector<Vertex> triangulatedFace = triangulate(intermediateVertexArray);
+				if (cursor < lineEnd && *cursor != '\r' && *cursor != '#')
+				{
+					OutputDebugString("The obj file contains a face with an invalid vertex index!");
+					return false;
+				}
 
-				/*Add every face produced after triangulation to a larger face, which is ordered */
-				duplicateVertices.insert(duplicateVertices.end(), triangulatedFace.begin(), triangulatedFace.end());
+				/*Triangulate the face and index its vertices straight away*/
+				vertexIndexer.addFace(faceVertices);
+			}
 
+			/*The material libraries are read once all faces are known*/
+			if (string == "mtllib")
+			{
+				getline(ifs, line);
+				materialLibraryNames.push_back(lineRemainder(line.data(), line.data() + line.size()));
+			}
+
+			/*The triangles since the last usemtl keep the material before it*/
+			if (string == "usemtl")
+			{
+				getline(ifs, line);
+				triangleMaterials.resize(outputMesh.indices.size() / 3, currentMaterial);
+				currentMaterial = findMaterial(lineRemainder(line.data(), line.data() + line.size()));
+			}
+
+			/*A new object has no group until the next g*/
+			if (string == "o" || string == "g")
+			{
+				getline(ifs, line);
+				triangleObjects.resize(outputMesh.indices.size() / 3, currentObject);
+
+				if (string == "o")
+				{
+					objectName = lineRemainder(line.data(), line.data() + line.size());
+					groupName.clear();
+				}
+				else
+				{
+					groupName = lineRemainder(line.data(), line.data() + line.size());
+				}
+
+				currentObject = findObject(objectName, groupName);
 			}
 		}
 
-		/*Create the indices array*/
-		uniqueIndexData = createIndices(duplicateVertices);
+		/*Without any usemtl every triangle uses the default material, which needs no list*/
+		if (!materialIndices.empty())
+		{
+			triangleMaterials.resize(outputMesh.indices.size() / 3, currentMaterial);
+		}
+
+		/*o and g lines without names leave every triangle in object 0, which needs no list either*/
+		if (!triangleObjects.empty() || currentObject != 0)
+		{
+			triangleObjects.resize(outputMesh.indices.size() / 3, currentObject);
+		}
+
+		if (outputMesh.indices.empty())
+		{
+			OutputDebugString("The obj file does not contain any faces!");
+			return false;
+		}
+
+		if (options.collectHashStatistics)
+		{
+			loadStatistics.hashStatistics = vertexIndexer.collectStatistics();
+		}
 
 		ifs.close(); // Close the file
 	}
@@ -127,147 +420,851 @@ bool OBJReaderClass::readObjFile()
 	return true;
 }
 
-std::vector<Vertex> OBJReaderClass::makeVertices(std::vector<std::string>& line)
+/*Runs step for every index in [0, count), on the pool if there is one and on the calling thread otherwise*/
+static void forEachIndex(ThreadPool* pool, size_t count, const std::function<void(size_t)>& step)
+{
+	if (pool != nullptr)
+	{
+		pool->parallelFor(count, step);
+	}
+	else
+	{
+		for (size_t index = 0; index < count; index++)
+		{
+			step(index);
+		}
+	}
+}
+
+/*
+	Reads the obj file through a memory mapped view.
+
+	Each line is identified by its first characters and the values are converted
+	directly from the mapped bytes, so no strings or streams are created along the way.
+	In the Parallel mode the file is cut into chunks at line boundaries which are parsed
+	on a thread pool, the serial mode simply parses the whole file as one chunk.
+	Both fill exactly the same arrays as readObjFile.
+*/
+bool OBJReaderClass::readObjFileMapped()
+{
+	MappedFile file(fileName);
+
+	/*If a problem occured with the file being opened for reading. Most likely misspelled name*/
+	if (!file.isOpen())
+	{
+		OutputDebugString("Could not map the file specified by 'path' for reading, please make sure the name was spelled correctly!");
+		return false;
+	}
+
+	loadStatistics.fileSizeInBytes = file.size();
+
+	std::unique_ptr<ThreadPool> pool;
+	size_t chunkCount = 1;
+
+	if (options.readMode == OBJReadMode::Parallel)
+	{
+		pool = std::make_unique<ThreadPool>(options.threadCount);
+
+		/*A few chunks per thread balance out parts of the file which are denser than others, but tiny chunks are not worth the overhead*/
+		const size_t minimumChunkSize = 1024 * 1024;
+		chunkCount = (std::max<size_t>)(1, (std::min<size_t>)(pool->size() * 4, file.size() / minimumChunkSize));
+	}
+
+	const char* const begin = file.data();
+	const char* const end = file.data() + file.size();
+
+	/*Split the file into pieces of roughly equal size, moving every split forward to the start of the next line*/
+	std::vector<const char*> boundaries(chunkCount + 1);
+	boundaries[0] = begin;
+	boundaries[chunkCount] = end;
+
+	for (size_t chunkIndex = 1; chunkIndex < chunkCount; chunkIndex++)
+	{
+		const char* target = begin + (file.size() / chunkCount) * chunkIndex;
+
+		boundaries[chunkIndex] = skipToNextLine((std::max)(target, boundaries[chunkIndex - 1]), end);
+	}
+
+	std::vector<OBJChunk> chunks(chunkCount);
+
+	if (pool)
+	{
+		pool->parallelFor(chunkCount, [&](size_t chunkIndex) { parseChunk(boundaries[chunkIndex], boundaries[chunkIndex + 1], chunks[chunkIndex]); });
+	}
+	else
+	{
+		parseChunk(begin, end, chunks[0]);
+	}
+
+	if (!mergeChunks(chunks, pool.get()))
+	{
+		return false;
+	}
+
+	const auto indexingStartTime = std::chrono::high_resolution_clock::now();
+
+	/*Create the vertex and index arrays*/
+	if (options.deduplication == OBJDeduplication::IndexTriplets)
+	{
+		indexChunks(chunks, pool.get());
+	}
+	else
+	{
+		indexChunksByValue(chunks);
+	}
+
+	const auto indexingEndTime = std::chrono::high_resolution_clock::now();
+	loadStatistics.indexingSeconds = std::chrono::duration<double, std::chrono::seconds::period>(indexingEndTime - indexingStartTime).count();
+
+	return true;
+}
+
+void OBJReaderClass::parseChunk(const char* begin, const char* end, OBJChunk& chunk)
+{
+	const char* cursor = begin;
+
+	objVertexData corner(0, 0, 0);
+	uint32_t relativeMask = 0;
+
+	while (cursor < end)
+	{
+		cursor = skipHorizontalWhitespace(cursor, end);
+
+		const size_t remaining = end - cursor;
+
+		/*If it is a vertex positon*/
+		if (remaining > 1 && cursor[0] == 'v' && isHorizontalWhitespace(cursor[1]))
+		{
+			cursor += 1;
+
+			glm::vec3 vertex(0.0f, 0.0f, 0.0f);
+			parseFloat(cursor, end, vertex.x);
+			parseFloat(cursor, end, vertex.y);
+			parseFloat(cursor, end, vertex.z);
+
+			chunk.positions.push_back(vertex);
+		}
+		/*If it is a texture coordinate*/
+		else if (remaining > 2 && cursor[0] == 'v' && cursor[1] == 't' && isHorizontalWhitespace(cursor[2]))
+		{
+			cursor += 2;
+
+			glm::vec2 texCoord(0.0f, 0.0f);
+			parseFloat(cursor, end, texCoord.x);
+			parseFloat(cursor, end, texCoord.y);
+
+			chunk.textureCoordinates.push_back(texCoord);
+		}
+		/*If it is a vertex normal*/
+		else if (remaining > 2 && cursor[0] == 'v' && cursor[1] == 'n' && isHorizontalWhitespace(cursor[2]))
+		{
+			cursor += 2;
+
+			glm::vec3 normal(0.0f, 0.0f, 0.0f);
+			parseFloat(cursor, end, normal.x);
+			parseFloat(cursor, end, normal.y);
+			parseFloat(cursor, end, normal.z);
+
+			chunk.normals.push_back(normal);
+		}
+		/*Read in the faces*/
+		else if (remaining > 1 && cursor[0] == 'f' && isHorizontalWhitespace(cursor[1]))
+		{
+			cursor += 1;
+
+			uint32_t faceSize = 0;
+
+			while (parseFaceCorner(cursor, end, chunk.positions.size(), chunk.textureCoordinates.size(), chunk.normals.size(), corner, relativeMask))
+			{
+				if (relativeMask != 0)
+				{
+					chunk.relativeCorners.push_back(std::make_pair(static_cast<uint32_t>(chunk.corners.size()), relativeMask));
+				}
+
+				chunk.corners.push_back(corner);
+				faceSize++;
+			}
+
+			chunk.faceSizes.push_back(faceSize);
+
+			/*Points and lines are not triangulated, every other face becomes a fan of size - 2 triangles*/
+			chunk.triangleCount += (faceSize >= 3) ? (faceSize - 2) : 0;
+
+			/*Anything which is not a valid corner before the end of the line means the indices are broken*/
+			cursor = skipHorizontalWhitespace(cursor, end);
+
+			if (cursor < end && *cursor != '\n' && *cursor != '\r' && *cursor != '#')
+			{
+				chunk.valid = false;
+				return;
+			}
+		}
+
+		/*Materials apply from the next face on, the names are only looked up once the chunks are merged in order*/
+		else if (remaining > 6 && std::memcmp(cursor, "usemtl", 6) == 0 && isHorizontalWhitespace(cursor[6]))
+		{
+			chunk.materialNames.push_back(std::make_pair(static_cast<uint32_t>(chunk.faceSizes.size()), lineRemainder(cursor + 6, end)));
+		}
+		else if (remaining > 6 && std::memcmp(cursor, "mtllib", 6) == 0 && isHorizontalWhitespace(cursor[6]))
+		{
+			chunk.materialLibraries.push_back(lineRemainder(cursor + 6, end));
+		}
+
+		/*Objects and groups work the same way*/
+		else if (remaining > 1 && (*cursor == 'o' || *cursor == 'g') && isHorizontalWhitespace(cursor[1]))
+		{
+			OBJObjectRecord record;
+			record.face = static_cast<uint32_t>(chunk.faceSizes.size());
+			record.group = (*cursor == 'g');
+			record.name = lineRemainder(cursor + 1, end);
+			chunk.objectRecords.push_back(record);
+		}
+
+		/*Comments, smoothing groups and anything unsupported are skipped*/
+		cursor = skipToNextLine(cursor, end);
+	}
+}
+
+/*Expands the changes of the chunks, which give the face each value applies from, into a value for every triangle*/
+static void assignTriangleValues(const std::vector<OBJChunk>& chunks, std::vector<std::pair<uint32_t, uint32_t>> OBJChunk::* changes, size_t triangleCount, std::vector<uint32_t>& triangleValues)
 {
-	std::vector<Vertex> vertices;
+	triangleValues.reserve(triangleCount);
+	uint32_t currentValue = 0;
+
+	for (const OBJChunk& chunk : chunks)
+	{
+		const std::vector<std::pair<uint32_t, uint32_t>>& chunkChanges = chunk.*changes;
+		size_t change = 0;
+
+		for (size_t face = 0; face < chunk.faceSizes.size(); face++)
+		{
+			while (change < chunkChanges.size() && chunkChanges[change].first == face)
+			{
+				currentValue = chunkChanges[change++].second;
+			}
+
+			if (chunk.faceSizes[face] >= 3)
+			{
+				triangleValues.insert(triangleValues.end(), chunk.faceSizes[face] - 2, currentValue);
+			}
+		}
 
-	const std::string backslash = "/"; // Character we wish to split the strings at
-	const std::string whitespace = " ";// Character we wish to replace the baskslash with
+		/*Changes after the last face of the chunk apply to the faces of the next one*/
+		if (change < chunkChanges.size())
+		{
+			currentValue = chunkChanges.back().second;
+		}
+	}
+}
 
-	/*Split up the data by replacing / instances with a whitespace*/
-	for (size_t index = 0; index < line.size(); index++)
+/*
+	The chunks are merged in file order, which keeps the result identical to a serial read.
+
+	Prefix sums over the record counts of the chunks give every chunk the offset of its
+	attributes in the merged arrays. With those known, each chunk can copy its attributes
+	and resolve its relative indices without any locking.
+*/
+bool OBJReaderClass::mergeChunks(std::vector<OBJChunk>& chunks, ThreadPool* pool)
+{
+	const size_t chunkCount = chunks.size();
+
+	std::vector<size_t> positionOffsets(chunkCount + 1, 0);
+	std::vector<size_t> textureCoordinateOffsets(chunkCount + 1, 0);
+	std::vector<size_t> normalOffsets(chunkCount + 1, 0);
+	size_t triangleCount = 0;
+
+	for (size_t chunkIndex = 0; chunkIndex < chunkCount; chunkIndex++)
 	{
-		/*Search for the two backslashes*/
-		const size_t firstBackSlashIndex = line[index].find(backslash); // Find first backlsash
-		const size_t secondBackSlashIndex = line[index].find(backslash, firstBackSlashIndex + 1); // The second back slash index to be found after the first one's position
+		const OBJChunk& chunk = chunks[chunkIndex];
+
+		if (!chunk.valid)
+		{
+			OutputDebugString("The obj file contains a face with an invalid vertex index!");
+			return false;
+		}
+
+		positionOffsets[chunkIndex + 1] = positionOffsets[chunkIndex] + chunk.positions.size();
+		textureCoordinateOffsets[chunkIndex + 1] = textureCoordinateOffsets[chunkIndex] + chunk.textureCoordinates.size();
+		normalOffsets[chunkIndex + 1] = normalOffsets[chunkIndex] + chunk.normals.size();
+		triangleCount += chunk.triangleCount;
+	}
+
+	/*A file without faces has nothing to index*/
+	if (triangleCount == 0)
+	{
+		OutputDebugString("The obj file does not contain any faces!");
+		return false;
+	}
+
+	vertexPositions.resize(positionOffsets[chunkCount]);
+	vertexTextureCoordinates.resize(textureCoordinateOffsets[chunkCount]);
+	vertexNormals.resize(normalOffsets[chunkCount]);
 
-		/*Extract the vertex attributes*/
-		const std::string vertexPositionIndex = line[index].substr(0, firstBackSlashIndex); // position index
-		const std::string vertexTextureCoordinateIndex = line[index].substr(firstBackSlashIndex + 1, secondBackSlashIndex - firstBackSlashIndex - 1); // texture coordinate index
-		const std::string vertexNormalIndex = line[index].substr(secondBackSlashIndex + 1); // normal index
+	/*Written by different threads, so a vector<bool> with its shared bytes cannot be used*/
+	std::vector<char> chunkIndicesValid(chunkCount, 1);
 
-		/*Convert the values to integers*/
-		uint32_t intgerVertexPositionIndex = 0;
-		uint32_t integerVertexTextureCoordinateIndex = 0; // Default values in case one of them is missing as obj files usually do
-		uint32_t intgerVertexNormalIndex = 0;
+	/*Copy the attributes into place and turn every index into an absolute one*/
+	forEachIndex(pool, chunkCount, [&](size_t chunkIndex)
+	{
+		OBJChunk& chunk = chunks[chunkIndex];
 
-		/*Default values in case values are missing*/
-		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
-		glm::vec2 textureCoordinate = glm::vec2(0.0f, 0.0f);
-		glm::vec3 normal = glm::vec3(0.0f, 0.0f, 0.0f);
+		std::copy(chunk.positions.begin(), chunk.positions.end(), vertexPositions.begin() + positionOffsets[chunkIndex]);
+		std::copy(chunk.textureCoordinates.begin(), chunk.textureCoordinates.end(), vertexTextureCoordinates.begin() + textureCoordinateOffsets[chunkIndex]);
+		std::copy(chunk.normals.begin(), chunk.normals.end(), vertexNormals.begin() + normalOffsets[chunkIndex]);
 
-		glm::vec2 fixedTextureCoordinates; // Avoids the inconsistency between the vertical axis between Vulkan and the obj file;
+		/*The attributes now live in the merged arrays, release the copies*/
+		std::vector<glm::vec3>().swap(chunk.positions);
+		std::vector<glm::vec2>().swap(chunk.textureCoordinates);
+		std::vector<glm::vec3>().swap(chunk.normals);
 
-		/*Ohterwise set to the values read from file*/
-		if (vertexPositions.size() != 0)
+		for (const std::pair<uint32_t, uint32_t>& relativeCorner : chunk.relativeCorners)
 		{
-			intgerVertexPositionIndex = std::stoi(vertexPositionIndex) - 1;
-			position = vertexPositions[intgerVertexPositionIndex];
+			objVertexData& corner = chunk.corners[relativeCorner.first];
+
+			/*The relative indices were stored as an offset from the start of the chunk, unsigned wrap around makes the sum correct*/
+			if (relativeCorner.second & 1)
+			{
+				corner.v += static_cast<uint32_t>(positionOffsets[chunkIndex]);
+			}
+
+			if (relativeCorner.second & 2)
+			{
+				corner.vt += static_cast<uint32_t>(textureCoordinateOffsets[chunkIndex]);
+				chunkIndicesValid[chunkIndex] &= (corner.vt != 0) ? 1 : 0;
+			}
+
+			if (relativeCorner.second & 4)
+			{
+				corner.vn += static_cast<uint32_t>(normalOffsets[chunkIndex]);
+				chunkIndicesValid[chunkIndex] &= (corner.vn != 0) ? 1 : 0;
+			}
 		}
 
-		if (vertexTextureCoordinates.size() != 0)
+		/*Every index has to point inside the merged arrays*/
+		for (const objVertexData& corner : chunk.corners)
 		{
-			integerVertexTextureCoordinateIndex = std::stoi(vertexTextureCoordinateIndex) - 1;
+			if (corner.v == 0 || corner.v > vertexPositions.size() || corner.vt > vertexTextureCoordinates.size() || corner.vn > vertexNormals.size())
+			{
+				chunkIndicesValid[chunkIndex] = 0;
+				break;
+			}
+		}
+	});
 
-			textureCoordinate = vertexTextureCoordinates[integerVertexTextureCoordinateIndex];
+	if (std::find(chunkIndicesValid.begin(), chunkIndicesValid.end(), 0) != chunkIndicesValid.end())
+	{
+		OutputDebugString("The obj file contains a face with an out of range vertex index!");
+		return false;
+	}
+
+	/*Materials get their numbers in the order of first use in the file, the same as in the stream reader*/
+	for (OBJChunk& chunk : chunks)
+	{
+		materialLibraryNames.insert(materialLibraryNames.end(), chunk.materialLibraries.begin(), chunk.materialLibraries.end());
 
-			fixedTextureCoordinates.x = textureCoordinate.x;
-			fixedTextureCoordinates.y = 1.0f - textureCoordinate.y;
+		for (const std::pair<uint32_t, std::string>& materialName : chunk.materialNames)
+		{
+			chunk.materialChanges.push_back(std::make_pair(materialName.first, findMaterial(materialName.second)));
 		}
+	}
+
+	/*The names of an o or g line combine with the lines before them, which may lie in an earlier chunk*/
+	std::string objectName;
+	std::string groupName;
 
-		if (vertexNormals.size() != 0)
+	for (OBJChunk& chunk : chunks)
+	{
+		for (const OBJObjectRecord& record : chunk.objectRecords)
 		{
-			intgerVertexNormalIndex = std::stoi(vertexNormalIndex) - 1;
-			normal = vertexNormals[intgerVertexNormalIndex];
+			if (record.group)
+			{
+				groupName = record.name;
+			}
+			else
+			{
+				objectName = record.name;
+				groupName.clear();
+			}
+
+			chunk.objectChanges.push_back(std::make_pair(record.face, findObject(objectName, groupName)));
 		}
+	}
 
-		/*Create a new vertex and add it to the whole array*/
-		Vertex vertex(position, fixedTextureCoordinates, normal);
-		vertices.push_back(vertex);
+	/*Every triangle gets the material of the last usemtl before its face, and the object of the last o or g*/
+	if (!materialIndices.empty())
+	{
+		assignTriangleValues(chunks, &OBJChunk::materialChanges, triangleCount, triangleMaterials);
 	}
 
-	return vertices;
+	if (!objectIndices.empty())
+	{
+		assignTriangleValues(chunks, &OBJChunk::objectChanges, triangleCount, triangleObjects);
+	}
+
+	return true;
+}
+
+void OBJReaderClass::indexChunksByValue(const std::vector<OBJChunk>& chunks)
+{
+	VertexValueIndexer vertexIndexer(options.weldStep, outputMesh.vertices, outputMesh.indices);
+
+	std::vector<Vertex> faceVertices;
+
+	/*Every face is built, triangulated and indexed before the next one, in file order*/
+	for (const OBJChunk& chunk : chunks)
+	{
+		size_t cornerIndex = 0;
+
+		for (const uint32_t faceSize : chunk.faceSizes)
+		{
+			faceVertices.clear();
+
+			for (uint32_t vertexIndex = 0; vertexIndex < faceSize; vertexIndex++)
+			{
+				faceVertices.push_back(makeVertex(chunk.corners[cornerIndex + vertexIndex]));
+			}
+
+			vertexIndexer.addFace(faceVertices);
+
+			cornerIndex += faceSize;
+		}
+	}
+
+	if (options.collectHashStatistics)
+	{
+		loadStatistics.hashStatistics = vertexIndexer.collectStatistics();
+	}
 }
 
 /*
-Accepts the amount of vertex data that is present in the line, in the form of a std::vector<Vertex>
-It then performs a triangulation technique, which is quite common.
+	Face corners which reference the same v/vt/vn indices always produce the same vertex, so the
+	unique vertices can be found by comparing three integers per corner instead of eight floats.
+	The corners are visited in the same order as the triangulated vertices, which hands out the
+	vertex indices in first use order. Only then is a Vertex built, once for every unique corner.
+*/
+void OBJReaderClass::indexChunks(const std::vector<OBJChunk>& chunks, ThreadPool* pool)
+{
+	size_t triangleCount = 0;
 
-Uses a random chosen vertex, and simply loops over all other vertices, building up faces
-as it goes around them.
+	for (const OBJChunk& chunk : chunks)
+	{
+		triangleCount += chunk.triangleCount;
+	}
+
+	outputMesh.indices.clear();
+	outputMesh.indices.reserve(triangleCount * 3);
+
+	/*Most meshes end up with roughly as many vertices as positions, the table grows if there are more*/
+	IndexTripletMap cornerToIndexMap(vertexPositions.size());
+	std::vector<objVertexData> uniqueCorners;
+	uniqueCorners.reserve(vertexPositions.size());
+
+	for (const OBJChunk& chunk : chunks)
+	{
+		size_t cornerIndex = 0;
+
+		for (const uint32_t faceSize : chunk.faceSizes)
+		{
+			/*Fan triangulation, the same corners in the same order as triangulate()*/
+			for (uint32_t vertexIndex = 1; vertexIndex + 1 < faceSize; vertexIndex++)
+			{
+				const objVertexData* triangle[3] = { &chunk.corners[cornerIndex], &chunk.corners[cornerIndex + vertexIndex], &chunk.corners[cornerIndex + vertexIndex + 1] };
+
+				for (const objVertexData* corner : triangle)
+				{
+					bool inserted = false;
+					const uint32_t index = cornerToIndexMap.findOrInsert(*corner, static_cast<uint32_t>(uniqueCorners.size()), inserted);
+
+					if (inserted)
+					{
+						uniqueCorners.push_back(*corner);
+					}
+
+					outputMesh.indices.push_back(index);
+				}
+			}
+
+			cornerIndex += faceSize;
+		}
+	}
+
+	if (options.collectHashStatistics)
+	{
+		loadStatistics.hashStatistics = cornerToIndexMap.collectStatistics();
+	}
+
+	/*Build the vertices, split into ranges so every worker has a few of them to do*/
+	outputMesh.vertices.resize(uniqueCorners.size());
+
+	const size_t rangeCount = (pool != nullptr) ? pool->size() * 4 : 1;
+
+	forEachIndex(pool, rangeCount, [&](size_t rangeIndex)
+	{
+		const size_t rangeBegin = uniqueCorners.size() * rangeIndex / rangeCount;
+		const size_t rangeEnd = uniqueCorners.size() * (rangeIndex + 1) / rangeCount;
+
+		for (size_t vertexIndex = rangeBegin; vertexIndex < rangeEnd; vertexIndex++)
+		{
+			outputMesh.vertices[vertexIndex] = makeVertex(uniqueCorners[vertexIndex]);
+		}
+	});
+}
+
+/*
+	Looks up the attributes referenced by the corner. Missing attributes keep a default value,
+	and the texture coordinate is flipped vertically to match the vertical axis of Vulkan.
 */
-std::vector<Vertex> OBJReaderClass::triangulate(const std::vector<Vertex>& face)
+Vertex OBJReaderClass::makeVertex(const objVertexData& corner) const
 {
-	std::vector<Vertex> triangulatedVertexData;
+	glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
+	glm::vec2 fixedTextureCoordinates = glm::vec2(0.0f, 0.0f); // Avoids the inconsistency between the vertical axis between Vulkan and the obj file
+	glm::vec3 normal = glm::vec3(0.0f, 0.0f, 0.0f);
 
-	/*Go through the faces*/
-	for (unsigned int vertexIndex = 1; vertexIndex < face.size() - 1; vertexIndex++)
+	if (corner.v != 0)
 	{
-		/*Create a new face*/
-		Vertex randomVertex = face[0];
-		Vertex firstNeighbour = face[vertexIndex];
-		Vertex secondNeighbour = face[vertexIndex + 1];
+		position = vertexPositions[corner.v - 1];
+	}
 
-		/*Add the new face to a*/
-		triangulatedVertexData.push_back(randomVertex);
-		triangulatedVertexData.push_back(firstNeighbour);
-		triangulatedVertexData.push_back(secondNeighbour);
+	if (corner.vt != 0)
+	{
+		const glm::vec2& textureCoordinate = vertexTextureCoordinates[corner.vt - 1];
+
+		fixedTextureCoordinates.x = textureCoordinate.x;
+		fixedTextureCoordinates.y = 1.0f - textureCoordinate.y;
 	}
 
-	return triangulatedVertexData;
+	if (corner.vn != 0)
+	{
+		normal = vertexNormals[corner.vn - 1];
+	}
+
+	return Vertex(position, fixedTextureCoordinates, normal);
+}
+
+uint32_t OBJReaderClass::findMaterial(const std::string& name)
+{
+	/*Material 0 is the default, so the names start at 1*/
+	const std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> insertion = materialIndices.emplace(name, static_cast<uint32_t>(materialIndices.size() + 1));
+
+	return insertion.first->second;
+}
+
+uint32_t OBJReaderClass::findObject(const std::string& objectName, const std::string& groupName)
+{
+	/*Groups of a named object are told apart by both names*/
+	const std::string name = groupName.empty() ? objectName : (objectName.empty() ? groupName : objectName + "/" + groupName);
+
+	if (name.empty())
+	{
+		return 0;
+	}
+
+	const std::pair<std::unordered_map<std::string, uint32_t>::iterator, bool> insertion = objectIndices.emplace(name, static_cast<uint32_t>(objectIndices.size() + 1));
+
+	return insertion.first->second;
 }
 
-std::vector<uint32_t> OBJReaderClass::createIndices(const std::vector<Vertex>& facesAfterTriangulation)
+void OBJReaderClass::buildSubmeshes()
 {
-	std::vector<uint32_t> indexedArray;
-	std::unordered_map<Vertex, uint32_t, KeyHasher> verticesToIndexesMap;
+	const size_t materialCount = materialIndices.size() + 1;
 
-	/*Make sure we are not receiving an empty mesh*/
-	assert(facesAfterTriangulation.size() != 0);
+	outputMesh.materials.assign(materialCount, Material());
+	outputMesh.materialNames.assign(materialCount, std::string());
 
-	/*Triangulated data should be divisible by 3*/
-	assert((facesAfterTriangulation.size() % 3) == 0);
+	for (const std::pair<const std::string, uint32_t>& material : materialIndices)
+	{
+		outputMesh.materialNames[material.second] = material.first;
+	}
 
+	/*The libraries are only read if a face uses a material, a later definition of a name replaces an earlier one*/
+	std::unordered_map<std::string, Material> definitions;
 
-	/*Loop over all vertices from the triangulated mesh that got computed*/
-	for (const Vertex& vertex : facesAfterTriangulation)
+	for (size_t library = 0; library < materialLibraryNames.size() && !materialIndices.empty(); library++)
 	{
-		const std::unordered_map<Vertex, uint32_t, KeyHasher>::iterator checkIfPresentIterator = verticesToIndexesMap.find(vertex); // Search the map if the vertex is in the map
+		const std::string path = resolveObjRelativePath(fileName, materialLibraryNames[library]);
 
-																												/*If an element is not found, iterator returns the end of the map*/
-		if (checkIfPresentIterator == verticesToIndexesMap.end())
+		if (std::find(outputMesh.materialLibraries.begin(), outputMesh.materialLibraries.end(), path) != outputMesh.materialLibraries.end())
 		{
-			/*Add to the unique vertices array, which will get passed to Vulkan*/
-			uniqueVertexData.push_back(vertex);
+			continue;
+		}
+
+		/*A missing library is recorded as well, so the mesh cache notices when it appears*/
+		outputMesh.materialLibraries.push_back(path);
 
-			const uint32_t index = (uint32_t)(uniqueVertexData.size() - 1);
+		std::vector<std::string> names;
+		std::vector<Material> materials;
 
-			std::pair<Vertex, uint32_t> pair(vertex, index);
+		if (!readMaterialLibrary(path, names, materials))
+		{
+			OutputDebugString("Could not open an mtl file named by the obj file, its materials keep the default values!");
+			continue;
+		}
 
-			/*Add the element to the map as well*/
-			verticesToIndexesMap[vertex] = index;
+		for (size_t material = 0; material < names.size(); material++)
+		{
+			definitions[names[material]] = materials[material];
 		}
+	}
 
-		/*This iterator will find the position of where the element was added in order to get the index for the indices array*/
-		const std::unordered_map<Vertex, uint32_t, KeyHasher>::iterator findIndexIterator = verticesToIndexesMap.find(vertex);
+	for (size_t material = 1; material < materialCount; material++)
+	{
+		const std::unordered_map<std::string, Material>::const_iterator definition = definitions.find(outputMesh.materialNames[material]);
 
-		indexedArray.push_back(findIndexIterator->second);
+		if (definition == definitions.end())
+		{
+			OutputDebugString("The obj file uses a material which no mtl file defines, it keeps the default values!");
+			continue;
+		}
+
+		outputMesh.materials[material] = definition->second;
 	}
 
+	/*
+		An o or g line followed by another before any face leaves an object without triangles, and so does
+		a file whose first face comes after its first o. Those objects are dropped and the rest renumbered
+	*/
+	std::vector<uint32_t> objectRemap(objectIndices.size() + 1, 0);
+
+	for (const uint32_t object : triangleObjects)
+	{
+		objectRemap[object] = 1;
+	}
+
+	if (triangleObjects.empty())
+	{
+		objectRemap[0] = 1;
+	}
+
+	std::vector<std::string> objectNames(objectIndices.size() + 1);
+
+	for (const std::pair<const std::string, uint32_t>& object : objectIndices)
+	{
+		objectNames[object.second] = object.first;
+	}
+
+	for (size_t object = 0; object < objectRemap.size(); object++)
+	{
+		if (objectRemap[object] != 0)
+		{
+			objectRemap[object] = static_cast<uint32_t>(outputMesh.objectNames.size());
+			outputMesh.objectNames.push_back(objectNames[object]);
+		}
+	}
+
+	for (uint32_t& object : triangleObjects)
+	{
+		object = objectRemap[object];
+	}
+
+	outputMesh.objects.assign(outputMesh.objectNames.size(), MeshObject());
+
+	groupTriangles(outputMesh.indices, triangleObjects, outputMesh.objects.size(), triangleMaterials, materialCount, outputMesh.submeshes);
+
+	std::vector<uint32_t>().swap(triangleObjects);
+	std::vector<uint32_t>().swap(triangleMaterials);
+}
+
+uint64_t OBJReaderClass::meshCacheSettings() const
+{
+	/*The stream reader always deduplicates by value*/
+	const OBJDeduplication deduplication = (options.readMode == OBJReadMode::Stream) ? OBJDeduplication::VertexValues : options.deduplication;
+
+	uint32_t weldStepBits = 0;
+	std::memcpy(&weldStepBits, &options.weldStep, sizeof(weldStepBits));
+
+	uint32_t weldToleranceBits[3] = {};
+	std::memcpy(&weldToleranceBits[0], &options.weldTolerances.position, sizeof(uint32_t));
+	std::memcpy(&weldToleranceBits[1], &options.weldTolerances.normal, sizeof(uint32_t));
+	std::memcpy(&weldToleranceBits[2], &options.weldTolerances.textureCoordinate, sizeof(uint32_t));
+
+	/*The other tolerances do nothing without a position tolerance*/
+	const bool welding = options.weldTolerances.position > 0.0f;
+
+	uint32_t creaseAngleBits = 0;
+	std::memcpy(&creaseAngleBits, &options.creaseAngle, sizeof(creaseAngleBits));
+
+	uint32_t overdrawThresholdBits = 0;
+	std::memcpy(&overdrawThresholdBits, &options.overdrawThreshold, sizeof(overdrawThresholdBits));
+
+	const uint32_t settings[] =
+	{
+		static_cast<uint32_t>(deduplication),
+		weldStepBits,
+		welding ? weldToleranceBits[0] : 0u,
+		welding ? weldToleranceBits[1] : 0u,
+		welding ? weldToleranceBits[2] : 0u,
+		options.generateNormals ? 1u : 0u,
+		options.generateNormals ? creaseAngleBits : 0u,
+		options.optimizeMesh ? 1u : 0u,
+		(options.optimizeMesh && options.trianglesPerChunk == 0) ? overdrawThresholdBits : 0u, // The chunks replace the overdraw order
+		options.lodLevelCount,
+		options.buildMeshlets ? 1u : 0u,
+		options.trianglesPerChunk
+	};
+
+	/*FNV-1a over the settings, any change gives a different key*/
+	uint64_t key = 0xCBF29CE484222325ull;
+
+	for (const uint32_t setting : settings)
+	{
+		key = (key ^ setting) * 0x100000001B3ull;
+	}
+
+	return key;
+}
+
+MeshData OBJReaderClass::takeMesh()
+{
+	MeshData mesh = std::move(outputMesh);
 
-	assert(uniqueVertexData.size() != 0);
-	assert(indexedArray.size() != 0);
+	/*A moved from vector is only guaranteed to be valid, make sure the reader is left with an empty mesh*/
+	outputMesh = MeshData();
 
-	return indexedArray;;
+	return mesh;
 }
 
 OBJReaderClass::OBJReaderClass()
 {
 }
 
-OBJReaderClass::OBJReaderClass(const std::string & file) : fileName(file)
+OBJReaderClass::OBJReaderClass(const std::string & file, const OBJReaderOptions& readerOptions) : fileName(file), options(readerOptions)
 {
-	readObjFile();
+	const ScopedTraceZone traceZone("Load " + fileName, "assets");
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	MeshCacheKey cacheKey;
+	const bool cacheUsable = options.useMeshCache && makeMeshCacheKey(fileName, meshCacheSettings(), cacheKey);
+
+	/*An up to date cache replaces the whole import*/
+	if (cacheUsable && readMeshCache(fileName, cacheKey, outputMesh))
+	{
+		loadStatistics.loadedFromCache = true;
+		loadStatistics.fileSizeInBytes = static_cast<size_t>(cacheKey.sourceSize);
+	}
+	else
+	{
+		bool loaded = false;
+
+		/*Pick the reader requested by the options*/
+		if (options.readMode == OBJReadMode::Stream)
+		{
+			loaded = readObjFile();
+		}
+		else
+		{
+			loaded = readObjFileMapped();
+		}
+
+		/*Every later pass keeps the triangles inside their submesh*/
+		if (loaded)
+		{
+			const auto submeshStartTime = std::chrono::high_resolution_clock::now();
+
+			buildSubmeshes();
+
+			const auto submeshEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.submeshSeconds = std::chrono::duration<double, std::chrono::seconds::period>(submeshEndTime - submeshStartTime).count();
+		}
+
+		/*Welding joins the positions the normals are smoothed over, so it comes first*/
+		if (loaded && options.weldTolerances.position > 0.0f)
+		{
+			const auto weldStartTime = std::chrono::high_resolution_clock::now();
+
+			const WeldResult weld = weldVertices(outputMesh.vertices, outputMesh.indices, outputMesh.submeshes, options.weldTolerances);
+			loadStatistics.weldedVertexCount = weld.mergedVertexCount;
+			loadStatistics.weldSavedBytes = weld.mergedVertexCount * sizeof(Vertex) + weld.removedTriangleCount * 3 * sizeof(uint32_t);
+
+			const auto weldEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.weldSeconds = std::chrono::duration<double, std::chrono::seconds::period>(weldEndTime - weldStartTime).count();
+		}
+
+		/*Normals may add vertices along creases, so they come before any pass which orders the vertices*/
+		if (loaded && options.generateNormals && hasMissingNormals(outputMesh.vertices))
+		{
+			const auto normalStartTime = std::chrono::high_resolution_clock::now();
+
+			ThreadPool pool(options.threadCount);
+			loadStatistics.generatedNormalCount = generateNormals(outputMesh.vertices, outputMesh.indices, options.creaseAngle, &pool);
+
+			const auto normalEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.normalSeconds = std::chrono::duration<double, std::chrono::seconds::period>(normalEndTime - normalStartTime).count();
+		}
+
+		if (loaded && options.optimizeMesh)
+		{
+			const auto optimizationStartTime = std::chrono::high_resolution_clock::now();
+
+			/*The chunks sort the triangles along a Morton curve afterwards, which throws away the order of the overdraw pass*/
+			const float overdrawThreshold = (options.trianglesPerChunk > 0) ? 0.0f : options.overdrawThreshold;
+
+			optimizeMesh(outputMesh.vertices, outputMesh.indices, outputMesh.submeshes, overdrawThreshold);
+
+			const auto optimizationEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.optimizationSeconds = std::chrono::duration<double, std::chrono::seconds::period>(optimizationEndTime - optimizationStartTime).count();
+		}
+
+		/*The levels share the vertex buffer, so the vertex order has to be final before they are built*/
+		if (loaded && options.lodLevelCount > 0)
+		{
+			const auto simplificationStartTime = std::chrono::high_resolution_clock::now();
+
+			buildLodChain(outputMesh.vertices, outputMesh.indices, options.lodLevelCount, outputMesh.lods, outputMesh.submeshes);
+
+			const auto simplificationEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.simplificationSeconds = std::chrono::duration<double, std::chrono::seconds::period>(simplificationEndTime - simplificationStartTime).count();
+		}
+
+		/*The chunks reorder the triangles, so they have to be built before anything that follows the triangle order*/
+		if (loaded && options.trianglesPerChunk > 0)
+		{
+			const auto chunkStartTime = std::chrono::high_resolution_clock::now();
+
+			buildSpatialChunks(outputMesh.vertices, outputMesh.indices, outputMesh.lods, outputMesh.submeshes, options.trianglesPerChunk, outputMesh.chunks);
+
+			/*Store the vertices in the order the chunks use them again, only the ranges of the index buffer refer to them*/
+			if (options.optimizeMesh)
+			{
+				optimizeVertexFetch(outputMesh.vertices, outputMesh.indices);
+			}
+
+			const auto chunkEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.chunkSeconds = std::chrono::duration<double, std::chrono::seconds::period>(chunkEndTime - chunkStartTime).count();
+		}
+
+		/*Only the full mesh is split, it is the first detail level if there are any*/
+		if (loaded && options.buildMeshlets)
+		{
+			const auto meshletStartTime = std::chrono::high_resolution_clock::now();
+
+			const size_t fullMeshIndexCount = outputMesh.lods.empty() ? outputMesh.indices.size() : outputMesh.lods[0].indexCount;
+			const size_t fullMeshSubmeshCount = outputMesh.lods.empty() ? outputMesh.submeshes.size() : outputMesh.lods[0].submeshCount;
+			buildMeshlets(outputMesh.vertices, outputMesh.indices, fullMeshIndexCount, outputMesh.submeshes.data(), fullMeshSubmeshCount, outputMesh.meshlets);
+
+			const auto meshletEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.meshletSeconds = std::chrono::duration<double, std::chrono::seconds::period>(meshletEndTime - meshletStartTime).count();
+		}
+
+		/*The bounds come last, every pass before may move the vertices or the triangles of a submesh*/
+		if (loaded)
+		{
+			const auto boundsStartTime = std::chrono::high_resolution_clock::now();
+
+			computeSubmeshBounds(outputMesh.vertices, outputMesh.indices, outputMesh.submeshes, outputMesh.objects);
+
+			const auto boundsEndTime = std::chrono::high_resolution_clock::now();
+			loadStatistics.submeshSeconds += std::chrono::duration<double, std::chrono::seconds::period>(boundsEndTime - boundsStartTime).count();
+		}
+
+		/*Store the result for the next launch*/
+		if (loaded && cacheUsable)
+		{
+			writeMeshCache(fileName, cacheKey, outputMesh);
+		}
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	loadStatistics.loadSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
 }
 
 
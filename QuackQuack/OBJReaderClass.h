@@ -7,11 +7,121 @@
 #include <glm.hpp>
 
 #include "objVertexData.h"
+#include "IndexTripletMap.h"
+#include "HashTableStatistics.h"
+#include "MeshCache.h"
+#include "MeshData.h"
+#include "MeshOptimization.h"
+#include "MeshSimplification.h"
+#include "Meshlets.h"
+#include "SpatialChunks.h"
+#include "NormalGeneration.h"
+#include "VertexWelding.h"
+#include "MaterialLibrary.h"
+#include "Submeshes.h"
 
 #include "Vertex.h"
 
+#include "ThreadPool.h"
+
 #include <unordered_map>
 
+/*How the obj file gets read from disk*/
+enum class OBJReadMode
+{
+	Stream, // The original reader, extracts every token through std::ifstream
+	MemoryMapped, // Maps the file and scans its bytes in place, without any per-token strings
+	Parallel // Same as MemoryMapped, but the file is split into chunks which get parsed on several threads
+};
+
+/*How identical face corners are found when the index buffer is created, only used by the mapped readers*/
+enum class OBJDeduplication
+{
+	VertexValues, // Hashes the finished vertices in an std::unordered_map, as the stream reader does
+	IndexTriplets // Looks up the v/vt/vn indices of every corner in a flat hash table, before any vertex is built
+};
+
+/*Settings which control how a mesh gets loaded*/
+struct OBJReaderOptions
+{
+	OBJReadMode readMode = OBJReadMode::MemoryMapped;
+	OBJDeduplication deduplication = OBJDeduplication::IndexTriplets;
+	float weldStep = 0.0f; // Grid spacing used to weld near identical vertices when deduplicating by value, 0 only merges exact matches. Vertices either side of a grid line never merge, weldTolerances does not have that problem
+	WeldTolerances weldTolerances; // Welds vertices within these tolerances of each other after the import, works with every read mode
+	bool collectHashStatistics = false; // Fills OBJLoadStatistics::hashStatistics, costs an extra pass over the table
+	bool generateNormals = true; // Computes smooth normals for the vertices the obj file gave none, which would otherwise be drawn black
+	float creaseAngle = 60.0f; // Triangles meeting at a larger angle than this, in degrees, keep separate normals along their shared edge
+	bool optimizeMesh = false; // Reorders triangles and vertices for the vertex cache, overdraw and vertex fetch after the import
+	float overdrawThreshold = 1.05f; // How much worse the vertex cache efficiency may get for less overdraw, see optimizeOverdraw. Not used with trianglesPerChunk, the chunks reorder the triangles anyway
+	unsigned int lodLevelCount = 0; // Simplified detail levels appended to the indices, each with about half the triangles of the one before
+	bool buildMeshlets = false; // Splits the full mesh into meshlets with bounds for culling
+	unsigned int trianglesPerChunk = 0; // Splits every detail level into spatial chunks of this many triangles for frustum culling, 0 keeps each level whole. With optimizeMesh each chunk is optimized for the vertex cache, but not for overdraw
+	bool useMeshCache = true; // Loads the binary cache next to the obj file if it is up to date, and writes it after parsing otherwise
+	unsigned int threadCount = 0; // Worker threads used by the Parallel mode and the normal generation, 0 uses every hardware thread
+};
+
+/*An o or g line, with the face of its chunk it applies from*/
+struct OBJObjectRecord
+{
+	uint32_t face;
+	bool group; // g names a group inside the current object, o starts a new object without a group
+	std::string name;
+};
+
+/*
+	The records read from one piece of the obj file. Every chunk starts at the beginning
+	of a line, so the chunks can be parsed independently and then merged in order.
+*/
+struct OBJChunk
+{
+	/*Attributes in the order they appear inside the chunk*/
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec2> textureCoordinates;
+	std::vector<glm::vec3> normals;
+
+	/*
+		The corners of every face, with 1-based indices and 0 for attributes which are not present.
+		Negative obj indices are stored relative to the start of the chunk until the chunk offsets are known.
+	*/
+	std::vector<objVertexData> corners;
+	std::vector<uint32_t> faceSizes; // Amount of corners of each face
+	size_t triangleCount = 0; // Amount of triangles the faces turn into
+
+	/*Corners which contain relative indices, and a mask of which of v (1), vt (2) and vn (4) are relative*/
+	std::vector<std::pair<uint32_t, uint32_t>> relativeCorners;
+
+	/*The mtllib and usemtl lines of the chunk, with the face each usemtl applies from. The names are turned into materials when the chunks are merged*/
+	std::vector<std::string> materialLibraries;
+	std::vector<std::pair<uint32_t, std::string>> materialNames;
+	std::vector<std::pair<uint32_t, uint32_t>> materialChanges; // Face and material of every usemtl, filled in by mergeChunks
+
+	/*The o and g lines of the chunk. Which object they select depends on the lines before them, so that is also left to mergeChunks*/
+	std::vector<OBJObjectRecord> objectRecords;
+	std::vector<std::pair<uint32_t, uint32_t>> objectChanges; // Face and object of every o and g line
+
+	bool valid = true; // Cleared if a malformed face was found
+};
+
+/*Information gathered while loading a mesh, used for profiling the loader*/
+struct OBJLoadStatistics
+{
+	size_t fileSizeInBytes = 0; // Size of the obj file that was read
+	double loadSeconds = 0.0; // Wall time for parsing, triangulating and creating the indices
+	double indexingSeconds = 0.0; // Part of loadSeconds spent finding the unique vertices, 0 for the stream reader which indexes every face as it is read
+	HashTableStatistics hashStatistics; // Occupancy of the deduplication table, only if requested in the options
+	bool loadedFromCache = false; // The mesh came from the binary cache instead of the obj file
+	double submeshSeconds = 0.0; // Part of loadSeconds spent reading the mtl files, sorting the triangles by object and material and finding their bounds
+	double weldSeconds = 0.0; // Part of loadSeconds spent welding vertices within the weld tolerances
+	size_t weldedVertexCount = 0; // Vertices welded to a vertex close to them
+	size_t weldSavedBytes = 0; // Memory the welded vertices and the triangles they collapsed took in the vertex and index buffers
+	double normalSeconds = 0.0; // Part of loadSeconds spent generating missing normals
+	size_t generatedNormalCount = 0; // Vertices which got a generated normal, including those added along creases
+	double optimizationSeconds = 0.0; // Part of loadSeconds spent in the mesh optimization passes
+	double simplificationSeconds = 0.0; // Part of loadSeconds spent building the detail levels
+	double meshletSeconds = 0.0; // Part of loadSeconds spent building the meshlets
+	double chunkSeconds = 0.0; // Part of loadSeconds spent splitting the detail levels into spatial chunks
+};
+
 /*
 	Consider that you may actually NOT need any paramaters as all teh data is available inside the class
 */
@@ -23,17 +133,24 @@ private:
 	/*Raw data extracted from file*/
 
 	std::string fileName; // The filename of the Obj mesh
+	OBJReaderOptions options; // How the mesh should be read
+	OBJLoadStatistics loadStatistics; // Timings of the last load
 	std::vector<glm::vec3> vertexPositions; // positons of vertices
 	std::vector<glm::vec3> vertexNormals; // normals per vertex
 	std::vector<glm::vec2> vertexTextureCoordinates; // texture coordinate per vertex
 
-	/*Intermediate stages, which we only care about in the objReaderClass*/
-	std::vector<Vertex> duplicateVertices;
+	/*Materials named by the obj file, turned into submeshes once all faces are read*/
+	std::vector<std::string> materialLibraryNames; // Every mtllib, in file order
+	std::unordered_map<std::string, uint32_t> materialIndices; // Material of every name used with usemtl
+	std::vector<uint32_t> triangleMaterials; // Material of every triangle, 0 is the default material of faces before the first usemtl
+
+	/*Objects and groups named by the obj file, the same way*/
+	std::unordered_map<std::string, uint32_t> objectIndices; // Object of every o and g combination
+	std::vector<uint32_t> triangleObjects; // Object of every triangle, 0 is the object of faces before the first o or g
 
 	/*Output data*/
 
-	std::vector<Vertex> uniqueVertexData;
-	std::vector<uint32_t> uniqueIndexData;
+	MeshData outputMesh; // The unique vertices, the indices and what is derived from them
 
 	/*std::vector<TriangleFacePosition> trianglePositions;*/
 
@@ -42,32 +159,61 @@ private:
 	/*Reads the data from the obj file and stores it in one of the member arrays*/
 	bool readObjFile(); // Reads the obj file
 
-	/*Creates Vertex data from the faces read*/
-	std::vector<Vertex> makeVertices( std::vector<std::string>& line);
+	/*Same as readObjFile, but scans a memory mapped view of the file instead of going through a stream*/
+	bool readObjFileMapped();
 
-	/*Creates the faces of the mesh via triangulation*/
-	std::vector<Vertex> triangulate(const std::vector<Vertex>& face);
+	/*Parses the lines between begin and end into a chunk, it does not touch any member and can run on any thread*/
+	static void parseChunk(const char* begin, const char* end, OBJChunk& chunk);
 
-	///*Create a hash map between vertices and a uint32_t ID*/
-	//std::unordered_map<Vertex, uint32_t, KeyHasher> createHashmapForIndices(const std::vector<Vertex>& facesAfterTriangulation);
+	/*Concatenates the attributes of the chunks in file order and resolves their indices*/
+	bool mergeChunks(std::vector<OBJChunk>& chunks, ThreadPool* pool);
 
-	/*Creates the indices array that will be passed to Vulkan*/
-	std::vector<uint32_t> createIndices( const std::vector<Vertex>& triangulatedFaces);
+	/*Creates the unique vertices and the indices of the merged chunks face by face, for the VertexValues deduplication*/
+	void indexChunksByValue(const std::vector<OBJChunk>& chunks);
+
+	/*Creates the unique vertices and the indices straight from the corners of the merged chunks*/
+	void indexChunks(const std::vector<OBJChunk>& chunks, ThreadPool* pool);
+
+	/*Packs the options which change the resulting vertices and indices, a cache made with other settings is not used*/
+	uint64_t meshCacheSettings() const;
+
+	/*Creates a single Vertex from the attribute indices of a face corner*/
+	Vertex makeVertex(const objVertexData& corner) const;
+
+	/*Material of a usemtl name, names seen for the first time get the next material*/
+	uint32_t findMaterial(const std::string& name);
+
+	/*Object of the current o and g names, combinations seen for the first time get the next object. Both empty is object 0*/
+	uint32_t findObject(const std::string& objectName, const std::string& groupName);
+
+	/*Reads the mtl files into the material table and sorts the triangles into one submesh per object and material*/
+	void buildSubmeshes();
 
 public:
 
 	OBJReaderClass();
-	OBJReaderClass(const std::string& file);
-
-	/*Getters*/
-	std::string getFileName() const { return fileName; };
-	std::vector<glm::vec3> getPositions() const { return vertexPositions; };
-	std::vector<glm::vec2> geTextureCoordinates() const { return vertexTextureCoordinates; };
-	std::vector<glm::vec3> getNormals() const { return vertexNormals; };
+	OBJReaderClass(const std::string& file, const OBJReaderOptions& readerOptions = OBJReaderOptions());
+
+	/*Getters, the references are valid as long as the reader is alive and takeMesh has not been called*/
+	const std::string& getFileName() const { return fileName; };
+	const OBJLoadStatistics& getLoadStatistics() const { return loadStatistics; };
+	const std::vector<glm::vec3>& getPositions() const { return vertexPositions; };
+	const std::vector<glm::vec2>& geTextureCoordinates() const { return vertexTextureCoordinates; };
+	const std::vector<glm::vec3>& getNormals() const { return vertexNormals; };
 	
 	/*The important methods*/
-	std::vector<Vertex> getVertices() const { return uniqueVertexData; };
-	std::vector<uint32_t> getIndices() const { return uniqueIndexData; };
+	const std::vector<Vertex>& getVertices() const { return outputMesh.vertices; };
+	const std::vector<uint32_t>& getIndices() const { return outputMesh.indices; }; // Holds all detail levels one after another if any were generated
+	const std::vector<MeshLod>& getLods() const { return outputMesh.lods; };
+	const MeshletData& getMeshlets() const { return outputMesh.meshlets; };
+	const SpatialChunks& getChunks() const { return outputMesh.chunks; };
+	const std::vector<Submesh>& getSubmeshes() const { return outputMesh.submeshes; };
+	const std::vector<Material>& getMaterials() const { return outputMesh.materials; };
+	const std::vector<MeshObject>& getObjects() const { return outputMesh.objects; };
+	const std::vector<std::string>& getObjectNames() const { return outputMesh.objectNames; };
+
+	/*Moves the vertices and indices out of the reader without copying them, afterwards the reader holds an empty mesh*/
+	MeshData takeMesh();
 
 	~OBJReaderClass();
 };
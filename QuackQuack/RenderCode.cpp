@@ -7,6 +7,9 @@
 
 #include <chrono>
 
+#include "StartupTrace.h"
+#include "DeviceMemoryStressTest.h"
+
 /*STB*/
 #include "stb_image.h"
 
@@ -71,12 +74,22 @@ void RenderCode::initVulkan()
 
 	createLogicalDevice(); // Provides a description of the requirements of our application that have to be handled by the physical device.
 
+	memoryAllocator.initialize(physicalDevice, device); // Every buffer and image is placed in the memory blocks of this allocator
+
+#ifdef QUACK_MEMORY_STRESS_TEST
+	stressTestDeviceMemory(physicalDevice, device);
+#endif
+
+	finishStartupStage("Instance and device");
+
 	createSwapChain(); // A mechanism for looping images that would be presented to the screen.
 
 	createImageViews(); // Prepare information about which parts of the framebuffer will be read in and displayed in the final presentation stage.
 
 	createRenderPass(); // Sets up the amount of formats and the type which are required.
 
+	finishStartupStage("Swap chain");
+
 	createDescriptorSetLayout(); // Should be called here as we will need it exactly after pipeline creation
 
 	createGraphicsPipeline(); // Creates a graphics pipeline object with all information about extensions, swap chains, etc.
@@ -85,25 +98,46 @@ void RenderCode::initVulkan()
 
 	createCommandPool(); // The command pool will accomodate a series of queues of the same type of operations.
 
+	createStagingRing(); // Every upload below goes through this ring
+
+	createTimestampQueries(); // Measures how long the GPU takes for each frame
+
+	finishStartupStage("Pipeline");
+
 	createTextureImage(); // Creates a texture image data for Vulkan to handle
 
 	createTextureImageView();
 
 	createTextureSampler();
 
+	finishStartupStage("Texture");
+
+	/*Everything above only needed the vertex format, from here on the mesh itself is used*/
+	waitForMesh();
+
+	finishStartupStage("Mesh wait");
+
 	createVertexBuffer(); // Sets up the vertex buffer 
 
 	createIndexBuffer(); // Sets up the index buffer
 
+	createMaterialBuffer(); // The materials the draws select with a push constant
+
 	createUniformBuffer(); // Set up the uniform buffer
 
+	stagingRing.finish(); // Submits every startup upload in one command buffer and waits on its fence, the first frame reads what they wrote
+
+	finishStartupStage("Buffers");
+
 	createDescriptorPool(); // A descriptor pool is set up from which we will access descriptor sets
 
-	createDescriptorSet(); // Creates our descriptor sets
+	createDescriptorSets(); // Creates our descriptor sets, one per frame in flight
 
 	createCommandBuffers(); // Sets of instructions which are to be executed by a queue.
 
-	createSemaphores(); // As Vulkan doesn't synchronize for us (Aims for maximum performance) we have to make set up our own synchronization if we deem it to be required
+	createSyncObjects(); // As Vulkan doesn't synchronize for us (Aims for maximum performance) we have to make set up our own synchronization if we deem it to be required
+
+	finishStartupStage("Descriptors and commands");
 }
 
 /*A function we will use as a callback for OpenGL with GLFW (LearnOpenGl.com)*/
@@ -172,19 +206,71 @@ void RenderCode::mainLoop()
 	/*The function checks repeatedly at the start of the loop if glfw has been instructed to stop*/
 	while (!glfwWindowShouldClose(window))
 	{
+		/*A frame lasts one iteration, drawFrame returns as soon as the frame is submitted so the GPU renders it during the next ones*/
+		const auto frameStartTime = std::chrono::high_resolution_clock::now();
+
 		/*Checks continously for any changes that have been made and submits them immmedietely*/
 		glfwPollEvents();
 
 		processKeyboardInput(window, ubo, cameraForwardVector, cameraUpVector);
 
+		/*C switches the frustum culling on and off, to compare the frame times with and without it*/
+		const bool cullingKeyPressed = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+
+		if (cullingKeyPressed && !cullingKeyDown)
+		{
+			frustumCulling = !frustumCulling;
+		}
+
+		cullingKeyDown = cullingKeyPressed;
+
+		/*The uniform buffer slice and the command buffer of this frame may still be read by the GPU*/
+		waitForFrameInFlight();
+
+		const auto cullStartTime = std::chrono::high_resolution_clock::now();
+
 		updateUniformBuffer();
 
+		const auto cullEndTime = std::chrono::high_resolution_clock::now();
+
 		/*Displays the triangle to the screen*/
+		const size_t frameLod = currentLod;
+
 		drawFrame();
+
+		const auto frameEndTime = std::chrono::high_resolution_clock::now();
+
+		if (!firstFrameDrawn)
+		{
+			/*drawFrame no longer waits for the presentation, the startup only ends once the first frame is on screen*/
+			vkQueueWaitIdle(presentQueue);
+
+			finishStartupStage("First frame");
+			reportStartupStages();
+			firstFrameDrawn = true;
+		}
+		const double frameSeconds = std::chrono::duration<double, std::chrono::seconds::period>(frameEndTime - frameStartTime).count();
+
+		FrameStatistics& lodStatistics = lodFrameStatistics[frameLod];
+		FrameStatistics& cullingStatistics = cullingFrameStatistics[frustumCulling ? 1 : 0];
+
+		for (FrameStatistics* statistics : { &lodStatistics, &cullingStatistics })
+		{
+			statistics->frameCount++;
+			statistics->seconds += frameSeconds;
+			statistics->gpuSeconds += gpuFrameSeconds;
+			statistics->waitSeconds += frameWaitSeconds;
+			statistics->triangleCount += visibleTriangleCount;
+		}
+
+		/*The uniform update is dominated by the culling once the mesh has many chunks*/
+		cullingStatistics.cullSeconds += std::chrono::duration<double, std::chrono::seconds::period>(cullEndTime - cullStartTime).count();
 	}
 
 	/*This functions ensures all resources have been successfuly deallocated before continuing*/
 	vkDeviceWaitIdle(device);
+
+	reportFrameStatistics();
 }
 
 /*
@@ -213,26 +299,42 @@ void RenderCode::cleanup()
 	vkDestroyImageView(device, textureImageView, nullptr); // Destroys the image view created for the texture loader
 
 	vkDestroyImage(device, textureImage, nullptr); 
-	vkFreeMemory(device, textureImageMemory, nullptr);
+	memoryAllocator.free(textureImageMemory);
 
 	vkDestroyDescriptorPool(device, descriptorPool, nullptr); // Destroys the pool of descriptor sets
 
 	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr); // The descriptor set should remain available up to the point we may need to create a new graphics pipeline. (End of the program)
 
 	vkDestroyBuffer(device, uniformBuffer, nullptr); // The draw calls used by the unform buffer will be used until the end
-	vkFreeMemory(device, uniformBufferMemory, nullptr); // So both memory and buffer should be used upon exitting the program
+	memoryAllocator.free(uniformBufferMemory); // So both memory and buffer should be used upon exitting the program
+
+	vkDestroyBuffer(device, materialBuffer, nullptr);
+	memoryAllocator.free(materialBufferMemory);
 
 	vkDestroyBuffer(device, indexBuffer, nullptr); // Destroy the index buffer
-	vkFreeMemory(device, indexBufferMemory, nullptr); // Free memory allocated to store the data from the index buffer 
+	memoryAllocator.free(indexBufferMemory); // Free memory allocated to store the data from the index buffer 
 
 	vkDestroyBuffer(device, vertexBuffer, nullptr); // The buffer should be available for during the entire rendering process, and only should be destroyed once we have no use for it anymore. I.e. when we terminate the program.
-	vkFreeMemory(device, vertexBufferMemory, nullptr); // Free the memory allocated on the GPU for the vertexBuffer
+	memoryAllocator.free(vertexBufferMemory); // Free the memory allocated on the GPU for the vertexBuffer
 
 	/*The semaphores should be cleand up at the end of the program once no mor synchronization is neccessary*/
-	vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
-	vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+	for (FrameResources& frame : frames)
+	{
+		vkDestroySemaphore(device, frame.renderFinishedSemaphore, nullptr);
+		vkDestroySemaphore(device, frame.imageAvailableSemaphore, nullptr);
+		vkDestroyFence(device, frame.inFlightFence, nullptr);
+	}
+
+	stagingRing.destroy(memoryAllocator); // Waits for the uploads still in flight and destroys its own command pools
+
+	vkDestroyCommandPool(device, commandPool, nullptr); // Frees the command buffers of the frames as well
+
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkDestroyQueryPool(device, timestampQueryPool, nullptr);
+	}
 
-	vkDestroyCommandPool(device, commandPool, nullptr);
+	memoryAllocator.destroy(); // Releases the memory blocks, every resource placed in them is gone by now
 
 	vkDestroyDevice(device, nullptr); // Free the resources for the logical device interface
 	DestroyDebugReportCallbackEXT(instance, callback, nullptr); // Free the resources for the debug function
@@ -272,7 +374,7 @@ information that we want a Vulkan context, and surpress the creation of a OpenGL
 */
 void RenderCode::initWindow()
 {
-
+	const ScopedTraceZone traceZone("initWindow", "window");
 
 	/*Initializes the GLFW library*/
 	glfwInit();
@@ -480,6 +582,34 @@ QueueFamilyIndices RenderCode::findQueueFamilies(VkPhysicalDevice device)
 		i++;
 	}
 
+	/*
+	A family which only transfers is usually backed by the copy engines, so uploads there run alongside
+	the frames instead of queueing behind them. One which cannot compute either is the most specialised
+	*/
+	int transferOnlyFamily = -1;
+
+	for (int family = 0; family < static_cast<int>(queueFamilies.size()); family++)
+	{
+		const VkQueueFlags flags = queueFamilies[family].queueFlags;
+
+		if (queueFamilies[family].queueCount > 0 && (flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			if (!(flags & VK_QUEUE_COMPUTE_BIT))
+			{
+				transferOnlyFamily = family;
+				break;
+			}
+
+			if (transferOnlyFamily < 0)
+			{
+				transferOnlyFamily = family;
+			}
+		}
+	}
+
+	/*Graphics queues support transfers implicitly, so they are the fallback*/
+	indices.transferFamily = (transferOnlyFamily >= 0) ? transferOnlyFamily : indices.graphicsFamily;
+
 	return indices;
 }
 
@@ -528,6 +658,8 @@ only include errors which we worry about.
 */
 void RenderCode::setupDebugCallback()
 {
+	const ScopedTraceZone traceZone("setupDebugCallback", "vulkan");
+
 	/*If the validation layers have not been enabled*/
 	if (!enableValidationLayers)
 	{
@@ -558,6 +690,7 @@ optimizations for our application.
 */
 void RenderCode::createInstance()
 {
+	const ScopedTraceZone traceZone("createInstance", "vulkan");
 
 	/*Check if validation layers are available by the SDK in use and we have found a suitable validation layer for our applicaiton*/
 	if (enableValidationLayers && !checkValidationLayerSupport())
@@ -624,6 +757,8 @@ Some machines use more than a single device. This is also important. We must spe
 */
 void RenderCode::pickPhysicalDevice()
 {
+	const ScopedTraceZone traceZone("pickPhysicalDevice", "vulkan");
+
 	uint32_t deviceCount = 0;
 
 	/*Count the amount of devices there are on the machine we are working one, which support Vulkan*/
@@ -672,13 +807,15 @@ stored in the physical device handle.
 */
 void RenderCode::createLogicalDevice()
 {
+	const ScopedTraceZone traceZone("createLogicalDevice", "vulkan");
+
 	/*Get the available queue families*/
 	QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
 
 	std::vector <VkDeviceQueueCreateInfo> queueCreateInfos;
 
 	/*The unique queue families our application requires for it's use*/
-	std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+	std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
 
 	/*Vulkan allows you to prioritize scheduling by giving a priority float between 0-1 on the importance of a queue*/
 	/*This is neccessary even if you only have a single queue*/
@@ -737,6 +874,7 @@ void RenderCode::createLogicalDevice()
 
 	vkGetDeviceQueue(device, indices.graphicsFamily, 0, &graphicsQueue); // A handle to the graphics queue family.
 	vkGetDeviceQueue(device, indices.presentFamily, 0, &presentQueue); // A handle to the presentation queue family
+	vkGetDeviceQueue(device, indices.transferFamily, 0, &transferQueue); // A handle to the queue the uploads run on
 }
 
 /*
@@ -748,6 +886,8 @@ implementation for each platform.
 */
 void RenderCode::createSurface()
 {
+	const ScopedTraceZone traceZone("createSurface", "vulkan");
+
 	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
 	{
 		throw std::runtime_error("Failed to create window surface!");
@@ -930,6 +1070,8 @@ by one and presented to the screen.
 */
 void RenderCode::createSwapChain()
 {
+	const ScopedTraceZone traceZone("createSwapChain", "vulkan");
+
 	/*Retirieve swap chain requirements*/
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
@@ -1016,6 +1158,8 @@ and focus only on a part of it.
 */
 void RenderCode::createImageViews()
 {
+	const ScopedTraceZone traceZone("createImageViews", "vulkan");
+
 	swapChainImageViews.resize(swapChainImages.size());
 
 	for (uint32_t i = 0; i < swapChainImages.size(); i++) {
@@ -1041,6 +1185,7 @@ the screen with pixels.
 */
 void RenderCode::createGraphicsPipeline()
 {
+	const ScopedTraceZone traceZone("createGraphicsPipeline", "vulkan");
 
 	/*
 	Vulkan uses bytecode in oposed to GLSL human readable syntax
@@ -1077,6 +1222,22 @@ void RenderCode::createGraphicsPipeline()
 	vertShaderStageInfo.module = vertShaderModule;
 	vertShaderStageInfo.pName = "main"; // Since we may have multiple shaders in the shader module (?) we have to specify the entry point which will be unique for each shader inside the module. This way we distinguish them.
 
+	/*The vertex shader only decodes the octahedral normals if the specialization constant tells it the vertices are compact*/
+	const VkBool32 compactVertices = (vertexFormat == VertexFormat::Compact) ? VK_TRUE : VK_FALSE;
+
+	VkSpecializationMapEntry specializationEntry = {};
+	specializationEntry.constantID = 0; // constant_id in the shader
+	specializationEntry.offset = 0;
+	specializationEntry.size = sizeof(compactVertices);
+
+	VkSpecializationInfo specializationInfo = {};
+	specializationInfo.mapEntryCount = 1;
+	specializationInfo.pMapEntries = &specializationEntry;
+	specializationInfo.dataSize = sizeof(compactVertices);
+	specializationInfo.pData = &compactVertices;
+
+	vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
 										/*Pass the fragment shader module to the fragment shader*/
 	VkPipelineShaderStageCreateInfo fragShaderStageInfo = {};
 	fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -1088,8 +1249,8 @@ void RenderCode::createGraphicsPipeline()
 	VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
 
 	/*Gets the binding descriptions which we have created. It recieves information about the layout of the bindings ( if there are more than one) and the layout of the attributes contained in the bound array*/
-	auto bindingDescription = Vertex::getBindingDescription();
-	auto attributeDescriptions = Vertex::getAttributeDescriptions();
+	auto bindingDescription = (vertexFormat == VertexFormat::Compact) ? CompactVertex::getBindingDescription() : Vertex::getBindingDescription();
+	auto attributeDescriptions = (vertexFormat == VertexFormat::Compact) ? CompactVertex::getAttributeDescriptions() : Vertex::getAttributeDescriptions();
 
 	/*
 	Description of the format of the vertex data
@@ -1227,8 +1388,20 @@ void RenderCode::createGraphicsPipeline()
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.setLayoutCount = 1; // This specifies the amount of descriptor layouts the pipeline will make use of. 
 	pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = 0;
+
+	/*The bounds for decoding compact positions, small enough to be push constants instead of another uniform*/
+	VkPushConstantRange pushConstantRanges[2] = {};
+	pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRanges[0].offset = 0;
+	pushConstantRanges[0].size = sizeof(VertexDecode);
+
+	/*The material of each draw follows them, for the fragment shader*/
+	pushConstantRanges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRanges[1].offset = sizeof(VertexDecode);
+	pushConstantRanges[1].size = sizeof(uint32_t);
+
+	pipelineLayoutInfo.pushConstantRangeCount = 2;
+	pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges;
 
 	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
 	{
@@ -1336,6 +1509,8 @@ samples to use for each of them and how their contents should be handled through
 */
 void RenderCode::createRenderPass()
 {
+	const ScopedTraceZone traceZone("createRenderPass", "vulkan");
+
 	/*A single coloru buffer attachmetn represented bv animage in teh swap chain*/
 	VkAttachmentDescription colorAttachment = {};
 	colorAttachment.format = swapChainImageFormat; // Format should match that of the swap chain
@@ -1413,6 +1588,8 @@ VkImage that we use using the framebuffer.
 */
 void RenderCode::createFramebuffers()
 {
+	const ScopedTraceZone traceZone("createFramebuffers", "vulkan");
+
 	/*Resize the buffer to accomodate all framebuffers*/
 	swapChainFramebuffers.resize(swapChainImageViews.size());
 
@@ -1450,6 +1627,8 @@ After that, you just have to tell Vulkan to execute the commands in the main loo
 */
 void RenderCode::createCommandPool()
 {
+	const ScopedTraceZone traceZone("createCommandPool", "vulkan");
+
 	/*Command pools will have commandbuffers of the same type only, so we must have information about which type of queues are supported*/
 	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
 
@@ -1461,7 +1640,7 @@ void RenderCode::createCommandPool()
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily; // draw commands
-	poolInfo.flags = 0; // Hints how new commands are being recoreded. If they often change or they persist.
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Hints how new commands are being recoreded. If they often change or they persist. The command buffers get recorded again every frame
 
 	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
 	{
@@ -1469,18 +1648,47 @@ void RenderCode::createCommandPool()
 	}
 }
 
+/*
+The ring copies on the transfer queue, whose family limits
+how finely images may be split into copy regions.
+*/
+void RenderCode::createStagingRing()
+{
+	const ScopedTraceZone traceZone("createStagingRing", "vulkan");
+
+	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	UploadQueues queues;
+	queues.transferQueue = transferQueue;
+	queues.transferFamily = static_cast<uint32_t>(queueFamilyIndices.transferFamily);
+	queues.graphicsQueue = graphicsQueue;
+	queues.graphicsFamily = static_cast<uint32_t>(queueFamilyIndices.graphicsFamily);
+	queues.transferGranularity = queueFamilies[queueFamilyIndices.transferFamily].minImageTransferGranularity;
+
+	stagingRing.initialize(device, memoryAllocator, queues);
+}
+
 /*
 Command buffers are used to record operations
 that we would like to perform.
 
 We only want to perform graphics operations(drawcalls)
-here. Some draw calls, however, require binding the
-correct framebuffer, as such we must record a command buffer
-for every image inside our swap chain.
+here. Every frame in flight has a command buffer of its own,
+which is recorded for whichever swap chain image it renders to.
+They do not depend on the swap chain, so they are kept when it
+is recreated.
 */
 void RenderCode::createCommandBuffers()
 {
-	commandBuffers.resize(swapChainFramebuffers.size());
+	const ScopedTraceZone traceZone("createCommandBuffers", "vulkan");
+
+	std::array<VkCommandBuffer, MAX_FRAMES_IN_FLIGHT> commandBuffers;
 
 	/*Struct that would be passed to the Vulkan allocation function*/
 	VkCommandBufferAllocateInfo allocInfo = {};
@@ -1495,65 +1703,260 @@ void RenderCode::createCommandBuffers()
 		throw std::runtime_error("Failed to allocate command buffer!");
 	}
 
-	/*Begin recording command buffers*/
-	for (size_t i = 0; i < commandBuffers.size(); i++)
+	for (size_t frame = 0; frame < frames.size(); frame++)
+	{
+		frames[frame].commandBuffer = commandBuffers[frame];
+	}
+
+	/*The draws depend on the view, so the command buffers are recorded by drawFrame*/
+}
+
+/*
+Records the commands of one frame for a swap chain image. The detail
+level and the chunks inside the view are part of the draw calls, so
+this runs again every frame, just before the command buffer is submitted.
+*/
+void RenderCode::recordCommandBuffer(size_t frame, uint32_t imageIndex)
+{
+	const VkCommandBuffer commandBuffer = frames[frame].commandBuffer;
+	const uint32_t firstQuery = static_cast<uint32_t>(2 * frame); // Each frame has its own pair of timestamps, the others may not be read back yet
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT; // How we're going to use the command buffer. Submitted once, then recorded again for the next frame.
+	beginInfo.pInheritanceInfo = nullptr;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	/*The queries have to be reset outside of a render pass before they are written again*/
+	if (timestampQueryPool != VK_NULL_HANDLE)
 	{
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT; // How we're going to use the command buffer. Can be resubmitted while pending execution, in this case.
-		beginInfo.pInheritanceInfo = nullptr;
+		vkCmdResetQueryPool(commandBuffer, timestampQueryPool, firstQuery, 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestampQueryPool, firstQuery);
+	}
+
+	/*Bind the correct framebuffer for each image, and reuse the same renderpass as we only have one we're interested in*/
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = renderPass;
+	renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
+
+	/*Keep the rendering area to the same dimensions as the whole window*/
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = swapChainExtent;
+
+	/*When the framebuffer is reset, update the values to black*/
+	VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearColor;
 
-		vkBeginCommandBuffer(commandBuffers[i], &beginInfo);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // Execute the command buffers with only the primary command buffer itself is provided and no secondary command buffers are there.
 
-		/*Bind the correct framebuffer for each image, and reuse the same renderpass as we only have one we're interested in*/
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = renderPass;
-		renderPassInfo.framebuffer = swapChainFramebuffers[i];
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline); // Bind the GRAPHICS pipeline
 
-		/*Keep the rendering area to the same dimensions as the whole window*/
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = swapChainExtent;
+																							 /*
+																							 The number are as follows
 
-		/*When the framebuffer is reset, update the values to black*/
-		VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
+																							 3 - vertices in the triangle
+																							 1 - Triangle in the scene
+																							 0 - Offset is 0 as data is tightly packed
+																							 0 - Offset between instances is 0, we only have one
+																							 */
 
-		vkCmdBeginRenderPass(commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE); // Execute the command buffers with only the primary command buffer itself is provided and no secondary command buffers are there.
+	VkBuffer vertexBuffers[] = { vertexBuffer }; // We only have one vertex buffer
 
-		vkCmdBindPipeline(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline); // Bind the GRAPHICS pipeline
+	VkDeviceSize offsets[] = { 0 }; // This array specifies a one-to-one mapping between the ammount of vertex buffers and the offsets of each buffer, i.e from where to start reading vertex data from.
+
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets); // This call is used to bind vertex buffers to bindings.
+
+	vkCmdBindIndexBuffer(commandBuffer, indexBuffer, 0, indexType); // You can only have one idnex buffer, apparently
+
+	vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(VertexDecode), &vertexDecode); // Identity for full vertices, the mesh bounds for compact ones
+
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &frames[frame].descriptorSet, 0, nullptr); // They are not unique to graphics pipelines. Hence we specify the bind point to be graphics, 
+
+	//vkCmdDraw(commandBuffer, 3, 1, 0, 0); /**DRAW THE TRIANGLE***/
+
+	/*The ranges come sorted by submesh, so the material index is only pushed when it changes*/
+	uint32_t pushedMaterial = UINT32_MAX;
+
+	/*All levels index the same vertices, only the ranges of the index buffer change*/
+	for (const DrawRange& range : visibleRanges)
+	{
+		if (range.material != pushedMaterial)
+		{
+			vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(VertexDecode), sizeof(uint32_t), &range.material);
+			pushedMaterial = range.material;
+		}
+
+		vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, range.indexOffset, 0, 0);
+	}
 
-																								 /*
-																								 The number are as follows
+	vkCmdEndRenderPass(commandBuffer); // End render pass
 
-																								 3 - vertices in the triangle
-																								 1 - Triangle in the scene
-																								 0 - Offset is 0 as data is tightly packed
-																								 0 - Offset between instances is 0, we only have one
-																								 */
+	if (timestampQueryPool != VK_NULL_HANDLE)
+	{
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestampQueryPool, firstQuery + 1);
+	}
 
-		VkBuffer vertexBuffers[] = { vertexBuffer }; // We only have one vertex buffer
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to record command buffer!");
+	}
+}
 
-		VkDeviceSize offsets[] = { 0 }; // This array specifies a one-to-one mapping between the ammount of vertex buffers and the offsets of each buffer, i.e from where to start reading vertex data from.
+/*
+Projects the error of each detail level onto the screen. The error
+is a distance in object space, at the distance of the closest point
+of the bounding sphere it covers error * pixelsPerUnit pixels.
+*/
+void RenderCode::selectLod(float fieldOfView)
+{
+	/*The model matrix only rotates around the origin, so the sphere keeps its radius*/
+	const glm::vec3 worldCenter = glm::vec3(ubo.model * glm::vec4(meshCenter, 1.0f));
+	const float distance = (std::max)(glm::length(ubo.worldViewPosition - worldCenter) - meshRadius, 0.1f); // Not closer than the near plane
 
-		vkCmdBindVertexBuffers(commandBuffers[i], 0, 1, vertexBuffers, offsets); // This call is used to bind vertex buffers to bindings.
+	const float pixelsPerUnit = swapChainExtent.height / (2.0f * distance * std::tan(fieldOfView * 0.5f));
 
-		vkCmdBindIndexBuffer(commandBuffers[i], indexBuffer, 0, VK_INDEX_TYPE_UINT32); // You can only have one idnex buffer, apparently
+	currentLod = 0;
 
-		vkCmdBindDescriptorSets(commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr); // They are not unique to graphics pipelines. Hence we specify the bind point to be graphics, 
+	for (size_t lod = lods.size() - 1; lod > 0; lod--)
+	{
+		if (lods[lod].error * pixelsPerUnit <= LOD_PIXEL_ERROR)
+		{
+			currentLod = lod;
+			break;
+		}
+	}
+}
 
-		//vkCmdDraw(commandBuffers[i], 3, 1, 0, 0); /**DRAW THE TRIANGLE***/
+/*
+Tests the chunks of the current level against the frustum of the
+combined matrices, in object space so the boxes never have to be transformed.
+*/
+void RenderCode::cullInvisibleChunks()
+{
+	const MeshLod& lod = lods[currentLod];
 
-		vkCmdDrawIndexed(commandBuffers[i], static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
+	visibleRanges.clear();
 
-		vkCmdEndRenderPass(commandBuffers[i]); // End render pass
+	/*A level which was not split is still culled object by object, through the bounds of its submeshes*/
+	if (frustumCulling && lod.chunkCount == 0 && lod.submeshCount > 0)
+	{
+		cullChunks(submeshChunks, lod.firstSubmesh, lod.submeshCount, ubo.proj * ubo.view * ubo.model, visibleRanges);
+	}
+	else if (!frustumCulling || lod.chunkCount == 0)
+	{
+		/*One range per submesh, or the whole level with the default material*/
+		for (uint32_t submesh = lod.firstSubmesh; submesh < lod.firstSubmesh + lod.submeshCount; submesh++)
+		{
+			visibleRanges.push_back({ submeshes[submesh].indexOffset, submeshes[submesh].indexCount, submeshes[submesh].material });
+		}
 
-		if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
+		if (lod.submeshCount == 0)
 		{
-			throw std::runtime_error("Failed to record command buffer!");
+			visibleRanges.push_back({ lod.indexOffset, lod.indexCount, 0 });
 		}
 	}
+	else
+	{
+		cullChunks(chunks, lod.firstChunk, lod.chunkCount, ubo.proj * ubo.view * ubo.model, visibleRanges);
+	}
+
+	visibleTriangleCount = 0;
+
+	for (const DrawRange& range : visibleRanges)
+	{
+		visibleTriangleCount += range.indexCount / 3;
+	}
+}
+
+/*
+The timestamps are only written if the graphics queue family has valid
+timestamp bits, otherwise the frames are measured on the CPU alone.
+*/
+void RenderCode::createTimestampQueries()
+{
+	const ScopedTraceZone traceZone("createTimestampQueries", "vulkan");
+
+	QueueFamilyIndices queueFamilyIndices = findQueueFamilies(physicalDevice);
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	const uint32_t validBits = queueFamilies[queueFamilyIndices.graphicsFamily].timestampValidBits;
+
+	if (validBits == 0)
+	{
+		return;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	timestampPeriod = properties.limits.timestampPeriod;
+	timestampMask = (validBits >= 64) ? ~0ull : ((1ull << validBits) - 1);
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 2 * MAX_FRAMES_IN_FLIGHT; // Start and end of each frame in flight
+
+	if (vkCreateQueryPool(device, &queryPoolInfo, nullptr, &timestampQueryPool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the timestamp query pool!");
+	}
+}
+
+void RenderCode::reportFrameStatistics() const
+{
+	/*Average frame times, and the GPU time if it was measured*/
+	auto printFrames = [this](const FrameStatistics& statistics)
+	{
+		std::cout << statistics.frameCount << " frames";
+
+		if (statistics.frameCount > 0)
+		{
+			std::cout << ", " << 1000.0 * statistics.seconds / statistics.frameCount << " ms per frame";
+
+			if (timestampQueryPool != VK_NULL_HANDLE)
+			{
+				std::cout << ", " << 1000.0 * statistics.gpuSeconds / statistics.frameCount << " ms on the GPU";
+			}
+
+			/*Without overlap a frame takes the CPU work plus the whole GPU time, so the wait is the part of the GPU time the CPU could not hide*/
+			std::cout << ", " << 1000.0 * statistics.waitSeconds / statistics.frameCount << " ms waiting for the GPU";
+		}
+	};
+
+	std::cout << "Detail levels:" << std::endl;
+
+	for (size_t lod = 0; lod < lods.size(); lod++)
+	{
+		std::cout << "  LOD " << lod << ": " << lods[lod].indexCount / 3 << " triangles in " << lods[lod].submeshCount << " submeshes and " << lods[lod].chunkCount << " chunks, error " << lods[lod].error << ", ";
+		printFrames(lodFrameStatistics[lod]);
+		std::cout << std::endl;
+	}
+
+	std::cout << "Frustum culling:" << std::endl;
+
+	for (unsigned int culling = 0; culling < 2; culling++)
+	{
+		const FrameStatistics& statistics = cullingFrameStatistics[culling];
+
+		std::cout << "  " << (culling ? "On: " : "Off: ");
+		printFrames(statistics);
+
+		if (statistics.frameCount > 0)
+		{
+			std::cout << ", " << statistics.triangleCount / statistics.frameCount << " triangles and " << 1000000.0 * statistics.cullSeconds / statistics.frameCount << " us culling per frame";
+		}
+
+		std::cout << std::endl;
+	}
 }
 
 /*
@@ -1569,14 +1972,17 @@ and return the image to the swap chain for presentation.
 
 Most of the functions, howver, are excuted asynchronously.
 Vulkan doesn't provide any default synchronizaiton and as such we are therefore
-meant to synchronize it ourselves
+meant to synchronize it ourselves. The frame is not waited for, its fence
+is signalled once it has been rendered and waitForFrameInFlight blocks on it
+only when the frame's resources come round again.
 */
 void RenderCode::drawFrame()
 {
+	FrameResources& frame = frames[currentFrame];
 
 	/*Acquire an image that is ready to be rendered from the swap chain via it's index*/
 	uint32_t imageIndex;
-	VkResult result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(), imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex); // Specify the device and swapchain from which to acquire the image. Time in nanoseconds is passed for the image to be made available.
+	VkResult result = vkAcquireNextImageKHR(device, swapChain, std::numeric_limits<uint64_t>::max(), frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex); // Specify the device and swapchain from which to acquire the image. Time in nanoseconds is passed for the image to be made available.
 
 																																							/*If the swap chain has become incompativle with the surface*/
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
@@ -1589,11 +1995,14 @@ void RenderCode::drawFrame()
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
+	/*waitForFrameInFlight made sure the GPU is done with this command buffer, so it can be recorded again*/
+	recordCommandBuffer(currentFrame, imageIndex);
+
 	/*Queue submission and synchronization to the device*/
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore }; // The semaphores which must be waited on
+	VkSemaphore waitSemaphores[] = { frame.imageAvailableSemaphore }; // The semaphores which must be waited on
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT }; // The stages of the pipeline when these semaphores will be waited on. This is the stage of the pipeline which is used for writing to the colour attachment
 	submitInfo.waitSemaphoreCount = 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
@@ -1601,19 +2010,25 @@ void RenderCode::drawFrame()
 
 	/*Submit the command buffer that binds the swap chain image*/
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffers[imageIndex];
+	submitInfo.pCommandBuffers = &frame.commandBuffer;
 
 	/*Specifies which semaphores to signal once command buffers have finished execution*/
-	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
+	VkSemaphore signalSemaphores[] = { frame.renderFinishedSemaphore };
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
+	/*The fence is only reset once the frame is certain to be submitted, a frame skipped above leaves it signalled for the next wait*/
+	vkResetFences(device, 1, &frame.inFlightFence);
+
 	/*This submits the queue to the device for execution*/
-	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, frame.inFlightFence) != VK_SUCCESS)
 	{
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
 
+	frame.timestampsWritten = (timestampQueryPool != VK_NULL_HANDLE);
+	currentFrame = (currentFrame + 1) % frames.size();
+
 	/*
 	Once we have set up all the requirements to produce a complete image,
 	we must submit it to the swap chain for presentation.
@@ -1639,26 +2054,67 @@ void RenderCode::drawFrame()
 	else if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
+}
+
+/*
+Only blocks while the GPU is still rendering the frame which used the
+same resources, MAX_FRAMES_IN_FLIGHT frames ago. The timestamps read
+here are of that frame, which only shifts the GPU times by a few frames.
+*/
+void RenderCode::waitForFrameInFlight()
+{
+	FrameResources& frame = frames[currentFrame];
+
+	const auto waitStartTime = std::chrono::high_resolution_clock::now();
 
-	vkQueueWaitIdle(presentQueue); // Wait for presentation to fully finish before drawin the next frame
+	vkWaitForFences(device, 1, &frame.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
 
+	frameWaitSeconds = std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - waitStartTime).count();
+	gpuFrameSeconds = 0.0; // Stays 0 if the frame's resources were not used yet
+
+	/*The fence signalled after the frame was rendered, so its timestamps are available without waiting*/
+	if (frame.timestampsWritten)
+	{
+		uint64_t timestamps[2] = {};
+
+		if (vkGetQueryPoolResults(device, timestampQueryPool, static_cast<uint32_t>(2 * currentFrame), 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+		{
+			const uint64_t ticks = ((timestamps[1] & timestampMask) - (timestamps[0] & timestampMask)) & timestampMask;
+			gpuFrameSeconds = ticks * static_cast<double>(timestampPeriod) * 1e-9;
+		}
+
+		frame.timestampsWritten = false; // Read once, a skipped frame does not count them again
+	}
 }
 
 /*
-Creates two semaphores for global syncrhonization.
+Creates two semaphores and a fence for every frame in flight.
 One semaphore to signal that an image has been acquired and can be rendered.
 
 One semaphore will signal that rendering has finished and can be passed to the
 swap chain to be presented.
+
+The fence tells the CPU when the GPU is done with the frame, so its
+command buffer and uniform buffer slice can be written again.
 */
-void RenderCode::createSemaphores()
+void RenderCode::createSyncObjects()
 {
+	const ScopedTraceZone traceZone("createSyncObjects", "vulkan");
+
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS || vkCreateSemaphore(device, &semaphoreInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS)
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // The first wait on each frame returns immediately
+
+	for (FrameResources& frame : frames)
 	{
-		throw std::runtime_error("Failed to create semaphores");
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore) != VK_SUCCESS || vkCreateSemaphore(device, &semaphoreInfo, nullptr, &frame.renderFinishedSemaphore) != VK_SUCCESS
+			|| vkCreateFence(device, &fenceInfo, nullptr, &frame.inFlightFence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create the synchronization objects of a frame");
+		}
 	}
 }
 
@@ -1689,7 +2145,8 @@ void RenderCode::recreateSwapChain()
 	createRenderPass(); // The render pass depends on the format of the swap chain
 	createGraphicsPipeline(); // We now have to recrtee the entire pipeline as scissor and viewport information is specified here
 	createFramebuffers();  // The framebuffer is directily dependent on the swap chain
-	createCommandBuffers(); // Same for the command buffer
+
+	/*The command buffers of the frames pick the framebuffer when they are recorded, so they are kept*/
 
 }
 
@@ -1703,9 +2160,6 @@ void RenderCode::cleanupSwapChain()
 		vkDestroyFramebuffer(device, swapChainFramebuffers[i], nullptr);
 	}
 
-	/*We only need to clean up the command buffers, and then reuse the command pool for efficiency purposes*/
-	vkFreeCommandBuffers(device, commandPool, static_cast<uint32_t>(commandBuffers.size()), commandBuffers.data());
-
 	vkDestroyPipeline(device, graphicsPipeline, nullptr); // Destroy the graphics pipeline information
 	vkDestroyPipelineLayout(device, pipelineLayout, nullptr); // Destroy the pipeline layout which contains the layout of constants we'll be passing to the shaders
 	vkDestroyRenderPass(device, renderPass, nullptr); //Destroy the render pass, along with it's subpasses and attachment information
@@ -1732,58 +2186,30 @@ void RenderCode::onWindowResized(GLFWwindow * window, int width, int height)
 */
 void RenderCode::createVertexBuffer()
 {
-	VkDeviceSize bufferSize = sizeof(vertices[0]) * vertices.size(); // Size required for allocating the vertex buffer to GPU memory
-
-	VkBuffer stagingBuffer; // temporary buffer in host memory
-	VkDeviceMemory stagingBufferMemory;
+	const ScopedTraceZone traceZone("createVertexBuffer", "vulkan");
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
+	/*Compact vertices are only encoded here, the loader and the mesh cache always work with full vertices*/
+	std::vector<CompactVertex> compactVertices;
+	const void* vertexData = vertices.data();
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data); // Map the vertex data to the buffer
-		memcpy(data, vertices.data(), (size_t) bufferSize); // Copy the data to the locaiton we now reference via the data pointer
-	vkUnmapMemory(device, stagingBufferMemory); // and then unmap the data
+	if (vertexFormat == VertexFormat::Compact)
+	{
+		compactVertices = encodeCompactVertices(vertices, vertexDecode);
+		vertexData = compactVertices.data();
+	}
 
-	/*The copy may not happen immediately. One way to handle it is to specify heap memory that is host-coherent as we have above!!!*/
-	/*This may lead to worse memory than explicit flushing, but leave that be for now*/
+	VkDeviceSize bufferSize = vertexStride(vertexFormat) * vertices.size(); // Size required for allocating the vertex buffer to GPU memory
 
 	/*The type of memory that would beused is device memory for the vertex buffer now. This means we cannot map memory using the vertex buffer, but we can get data from the staging buffer?*/
 	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, vertexBuffer, vertexBufferMemory); // The vertex buffer will be used as destination buffer for the transfer
 
-	/*Copy from host to device*/
-	copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-
-	/*Clean up*/
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	/*Copy from host to device, through the staging ring in chunks instead of a staging buffer as large as the mesh*/
+	stagingRing.uploadBuffer(vertexData, bufferSize, vertexBuffer);
 
 	/*At this point data will be read from the GPU, unlike vefore when we were storing and reading from CPU-side*/
 }
 
-/*
-	Finds the correct type of memory required by a call to a memory allocaiton.
-*/
-uint32_t RenderCode::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-
-	/*First we myst query the device to see what types of memory are offered by it's proeprties*/
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties); 
-
-	/*Check for suitable memory type*/
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) // Memory type arrays specify heaps and other properties of that type, which we need to know.
-	{
-		if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) // Weird black magic
-		{
-			return i; // Return index of the memProperties struct which contains everything we need
-		}
-	}
-
-	// Else throw an exception
-	throw std::runtime_error("Failed to find suitable memory type!");
-}
-
-void RenderCode::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, VkDeviceMemory & bufferMemory)
+void RenderCode::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, DeviceAllocation & bufferMemory)
 {
 
 	VkBufferCreateInfo bufferInfo = {};
@@ -1802,60 +2228,57 @@ void RenderCode::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMem
 	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
 
 	/*We know the requirements in terms of memory for our application and the supported memory types on the GPU*/
-	/*Therefore we can now start allocating the memory on the GPU of our vertex buffer*/
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	/*Therefore we can now place the buffer in one of the memory blocks, the allocator picks the memory type and honours the alignment*/
+	bufferMemory = memoryAllocator.allocate(memRequirements, properties, DeviceResourceKind::Buffer);
 
-	allocInfo.allocationSize = memRequirements.size; // The size of the data in the container
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties); // The type of memory allocation
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS)
-	{
-		throw std::runtime_error("Failed to allcoate vertex buffer memory!");
-	}
-
-	/*If memory allocation was succesful we can now associate this memory on the GPU with a handle*/
-	vkBindBufferMemory(device, buffer, bufferMemory, 0); // The 4th paramater is some sort of alignment 
+	/*The buffer starts at its offset inside the shared block*/
+	vkBindBufferMemory(device, buffer, bufferMemory.memory, bufferMemory.offset);
 }
 
 
 /*Copies over data from a buffer specifed as source to one specifed as destination. It must pass the amount of data to be transferred*/
-void RenderCode::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+/*Set up the index buffer*/
+void RenderCode::createIndexBuffer()
 {
-	/*Memory transfer operations are executed using command Buffers*/
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands(); // REcords a command buffer
+	const ScopedTraceZone traceZone("createIndexBuffer", "vulkan");
 
-	VkBufferCopy copyRegion = {}; 
-	copyRegion.size = size; // Size of the region we want to copy
-	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+	/*
+		With at most 65536 vertices every index fits in 16 bits, which halves the index buffer.
+		Primitive restart is disabled, so 0xFFFF is an ordinary index.
+	*/
+	std::vector<uint16_t> shortIndices;
+	const void* indexData = indices.data();
+	indexType = VK_INDEX_TYPE_UINT32;
 
-	endSingleTimeCommands(commandBuffer); // Once it's done, we do not need it anymore so free memory associated with it
+	if (vertices.size() <= 65536)
+	{
+		shortIndices.resize(indices.size());
 
-}
+		for (size_t index = 0; index < indices.size(); index++)
+		{
+			shortIndices[index] = static_cast<uint16_t>(indices[index]);
+		}
 
-/*Set up the index buffer*/
-void RenderCode::createIndexBuffer()
-{
+		indexData = shortIndices.data();
+		indexType = VK_INDEX_TYPE_UINT16;
+	}
 
-	VkDeviceSize bufferSize = sizeof(indices[0]) * indices.size(); // The size in bytes of the index data
+	VkDeviceSize bufferSize = ((indexType == VK_INDEX_TYPE_UINT16) ? sizeof(uint16_t) : sizeof(uint32_t)) * indices.size(); // The size in bytes of the index data
 
-	/*We create a temporary buffer once more*/
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory); // Notice the usage is set to index buffer usage
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory); // Crates the staging buffer
+	stagingRing.uploadBuffer(indexData, bufferSize, indexBuffer);
+}
 
-	void* data;
-	vkMapMemory(device, stagingBufferMemory, 0, bufferSize, 0, &data);
-	memcpy(data, indices.data(), (size_t)bufferSize);
-	vkUnmapMemory(device, stagingBufferMemory);
+void RenderCode::createMaterialBuffer()
+{
+	const ScopedTraceZone traceZone("createMaterialBuffer", "vulkan");
 
-	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, indexBuffer, indexBufferMemory); // Notice the usage is set to index buffer usage
+	VkDeviceSize bufferSize = sizeof(Material) * materials.size(); // Three vec4 per material, the same layout as in the shader
 
-	copyBuffer(stagingBuffer, indexBuffer, bufferSize);
+	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, materialBuffer, materialBufferMemory);
 
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	stagingRing.uploadBuffer(materials.data(), bufferSize, materialBuffer);
 }
 
 /*
@@ -1864,6 +2287,8 @@ void RenderCode::createIndexBuffer()
 */
 void RenderCode::createDescriptorSetLayout()
 {
+	const ScopedTraceZone traceZone("createDescriptorSetLayout", "vulkan");
+
 	VkDescriptorSetLayoutBinding uboLayoutBinding = {}; // Describes each binding. If you bind multiple, every single one of the bindings must be described
 	uboLayoutBinding.binding = 0; // The binding used inside the shader
 	uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; // Tell it is a uniform buffer object
@@ -1879,7 +2304,14 @@ void RenderCode::createDescriptorSetLayout()
 	samplerLayoutBinding.pImmutableSamplers = nullptr;
 	samplerLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT; // Used only the fragment shader stage
 
-	std::array<VkDescriptorSetLayoutBinding, 2> bindings = { uboLayoutBinding, samplerLayoutBinding };
+	VkDescriptorSetLayoutBinding materialLayoutBinding = {};
+	materialLayoutBinding.binding = 2;
+	materialLayoutBinding.descriptorCount = 1;
+	materialLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER; // The table can hold any number of materials
+	materialLayoutBinding.pImmutableSamplers = nullptr;
+	materialLayoutBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::array<VkDescriptorSetLayoutBinding, 3> bindings = { uboLayoutBinding, samplerLayoutBinding, materialLayoutBinding };
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
@@ -1896,7 +2328,16 @@ void RenderCode::createDescriptorSetLayout()
 
 void RenderCode::createUniformBuffer()
 {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject); // The buffer size would be the size of the struct
+	const ScopedTraceZone traceZone("createUniformBuffer", "vulkan");
+
+	/*Every frame in flight has a slice, so the next frame is written while the GPU reads the previous ones. Descriptors may only point at aligned offsets*/
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+	const VkDeviceSize alignment = (std::max)(properties.limits.minUniformBufferOffsetAlignment, VkDeviceSize(1));
+	uniformSliceSize = (sizeof(UniformBufferObject) + alignment - 1) / alignment * alignment;
+
+	VkDeviceSize bufferSize = uniformSliceSize * MAX_FRAMES_IN_FLIGHT;
 
 	createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uniformBuffer, uniformBufferMemory);
 }
@@ -1928,33 +2369,42 @@ void RenderCode::updateUniformBuffer()
 																													// The third vector defines our "up" direction
 
 	/*Projection matrix*/
-	ubo.proj = glm::perspective(glm::radians(45.0f), swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 1000.0f); // Look with a 45-degree field of view., the aspect ratio is the width / height, the near plane is at 0.1f ( should never be 0.0 or less), and far plane is 10.0f
+	const float fieldOfView = glm::radians(45.0f);
+
+	ubo.proj = glm::perspective(fieldOfView, swapChainExtent.width / (float)swapChainExtent.height, 0.1f, 1000.0f); // Look with a 45-degree field of view., the aspect ratio is the width / height, the near plane is at 0.1f ( should never be 0.0 or less), and far plane is 10.0f
 
 	/*For the aspect ratio, we should use the swap chain extent, which would record new widths and heights upon resizing events from the application have been recognized*/
 
 	ubo.proj[1][1] *= -1; // Because the Y coordinate of the clip coordinates is flipped? So we flip the scaling factor for the Y axis 
 
-	/*Copy the data in the uniform buffer object*/
+	/*The detail level depends on how far the camera is from the mesh*/
+	selectLod(fieldOfView);
+
+	/*Only the chunks of that level which can be seen are drawn*/
+	cullInvisibleChunks();
 
-	void* data;
-	vkMapMemory(device, uniformBufferMemory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(device, uniformBufferMemory);
+	/*Copy the data in the uniform buffer object, into the slice of the frame being recorded*/
+
+	memcpy(static_cast<char*>(uniformBufferMemory.mapped) + uniformSliceSize * currentFrame, &ubo, sizeof(ubo));
 }
 
 void RenderCode::createDescriptorPool()
 {
-	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
+	const ScopedTraceZone traceZone("createDescriptorPool", "vulkan");
+
+	std::array<VkDescriptorPoolSize, 3> poolSizes = {};
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = 1;
+	poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = 1;
+	poolSizes[1].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+	poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[2].descriptorCount = MAX_FRAMES_IN_FLIGHT;
 
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = 1;
+	poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT; // One set per frame in flight
 
 	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create descriptor pool!");
@@ -1962,51 +2412,101 @@ void RenderCode::createDescriptorPool()
 
 }
 
-void RenderCode::createDescriptorSet()
+void RenderCode::createDescriptorSets()
 {
-	/*Creates a descriptor set of the combined uniform buffer and texture sampler*/
-	VkDescriptorSetLayout layouts[] = { descriptorSetLayout };
+	const ScopedTraceZone traceZone("createDescriptorSets", "vulkan");
+
+	/*Creates a descriptor set of the combined uniform buffer and texture sampler for every frame in flight*/
+	std::array<VkDescriptorSetLayout, MAX_FRAMES_IN_FLIGHT> layouts;
+	layouts.fill(descriptorSetLayout);
+
+	std::array<VkDescriptorSet, MAX_FRAMES_IN_FLIGHT> descriptorSets;
+
 	VkDescriptorSetAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = descriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = layouts;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
 
-	if (vkAllocateDescriptorSets(device, &allocInfo, &descriptorSet) != VK_SUCCESS) {
+	if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate descriptor set!");
 	}
 
-	VkDescriptorBufferInfo bufferInfo = {};
-	bufferInfo.buffer = uniformBuffer;
-	bufferInfo.offset = 0;
-	bufferInfo.range = sizeof(UniformBufferObject);
+	for (size_t frame = 0; frame < frames.size(); frame++)
+	{
+		frames[frame].descriptorSet = descriptorSets[frame];
+
+		/*The sets only differ in the slice of the uniform buffer*/
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = uniformBuffer;
+		bufferInfo.offset = uniformSliceSize * frame;
+		bufferInfo.range = sizeof(UniformBufferObject);
+
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = textureImageView;
+		imageInfo.sampler = textureSampler;
+
+		VkDescriptorBufferInfo materialBufferInfo = {};
+		materialBufferInfo.buffer = materialBuffer;
+		materialBufferInfo.offset = 0;
+		materialBufferInfo.range = sizeof(Material) * materials.size();
+
+		std::array<VkWriteDescriptorSet, 3> descriptorWrites = {};
+
+		/*First descriptor set used for the unifor buffer*/
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = descriptorSets[frame];
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &bufferInfo;
+
+		/*The second descriptor set for the texture sampler*/
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = descriptorSets[frame];
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &imageInfo;
+
+		/*The third one for the material table*/
+		descriptorWrites[2].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[2].dstSet = descriptorSets[frame];
+		descriptorWrites[2].dstBinding = 2;
+		descriptorWrites[2].dstArrayElement = 0;
+		descriptorWrites[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		descriptorWrites[2].descriptorCount = 1;
+		descriptorWrites[2].pBufferInfo = &materialBufferInfo;
+
+		vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
+}
+
+/*Reads and decodes a texture file, runs on a background thread while Vulkan is being initialized*/
+static DecodedTexture decodeTexture(const std::string& path)
+{
+	const ScopedTraceZone traceZone("Decode " + path, "assets");
+	const auto startTime = std::chrono::high_resolution_clock::now();
 
-	VkDescriptorImageInfo imageInfo = {};
-	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = textureImageView;
-	imageInfo.sampler = textureSampler;
+	DecodedTexture texture;
+	int texChannels; // Channels
 
-	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+	/*Read the file and gain details about the texture*/
+	stbi_uc* pixels = stbi_load(path.c_str(), &texture.width, &texture.height, &texChannels, STBI_rgb_alpha); // STBI_rgb_alpha forces the texture to be loaded with an alpha channel, for consistency in futre
 
-	/*First descriptor set used for the unifor buffer*/
-	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[0].dstSet = descriptorSet;
-	descriptorWrites[0].dstBinding = 0;
-	descriptorWrites[0].dstArrayElement = 0;
-	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorWrites[0].descriptorCount = 1;
-	descriptorWrites[0].pBufferInfo = &bufferInfo;
+	if (pixels)
+	{
+		texture.pixels.assign(pixels, pixels + static_cast<size_t>(texture.width) * texture.height * 4);
+		stbi_image_free(pixels);// Cleanup the data we used
+	}
 
-	/*The second descriptor set for the texture sampler*/
-	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[1].dstSet = descriptorSet;
-	descriptorWrites[1].dstBinding = 1;
-	descriptorWrites[1].dstArrayElement = 0;
-	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrites[1].descriptorCount = 1;
-	descriptorWrites[1].pImageInfo = &imageInfo;
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	texture.decodeSeconds = std::chrono::duration<double, std::chrono::seconds::period>(endTime - startTime).count();
 
-	vkUpdateDescriptorSets(device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	return texture;
 }
 
 /*
@@ -2014,47 +2514,33 @@ void RenderCode::createDescriptorSet()
 */
 void RenderCode::createTextureImage()
 {
-	int texWidth; // Width in pixels
-	int texHeight; // height in pixels
-	int texChannels; // Channels
+	const ScopedTraceZone traceZone("createTextureImage", "vulkan");
 
-	/*Read the file and gain details about the texture*/
-	stbi_uc* pixels = stbi_load("Textures/viking_room.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha); // STBI_rgb_alpha forces the texture to be loaded with an alpha channel, for consistency in futre
-	stbi_set_flip_vertically_on_load(true);
+	const auto waitStartTime = std::chrono::high_resolution_clock::now();
+
+	/*The decoding started with the renderer, by now it is usually done*/
+	const DecodedTexture texture = textureLoad.get();
+
+	const auto waitEndTime = std::chrono::high_resolution_clock::now();
+	textureWaitSeconds = std::chrono::duration<double, std::chrono::seconds::period>(waitEndTime - waitStartTime).count();
+	addTraceZone("Wait for the texture", "assets", waitStartTime, waitEndTime);
+	textureDecodeSeconds = texture.decodeSeconds;
 
-	VkDeviceSize imageSize = texWidth * texHeight * 4; // columns * rows * 4 Bytes
+	const int texWidth = texture.width; // Width in pixels
+	const int texHeight = texture.height; // height in pixels
 
-	if (!pixels)
+	if (texture.pixels.empty())
 	{
 		throw std::runtime_error("Failed to load texture image!");
 	}
 
-	/*Temporary variables for the staging buffer*/
-	VkBuffer stagingBuffer;
-	VkDeviceMemory stagingBufferMemory;
-
-	/*Buffer should be visible in host memory and we should */
-	createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingBufferMemory);
-
-	void* data;
-	/*Crfeate a staging buyffer and get the data*/
-	vkMapMemory(device, stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
-	vkUnmapMemory(device, stagingBufferMemory);
-
-	stbi_image_free(pixels);// Cleanup the data we used
-
 	createImage(texWidth, texHeight, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
 
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyBufferToImage(stagingBuffer, textureImage, static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight));
-	transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-	vkDestroyBuffer(device, stagingBuffer, nullptr);
-	vkFreeMemory(device, stagingBufferMemory, nullptr);
+	/*The pixels are streamed through the staging ring in bands of rows. The copies and both layout transitions are recorded with the other startup uploads*/
+	stagingRing.uploadImage(texture.pixels.data(), static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 4, textureImage);
 }
 
-void RenderCode::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory)
+void RenderCode::createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, DeviceAllocation& imageMemory)
 {
 	/*The paramaters for a given image are set up here*/
 	VkImageCreateInfo imageInfo = {};
@@ -2080,133 +2566,16 @@ void RenderCode::createImage(uint32_t width, uint32_t height, VkFormat format, V
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(device, image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
+	/*Linear images follow the same granularity rules as buffers, only optimal ones have to be kept apart from them*/
+	imageMemory = memoryAllocator.allocate(memRequirements, properties, (tiling == VK_IMAGE_TILING_OPTIMAL) ? DeviceResourceKind::Image : DeviceResourceKind::Buffer);
 
-	vkBindImageMemory(device, image, imageMemory, 0);
-}
-
-VkCommandBuffer RenderCode::beginSingleTimeCommands()
-{
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO; // Creates and sets up the command buffer
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = commandPool; // Tells to which command pool the buffer belongs to
-	allocInfo.commandBufferCount = 1; 
-
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer);
-
-	VkCommandBufferBeginInfo beginInfo = {};
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO; // Weqather commands will be associated with graphics commands etc
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
-
-	return commandBuffer;
-}
-
-void RenderCode::endSingleTimeCommands(VkCommandBuffer commandBuffer)
-{
-	vkEndCommandBuffer(commandBuffer);
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
-
-	vkQueueSubmit(graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(graphicsQueue);
-
-	vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
-}
-
-/*Use an image layout barrier to transition images*/
-void RenderCode::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-	VkImageMemoryBarrier barrier = {};
-	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER; // Specifies the layout transition
-	barrier.oldLayout = oldLayout; // We care about the old image contents, so we don't specify it as undefined, although it is possible
-	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED; // Set to ignore as we are not transfering queue ownerships, be careful as their default values are not "ingore"
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.image = image; // The image we are affecting
-
-	/*Subresources specify which parts of the image are affected*/
-	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	barrier.subresourceRange.baseMipLevel = 0;
-	barrier.subresourceRange.levelCount = 1;
-	barrier.subresourceRange.baseArrayLayer = 0;
-	barrier.subresourceRange.layerCount = 1;
-
-	VkPipelineStageFlags sourceStage;
-	VkPipelineStageFlags destinationStage;
-
-	/*I don't quite get what's happenign here...*/
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else {
-		throw std::invalid_argument("unsupported layout transition!");
-	}
-
-	/*Submit the pipeline barriers*/
-	vkCmdPipelineBarrier(
-		commandBuffer,
-		sourceStage, destinationStage,
-		0,
-		0, nullptr,
-		0, nullptr,
-		1, &barrier
-	);
-
-	endSingleTimeCommands(commandBuffer);
-}
-
-/*Copies the buffer to the image. In particular it is a helper function which defines which parts of the buffer get copied to which parts of the iamge*/
-void RenderCode::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0; // Byte offset in the values of the pixels
-	region.bufferRowLength = 0; // Bufferrows and bufferheight is the way pixels are laid out in memory
-	region.bufferImageHeight = 0;
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = {
-		width,
-		height,
-		1
-	}; // Specifies to which parts of the image we want to render to
-
-	vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	endSingleTimeCommands(commandBuffer);
+	vkBindImageMemory(device, image, imageMemory.memory, imageMemory.offset);
 }
 
 void RenderCode::createTextureImageView()
 {
+	const ScopedTraceZone traceZone("createTextureImageView", "vulkan");
+
 	textureImageView = createImageView(textureImage, VK_FORMAT_R8G8B8A8_UNORM); // Simplified via the helper function
 }
 
@@ -2234,6 +2603,7 @@ VkImageView RenderCode::createImageView(VkImage image, VkFormat format)
 
 void RenderCode::createTextureSampler()
 {
+	const ScopedTraceZone traceZone("createTextureSampler", "vulkan");
 
 	VkSamplerCreateInfo samplerInfo = {};
 	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -2295,6 +2665,7 @@ This function runs our entire application.
 void RenderCode::run()
 {
 	initWindow(); // Initializes Window api
+	finishStartupStage("Window");
 	initVulkan(); // Initializes Vulkan isntances
 	mainLoop(); // Runs the main render loop
 	cleanup(); // Frees resource that were allocated
@@ -2303,14 +2674,152 @@ void RenderCode::run()
 /*The constructor and destructor do nothing*/
 RenderCode::RenderCode() : physicalDevice(VK_NULL_HANDLE) // Initally no device is bound to our application
 {
+	lods.resize(1); // An empty full mesh
+	materials.resize(1);
+	lodFrameStatistics.resize(1);
+	vertexDecode = makeVertexDecode(vertices, vertexFormat);
+
+	startAssetLoads();
+}
+
+RenderCode::RenderCode(MeshData&& mesh, VertexFormat format) : vertexFormat(format)
+{
+	startAssetLoads();
+	acceptMesh(std::move(mesh));
+
+	/*World view position is essentially our camera position in world space*/
+	ubo.worldViewPosition = glm::vec3(2.0f, 15.0f, 6.0f);
 }
 
-RenderCode::RenderCode(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) : vertices(vertices), indices(indices)
+RenderCode::RenderCode(std::future<MeshData>&& pendingMesh, VertexFormat format) : vertexFormat(format), meshLoad(std::move(pendingMesh))
 {
+	startAssetLoads();
+
 	/*World view position is essentially our camera position in world space*/
 	ubo.worldViewPosition = glm::vec3(2.0f, 15.0f, 6.0f);
 }
 
+void RenderCode::startAssetLoads()
+{
+	startupTime = std::chrono::high_resolution_clock::now();
+	stageEndTime = startupTime;
+
+	/*The decoder only needs the file, so it can run from the start while the device is being created*/
+	textureLoad = std::async(std::launch::async, decodeTexture, std::string("Textures/viking_room.png"));
+}
+
+void RenderCode::acceptMesh(MeshData&& mesh)
+{
+	vertices = std::move(mesh.vertices);
+	indices = std::move(mesh.indices);
+	lods = std::move(mesh.lods);
+	submeshes = std::move(mesh.submeshes);
+	materials = std::move(mesh.materials);
+	chunks = std::move(mesh.chunks);
+
+	/*Without detail levels the whole index buffer is the only level, made up of all submeshes*/
+	if (lods.empty())
+	{
+		MeshLod fullMesh;
+		fullMesh.indexCount = static_cast<uint32_t>(indices.size());
+		fullMesh.submeshCount = static_cast<uint32_t>(submeshes.size());
+		lods.push_back(fullMesh);
+	}
+
+	/*Draws without a material of their own use the default one*/
+	if (materials.empty())
+	{
+		materials.resize(1);
+	}
+
+	appendSubmeshChunks(submeshes, submeshChunks);
+
+	lodFrameStatistics.resize(lods.size());
+
+	/*A sphere around the center of the bounds, which contains every vertex*/
+	if (!vertices.empty())
+	{
+		glm::vec3 minimum = vertices[0].pos;
+		glm::vec3 maximum = vertices[0].pos;
+
+		for (const Vertex& vertex : vertices)
+		{
+			minimum = glm::min(minimum, vertex.pos);
+			maximum = glm::max(maximum, vertex.pos);
+		}
+
+		meshCenter = 0.5f * (minimum + maximum);
+
+		for (const Vertex& vertex : vertices)
+		{
+			meshRadius = (std::max)(meshRadius, glm::length(vertex.pos - meshCenter));
+		}
+	}
+
+	/*The bounds have to be known before the command buffers are recorded, the vertices are encoded when the vertex buffer is created*/
+	vertexDecode = makeVertexDecode(vertices, vertexFormat);
+}
+
+void RenderCode::waitForMesh()
+{
+	if (!meshLoad.valid())
+	{
+		return;
+	}
+
+	const auto waitStartTime = std::chrono::high_resolution_clock::now();
+
+	/*get() rethrows an exception of the loading thread here, inside run()*/
+	MeshData mesh = meshLoad.get();
+
+	const auto waitEndTime = std::chrono::high_resolution_clock::now();
+	meshWaitSeconds = std::chrono::duration<double, std::chrono::seconds::period>(waitEndTime - waitStartTime).count();
+	addTraceZone("Wait for the mesh", "assets", waitStartTime, waitEndTime);
+
+	acceptMesh(std::move(mesh));
+}
+
+void RenderCode::finishStartupStage(const char* name)
+{
+	const auto now = std::chrono::high_resolution_clock::now();
+
+	startupStages.push_back({ name, std::chrono::duration<double, std::chrono::seconds::period>(now - stageEndTime).count() });
+	addTraceZone(name, "stage", stageEndTime, now);
+	stageEndTime = now;
+}
+
+void RenderCode::reportStartupStages() const
+{
+	const double firstFrameSeconds = std::chrono::duration<double, std::chrono::seconds::period>(stageEndTime - startupTime).count();
+
+	std::cout << "Time to first frame: " << 1000.0 * firstFrameSeconds << " ms" << std::endl;
+
+	for (const StartupStage& stage : startupStages)
+	{
+		std::cout << "  " << stage.name << ": " << 1000.0 * stage.seconds << " ms" << std::endl;
+	}
+
+	/*A wait of 0 means the background load was done before it was needed, and cost the startup nothing*/
+	std::cout << "  Waited " << 1000.0 * meshWaitSeconds << " ms for the mesh and " << 1000.0 * textureWaitSeconds << " ms for the texture, which took "
+		<< 1000.0 * textureDecodeSeconds << " ms to decode" << std::endl;
+
+	/*Every buffer and image of the startup went through the allocator, so this is what sub-allocation saved*/
+	const DeviceMemoryStatistics memoryStatistics = memoryAllocator.getStatistics();
+
+	std::cout << "  Device memory: " << memoryStatistics.totalAllocations << " allocations from " << memoryStatistics.totalAllocateCalls << " vkAllocateMemory calls, "
+		<< (memoryStatistics.usedBytes >> 10) << " of " << (memoryStatistics.reservedBytes >> 10) << " KiB used in " << memoryStatistics.blockCount
+		<< " memory objects, fragmentation " << memoryStatistics.fragmentation() << std::endl;
+
+	/*Each upload used to create, map and destroy a staging buffer of its own*/
+	const StagingStatistics& stagingStatistics = stagingRing.getStatistics();
+
+	std::cout << "  Staging: " << (stagingStatistics.bytes >> 10) << " KiB in " << stagingStatistics.uploadCount << " uploads (" << stagingStatistics.uploadCount
+		<< " staging buffers avoided), " << stagingStatistics.chunkCount << " chunks, " << stagingStatistics.submitCount << " submissions, "
+		<< stagingStatistics.stallCount << " stalls, " << stagingStatistics.gigabytesPerSecond() << " GB/s, " << stagingStatistics.transitionCount
+		<< " layout transitions in " << stagingStatistics.barrierCount << " barriers, "
+		<< (stagingStatistics.dedicatedTransferQueue ? "dedicated transfer queue with " : "graphics queue with ") << stagingStatistics.ownershipTransferCount << " ownership transfers" << std::endl;
+}
+
 
 RenderCode::~RenderCode()
 {
@@ -12,16 +12,68 @@
 #include <algorithm> // min, max
 #include <fstream> // std::ifstream, is_open, tellg, seekg, read, close
 #include<array> // array
+#include <chrono> // high_resolution_clock
+#include <future> // future, async
 
 /*GLM*/
 #include<glm.hpp>
 
 #include "Vertex.h"
+#include "CompactVertex.h"
+#include "MeshData.h"
+#include "SpatialChunks.h"
+#include "Submeshes.h"
+#include "DeviceMemoryAllocator.h"
+#include "StagingRing.h"
 
 /*Constants are usually good to be initialized as such, instead of hard-coded values, as we may reuse them in later stages*/
 const int WIDTH = 800;
 const int HEIGHT = 600;
 
+/*Frames the CPU may record while the GPU still renders the earlier ones. With 1 every frame waits for the previous one to finish*/
+const int MAX_FRAMES_IN_FLIGHT = 2;
+
+/*How many pixels a detail level may be off on screen before a finer one is drawn*/
+const float LOD_PIXEL_ERROR = 1.0f;
+
+/*Frames drawn with one detail level or culling setting, for comparing their cost*/
+struct FrameStatistics
+{
+	size_t frameCount = 0;
+	double seconds = 0.0; // Total time of those frames, from the start of one iteration of the main loop to the next
+	double gpuSeconds = 0.0; // Time between the timestamps around the render pass, 0 if the queue has no timestamps
+	double waitSeconds = 0.0; // CPU time blocked on the fence of an earlier frame, the rest of the frame overlapped with the GPU
+	double cullSeconds = 0.0; // CPU time spent testing the chunks against the view
+	size_t triangleCount = 0; // Triangles submitted in those frames
+};
+
+/*Everything a frame uses while the GPU renders it, so the next frames can be recorded meanwhile*/
+struct FrameResources
+{
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE; // Recorded again each time the frame is drawn
+	VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE; // Signalled once the swap chain image can be rendered to
+	VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE; // Signalled once the image can be presented
+	VkFence inFlightFence = VK_NULL_HANDLE; // Signalled once the GPU is done with the frame. Created signalled, as no frame is in flight at first
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE; // Points at the frame's slice of the uniform buffer
+	bool timestampsWritten = false; // Whether the frame's queries hold the times of its last submission
+};
+
+/*Pixels of a texture decoded on a background thread, uploaded once the device exists*/
+struct DecodedTexture
+{
+	std::vector<unsigned char> pixels; // RGBA, empty if the file could not be decoded
+	int width = 0;
+	int height = 0;
+	double decodeSeconds = 0.0; // Time the decoding thread spent on the file
+};
+
+/*One step of the startup, from the construction of the renderer to the first frame on screen*/
+struct StartupStage
+{
+	const char* name;
+	double seconds; // Time since the previous stage finished
+};
+
 /*Uniform Buffer OBject*/
 struct UniformBufferObject
 {
@@ -50,6 +102,7 @@ struct QueueFamilyIndices
 	/*Initial value of -1 represents "Not found" or "Not available"*/
 	int graphicsFamily = -1;
 	int presentFamily = -1;
+	int transferFamily = -1; // A family for transfers alone if there is one, else the graphics family. Not required
 
 	/*
 	Once the neccessary queries to the device have been processed,
@@ -99,6 +152,44 @@ private: // Private data, the authro most likely intended to keep rendering sepa
 	std::vector<Vertex> vertices;
 	std::vector<uint32_t> indices;
 
+	VertexFormat vertexFormat = VertexFormat::Full; // Layout of the vertices in the vertex buffer
+	VertexDecode vertexDecode; // Pushed to the vertex shader to decode compact vertices
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32; // 16-bit if every index fits, set when the index buffer is created
+
+	std::vector<MeshLod> lods; // Detail levels inside indices, from the finest to the coarsest. Always holds at least the full mesh
+	std::vector<Submesh> submeshes; // Ranges of every level which share a material, a level without any is drawn with the default material
+	std::vector<Material> materials; // Uploaded once to the material buffer, always holds at least the default material
+	size_t currentLod = 0; // Level picked for the current camera position
+	std::vector<FrameStatistics> lodFrameStatistics; // One entry per level
+	glm::vec3 meshCenter = glm::vec3(0.0f); // Bounding sphere of the mesh in object space, for the screen space error
+	float meshRadius = 0.0f;
+
+	SpatialChunks chunks; // Bounds of the parts of every detail level, empty if the levels were not split
+	SpatialChunks submeshChunks; // The submeshes as chunks, culled instead for levels which were not split
+	std::vector<DrawRange> visibleRanges; // Parts of the current level inside the view, recorded into the next frame
+	size_t visibleTriangleCount = 0;
+	bool frustumCulling = true; // Switched with the C key
+	bool cullingKeyDown = false; // The key state of the last frame, so holding it only switches once
+	FrameStatistics cullingFrameStatistics[2]; // Frames drawn without and with frustum culling
+
+	VkQueryPool timestampQueryPool = VK_NULL_HANDLE; // Two timestamps around the render pass, null if the graphics queue cannot write them
+	float timestampPeriod = 1.0f; // Nanoseconds per timestamp tick
+	uint64_t timestampMask = 0; // The bits of a timestamp which are valid
+	double gpuFrameSeconds = 0.0; // GPU time of the frame which last used the current frame's resources
+	double frameWaitSeconds = 0.0; // Time the current frame blocked on its fence
+
+	/*The assets are read on background threads while the window and the Vulkan objects are created, and only joined where they are needed*/
+	std::future<MeshData> meshLoad; // Invalid once the mesh was taken over, or if it was passed in already loaded
+	std::future<DecodedTexture> textureLoad;
+	double meshWaitSeconds = 0.0; // Time the startup spent blocked on the background loads
+	double textureWaitSeconds = 0.0;
+	double textureDecodeSeconds = 0.0;
+
+	std::chrono::high_resolution_clock::time_point startupTime; // When the renderer was constructed
+	std::chrono::high_resolution_clock::time_point stageEndTime; // When the last startup stage finished
+	std::vector<StartupStage> startupStages; // Filled until the first frame is on screen
+	bool firstFrameDrawn = false;
+
 	/*********************************************DATA*********************************/
 
 	GLFWwindow* window; // The GLFW window object, which encapsulates two things: Both the window, and an OpenGL context ( By default)
@@ -126,8 +217,13 @@ private: // Private data, the authro most likely intended to keep rendering sepa
 	VkPhysicalDevice physicalDevice; // This is a physical hardware device, capable of supporting and running Vulkan.
 	VkDevice device; // This is an interface between our Vulkan Application and the physical device. 
 
+	DeviceMemoryAllocator memoryAllocator; // Places every buffer and image in a few large memory blocks instead of one allocation each
+
+	StagingRing stagingRing; // Every upload to device local memory is staged here
+
 	VkQueue graphicsQueue; // A set of commands that exectute draw calls
 	VkQueue presentQueue; // A set of commands that execture presentation commands
+	VkQueue transferQueue; // Runs the uploads, the same queue as the graphics queue unless the device has a family for transfers alone
 
 	VkSwapchainKHR swapChain; // Represents, in a sense, an image looping mechanism. A description of a loop of how the different images produced will be output on the screen.
 
@@ -150,27 +246,27 @@ private: // Private data, the authro most likely intended to keep rendering sepa
 
 	VkCommandPool commandPool; // A simple object whose purpose is to allocate CommandBuffers. It is associated with a Queue Family. I.e. all command buffers submited would be of the same type.
 
-	std::vector<VkCommandBuffer> commandBuffers; // A series of commands, that are of the same type, and are to be sent to a Queue. 
-
 	 /*Semaphores are used to synchronize the application on a global level as it otherwise does not exist by default to ensure maximum performance. (Explained better in the cpp file)*/
-	VkSemaphore imageAvailableSemaphore;
-	VkSemaphore renderFinishedSemaphore;
+	std::array<FrameResources, MAX_FRAMES_IN_FLIGHT> frames; // Command buffers, semaphores, fences and descriptor sets of each frame in flight
+	size_t currentFrame = 0; // The frame recorded next, cycles through frames
 
 	VkBuffer vertexBuffer; // A handle referencing a vertex buffer;
-	VkDeviceMemory vertexBufferMemory; // A handle to the vertexBuffer memory on the GPU
+	DeviceAllocation vertexBufferMemory; // A handle to the vertexBuffer memory on the GPU
 
 	VkBuffer indexBuffer; // Handle for the index buffer
-	VkDeviceMemory indexBufferMemory; // a handle to the index buffer memory on the gpu
+	DeviceAllocation indexBufferMemory; // a handle to the index buffer memory on the gpu
 
 	VkBuffer uniformBuffer; // Also a handle, for the unform buffer. So are all handles just references?
-	VkDeviceMemory uniformBufferMemory;  // Will need to allocated requested amounts of memory for its purpose.
+	DeviceAllocation uniformBufferMemory;  // Will need to allocated requested amounts of memory for its purpose.
+	VkDeviceSize uniformSliceSize = 0; // Each frame in flight writes its own slice of the buffer, sizeof(UniformBufferObject) rounded up to the offset alignment
 
-	VkDescriptorPool descriptorPool; // The descriptor pool which contains the descriptor sets
+	VkBuffer materialBuffer; // The material table, read by the fragment shader with the index pushed for each draw
+	DeviceAllocation materialBufferMemory;
 
-	VkDescriptorSet descriptorSet; //The descriptor set that will contain all ... ubos? ResourceS? Something?! 
+	VkDescriptorPool descriptorPool; // The descriptor pool which contains the descriptor sets
 
 	VkImage textureImage; // // Image object as they make it faster to retrieve a value from a 2d Texture
-	VkDeviceMemory textureImageMemory;
+	DeviceAllocation textureImageMemory;
 
 	VkImageView textureImageView;
 	VkSampler textureSampler;
@@ -260,17 +356,38 @@ private: // Private data, the authro most likely intended to keep rendering sepa
 	/*A set of valid framebuffers that can be used as render targets*/
 	void createFramebuffers();
 
-	/*Generates/provides a sequence of instructions to be executed.*/
+	/*Generates/provides a sequence of instructions to be executed. One per frame in flight*/
 	void createCommandBuffers();
 
+	/*Records the draws of the visible ranges into the command buffer of a frame, rendering to one swap chain image*/
+	void recordCommandBuffer(size_t frame, uint32_t imageIndex);
+
+	/*Picks the coarsest detail level whose error stays below LOD_PIXEL_ERROR pixels on screen*/
+	void selectLod(float fieldOfView);
+
+	/*Fills visibleRanges with the chunks of the current detail level inside the view frustum, or its submeshes if the level was not split, or the whole level if culling is off*/
+	void cullInvisibleChunks();
+
+	/*Creates the query pool for measuring the GPU time of a frame, if the graphics queue supports timestamps*/
+	void createTimestampQueries();
+
+	/*Prints the triangles, error and average frame times of every detail level that was drawn, and the same with and without frustum culling*/
+	void reportFrameStatistics() const;
+
 	/*Creats a larger set of command buffers, each of the same type, which have their own instructions.*/
 	void createCommandPool();
 
+	/*Sets up the staging ring on the transfer queue, handing the uploads over to the graphics queue*/
+	void createStagingRing();
+
+	/*Waits until the GPU is done with the resources of the current frame, and reads its timestamps*/
+	void waitForFrameInFlight();
+
 	/*Ouputs a triangle to the screen, by aquiring the next image from the swap chain*/
 	void drawFrame();
 
-	/*Creates synchronization mechanisms for signaling different conditions for the image*/
-	void createSemaphores();
+	/*Creates the semaphores and fences of every frame in flight*/
+	void createSyncObjects();
 
 	/*Recreates a swap chain whenever the system detects a resize event. Techincally recreates all the required stuff like framebuffers, image views etc. that depend on the swap chain*/
 	void recreateSwapChain();
@@ -284,18 +401,15 @@ private: // Private data, the authro most likely intended to keep rendering sepa
 	/*Creates a vertex buffer and sets up the data, allocates memory etc.*/
 	void createVertexBuffer();
 
-	/*Finds the correct GPU memory type to use, based on information passed from our application and buffer requirements that got computed during creation*/
-	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
-
 	/*To create multiple buffers, as we`ll need a staging buffer and an actual buffer for the vertex buffer*/
-	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-
-	/*Will be used to copy over data from the host-side staging buffer into the vertex buffer which is using device memory*/
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, DeviceAllocation& bufferMemory);
 
 	/*Creates the index buffer, this is almost identical as the vertex buffer creation*/
 	void createIndexBuffer();
 
+	/*Uploads the material table into a device local storage buffer, it never changes afterwards*/
+	void createMaterialBuffer();
+
 	/*Describes the way the data is layed out in the unform buffer*/
 	void createDescriptorSetLayout();
 
@@ -308,20 +422,28 @@ private: // Private data, the authro most likely intended to keep rendering sepa
 	/*Similarly to command buffers, we cannot access them directly, so descriptor sets are allocated from a pool*/
 	void createDescriptorPool();
 
-	void createDescriptorSet();
+	/*One descriptor set per frame in flight, differing only in the slice of the uniform buffer*/
+	void createDescriptorSets();
 
 	void createTextureImage(); // creates a usable texture for vulkan
 
-	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
-	
-	VkCommandBuffer beginSingleTimeCommands();
+	/*Starts the timing of the startup and the decoding of the texture, which the constructors share*/
+	void startAssetLoads();
 
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	/*Takes over the arrays of a loaded mesh, and fills in what the renderer derives from it*/
+	void acceptMesh(MeshData&& mesh);
 
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+	/*Blocks until the background load of the mesh is done, if it is still pending*/
+	void waitForMesh();
 
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height); // Copies a region of the buffer to the actual image
+	/*Adds the time since the previous stage as a stage of the startup*/
+	void finishStartupStage(const char* name);
 
+	/*Prints the time to the first frame, split into the startup stages*/
+	void reportStartupStages() const;
+
+	void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, DeviceAllocation& imageMemory);
+	
 	void createTextureImageView(); // Images are accessed via a image view, so we set up one to be able to acces it
 
 	VkImageView createImageView(VkImage image, VkFormat format);
@@ -349,7 +471,8 @@ public:
 	The constructor and destructor. They serve no purpose here, but I decicded to keep them either way.
 	*/
 	RenderCode();
-	RenderCode(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	RenderCode(MeshData&& mesh, VertexFormat format = VertexFormat::Full); // Takes over the arrays of the mesh without copying them, the format selects how the vertices are stored on the GPU
+	RenderCode(std::future<MeshData>&& pendingMesh, VertexFormat format = VertexFormat::Full); // The mesh is still being loaded, it is only waited for once the vertex buffer is created
 	~RenderCode();
 };
 
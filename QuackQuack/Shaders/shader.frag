@@ -19,6 +19,25 @@ layout(binding = 0) uniform UniformBufferObject
 
 layout(binding = 1) uniform sampler2D texSampler;
 
+/*The materials of the mesh, uploaded once. Matches the Material struct on the CPU*/
+struct Material
+{
+	vec4 ambient; // Ka in rgb
+	vec4 diffuse; // Kd in rgb, the dissolve d in a
+	vec4 specular; // Ks in rgb, the exponent Ns in w
+};
+
+layout(std430, binding = 2) readonly buffer MaterialBuffer
+{
+	Material materials[];
+};
+
+/*The material of the current draw, the vertex shader uses the push constants before it*/
+layout(push_constant) uniform MaterialConstants
+{
+	layout(offset = 32) uint materialIndex;
+};
+
 layout(location = 0) in vec3 worldVertexNormal;// The normal vector of the vertex, expressed in world coordinates
 layout(location = 1) in vec2 worldTextureCoordinate;
 
@@ -36,10 +55,11 @@ void main()
 	vec3 worldLightSourceVector = vec3(10.0, 0.0, 0.0); // The position of our light source in world coordinates
 
 	/*Values from the mtl file for Ki*/
-	vec3 Ka = vec3(1.0, 1.0, 1.0);
-	vec3 Kd = vec3(1.0, 1.0, 1.0);
-	vec3 Ks = vec3(0.2880, 0.2880, 0.2880);
-	float lightSpecularExponent = 28.0;
+	Material material = materials[materialIndex];
+	vec3 Ka = material.ambient.rgb;
+	vec3 Kd = material.diffuse.rgb;
+	vec3 Ks = material.specular.rgb;
+	float lightSpecularExponent = material.specular.w;
 
 	/*The colour of the material*/
 	vec3 objectColour = vec3(1.0, 1.0, 1.0);
@@ -82,5 +102,5 @@ void main()
 
 	vec4 textureProperties = texture(texSampler, worldTextureCoordinate); // Samples the correct texture coordinate form the image
 
-	outColour = textureProperties * vec4(finalLightingColour, 1.0); // The final colour depends on both the lighting and texture
+	outColour = textureProperties * vec4(finalLightingColour, material.diffuse.a); // The final colour depends on both the lighting and texture
 }
\ No newline at end of file
@@ -18,6 +18,16 @@ layout(binding = 0) uniform UniformBufferObject
 	bool toggleTextures;
 } ubo;
 
+/*Set when the pipeline is created, true if the vertex buffer holds compact vertices which have to be decoded*/
+layout(constant_id = 0) const bool compactVertices = false;
+
+/*The bounds the compact positions are stored relative to, the offset is 0 and the scale 1 for full vertices*/
+layout(push_constant) uniform VertexDecode
+{
+	vec4 positionOffset;
+	vec4 positionScale;
+} decode;
+
 /*This is vertex attributes*/
 /*They are properties specified in the vertex buffer, per vertex*/
 layout(location = 0) in vec3 inPosition;
@@ -32,6 +42,19 @@ out gl_PerVertex
 	vec4 gl_Position;
 };
 
+/*Turns a normal folded onto an octahedron back into a unit vector*/
+vec3 decodeOctahedralNormal(vec2 octahedral)
+{
+	vec3 normal = vec3(octahedral, 1.0 - abs(octahedral.x) - abs(octahedral.y));
+
+	/*Unfold the lower half, which was mirrored over the diagonals*/
+	float fold = max(-normal.z, 0.0);
+	normal.x += (normal.x >= 0.0) ? -fold : fold;
+	normal.y += (normal.y >= 0.0) ? -fold : fold;
+
+	return normalize(normal);
+}
+
 void main() // A main function which is invoked for every vertex on
 {
 	
@@ -39,10 +62,14 @@ void main() // A main function which is invoked for every vertex on
 	mat3 modelMatrix3x3 = mat3(ubo.model);
 	
 	/*The normal in world space for the fragment*/
-	worldVertexNormal = modelMatrix3x3 *  inNormal;
+	vec3 normal = compactVertices ? decodeOctahedralNormal(inNormal.xy) : inNormal;
+	worldVertexNormal = modelMatrix3x3 *  normal;
+
+	/*Compact positions are normalized to the mesh bounds*/
+	vec3 position = decode.positionOffset.xyz + inPosition * decode.positionScale.xyz;
 
 	/*The vertex position*/
-	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(inPosition, 1.0);
+	gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
 
 	/*The texture coordinates*/
 	worldTextureCoordinate = inTexCoord;
@@ -0,0 +1,340 @@
+#include "SpatialChunks.h"
+
+#include <algorithm>
+#include <cassert>
+
+#include "MeshOptimization.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define SPATIAL_CHUNKS_SSE2
+#include <emmintrin.h>
+#endif
+
+/*Spreads the lowest 10 bits of value so two zero bits follow each one*/
+static uint32_t spreadBits(uint32_t value)
+{
+	value &= 0x3FF;
+	value = (value | (value << 16)) & 0x030000FF;
+	value = (value | (value << 8)) & 0x0300F00F;
+	value = (value | (value << 4)) & 0x030C30C3;
+	value = (value | (value << 2)) & 0x09249249;
+
+	return value;
+}
+
+/*Position along a Morton curve with 1024 steps per axis, for a point inside the given bounds*/
+static uint32_t mortonCode(const glm::vec3& point, const glm::vec3& minimum, const glm::vec3& scale)
+{
+	const glm::vec3 cell = glm::clamp((point - minimum) * scale, glm::vec3(0.0f), glm::vec3(1023.0f));
+
+	return spreadBits(static_cast<uint32_t>(cell.x)) | (spreadBits(static_cast<uint32_t>(cell.y)) << 1) | (spreadBits(static_cast<uint32_t>(cell.z)) << 2);
+}
+
+/*
+	Runs the vertex cache optimization over one chunk. The vertices are renumbered first, as the
+	optimization keeps arrays as large as the vertex count it is given
+*/
+static void optimizeChunk(uint32_t* chunkIndices, size_t indexCount, std::vector<uint32_t>& localIndices, std::vector<uint32_t>& globalIndices)
+{
+	std::vector<uint32_t> local(indexCount);
+	globalIndices.clear();
+
+	for (size_t index = 0; index < indexCount; index++)
+	{
+		uint32_t& localIndex = localIndices[chunkIndices[index]];
+
+		if (localIndex == UINT32_MAX)
+		{
+			localIndex = static_cast<uint32_t>(globalIndices.size());
+			globalIndices.push_back(chunkIndices[index]);
+		}
+
+		local[index] = localIndex;
+	}
+
+	optimizeVertexCache(local, globalIndices.size());
+
+	for (size_t index = 0; index < indexCount; index++)
+	{
+		chunkIndices[index] = globalIndices[local[index]];
+	}
+
+	/*Leave the lookup cleared for the next chunk*/
+	for (uint32_t vertex : globalIndices)
+	{
+		localIndices[vertex] = UINT32_MAX;
+	}
+}
+
+/*
+	Sorts the triangles of one submesh by the Morton code of their centres and cuts them into chunks,
+	returns how many chunks were added
+*/
+static uint32_t chunkSubmesh(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, const Submesh& submesh, const glm::vec3& minimum, const glm::vec3& scale,
+	unsigned int trianglesPerChunk, std::vector<uint32_t>& localIndices, std::vector<uint32_t>& globalIndices, SpatialChunks& chunks)
+{
+	const size_t triangleCount = submesh.indexCount / 3;
+	uint32_t* submeshIndices = indices.data() + submesh.indexOffset;
+
+	/*The code in the upper half and the triangle in the lower half keeps the sort stable*/
+	std::vector<uint64_t> keys(triangleCount);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const glm::vec3 centre = (vertices[submeshIndices[triangle * 3 + 0]].pos + vertices[submeshIndices[triangle * 3 + 1]].pos +
+			vertices[submeshIndices[triangle * 3 + 2]].pos) * (1.0f / 3.0f);
+
+		keys[triangle] = (static_cast<uint64_t>(mortonCode(centre, minimum, scale)) << 32) | triangle;
+	}
+
+	std::sort(keys.begin(), keys.end());
+
+	const std::vector<uint32_t> unsorted(submeshIndices, submeshIndices + triangleCount * 3);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const uint32_t source = static_cast<uint32_t>(keys[triangle]);
+
+		submeshIndices[triangle * 3 + 0] = unsorted[source * 3 + 0];
+		submeshIndices[triangle * 3 + 1] = unsorted[source * 3 + 1];
+		submeshIndices[triangle * 3 + 2] = unsorted[source * 3 + 2];
+	}
+
+	uint32_t chunkCount = 0;
+
+	for (size_t firstTriangle = 0; firstTriangle < triangleCount; firstTriangle += trianglesPerChunk)
+	{
+		const size_t chunkTriangles = (std::min)(static_cast<size_t>(trianglesPerChunk), triangleCount - firstTriangle);
+		uint32_t* chunkIndices = submeshIndices + firstTriangle * 3;
+
+		optimizeChunk(chunkIndices, chunkTriangles * 3, localIndices, globalIndices);
+
+		glm::vec3 chunkMinimum = vertices[chunkIndices[0]].pos;
+		glm::vec3 chunkMaximum = chunkMinimum;
+
+		for (size_t index = 1; index < chunkTriangles * 3; index++)
+		{
+			chunkMinimum = glm::min(chunkMinimum, vertices[chunkIndices[index]].pos);
+			chunkMaximum = glm::max(chunkMaximum, vertices[chunkIndices[index]].pos);
+		}
+
+		chunks.indexOffsets.push_back(static_cast<uint32_t>(submesh.indexOffset + firstTriangle * 3));
+		chunks.indexCounts.push_back(static_cast<uint32_t>(chunkTriangles * 3));
+		chunks.materials.push_back(submesh.material);
+		chunks.minimumX.push_back(chunkMinimum.x);
+		chunks.minimumY.push_back(chunkMinimum.y);
+		chunks.minimumZ.push_back(chunkMinimum.z);
+		chunks.maximumX.push_back(chunkMaximum.x);
+		chunks.maximumY.push_back(chunkMaximum.y);
+		chunks.maximumZ.push_back(chunkMaximum.z);
+
+		chunkCount++;
+	}
+
+	return chunkCount;
+}
+
+void buildSpatialChunks(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, const std::vector<Submesh>& submeshes, unsigned int trianglesPerChunk, SpatialChunks& chunks)
+{
+	assert(trianglesPerChunk > 0 && (indices.size() % 3) == 0);
+
+	chunks = SpatialChunks();
+
+	if (lods.empty())
+	{
+		MeshLod fullMesh;
+		fullMesh.indexCount = static_cast<uint32_t>(indices.size());
+		fullMesh.submeshCount = static_cast<uint32_t>(submeshes.size());
+		lods.push_back(fullMesh);
+	}
+
+	if (vertices.empty())
+	{
+		return;
+	}
+
+	/*All levels use the same grid, so a chunk of a coarse level covers about the same space as the fine chunks it replaces*/
+	glm::vec3 minimum = vertices[0].pos;
+	glm::vec3 maximum = minimum;
+
+	for (const Vertex& vertex : vertices)
+	{
+		minimum = glm::min(minimum, vertex.pos);
+		maximum = glm::max(maximum, vertex.pos);
+	}
+
+	const glm::vec3 extent = glm::max(maximum - minimum, glm::vec3(1e-20f));
+	const glm::vec3 scale = 1024.0f / extent;
+
+	std::vector<uint32_t> localIndices(vertices.size(), UINT32_MAX);
+	std::vector<uint32_t> globalIndices;
+
+	for (MeshLod& lod : lods)
+	{
+		lod.firstChunk = static_cast<uint32_t>(chunks.size());
+		lod.chunkCount = 0;
+
+		/*A level without submeshes is chunked as a single one with the default material*/
+		if (lod.submeshCount == 0)
+		{
+			Submesh wholeLevel;
+			wholeLevel.indexOffset = lod.indexOffset;
+			wholeLevel.indexCount = lod.indexCount;
+
+			lod.chunkCount += chunkSubmesh(vertices, indices, wholeLevel, minimum, scale, trianglesPerChunk, localIndices, globalIndices, chunks);
+		}
+
+		for (uint32_t submesh = lod.firstSubmesh; submesh < lod.firstSubmesh + lod.submeshCount; submesh++)
+		{
+			lod.chunkCount += chunkSubmesh(vertices, indices, submeshes[submesh], minimum, scale, trianglesPerChunk, localIndices, globalIndices, chunks);
+		}
+	}
+}
+
+/*
+	The planes bounding the clip volume, moved into object space. A point is inside when the dot
+	product with every plane is at least zero, the planes do not need to be normalized for that
+*/
+static void extractFrustumPlanes(const glm::mat4& objectToClip, glm::vec4 planes[6])
+{
+	const glm::vec4 row0(objectToClip[0][0], objectToClip[1][0], objectToClip[2][0], objectToClip[3][0]);
+	const glm::vec4 row1(objectToClip[0][1], objectToClip[1][1], objectToClip[2][1], objectToClip[3][1]);
+	const glm::vec4 row2(objectToClip[0][2], objectToClip[1][2], objectToClip[2][2], objectToClip[3][2]);
+	const glm::vec4 row3(objectToClip[0][3], objectToClip[1][3], objectToClip[2][3], objectToClip[3][3]);
+
+	planes[0] = row3 + row0; // Left
+	planes[1] = row3 - row0; // Right
+	planes[2] = row3 + row1; // Top or bottom, depending on the sign of the projection
+	planes[3] = row3 - row1;
+	planes[4] = row2; // Near, z >= 0 in Vulkan
+	planes[5] = row3 - row2; // Far
+}
+
+/*Adds a visible chunk to the ranges, growing the last range if the chunk follows it directly with the same material*/
+static void appendChunk(const SpatialChunks& chunks, uint32_t chunk, std::vector<DrawRange>& ranges)
+{
+	const uint32_t indexOffset = chunks.indexOffsets[chunk];
+	const uint32_t indexCount = chunks.indexCounts[chunk];
+	const uint32_t material = chunks.materials[chunk];
+
+	if (!ranges.empty() && ranges.back().indexOffset + ranges.back().indexCount == indexOffset && ranges.back().material == material)
+	{
+		ranges.back().indexCount += indexCount;
+	}
+	else
+	{
+		ranges.push_back({ indexOffset, indexCount, material });
+	}
+}
+
+/*
+	A box is outside if its corner furthest along the normal of a plane is behind that plane.
+	This keeps some boxes near the corners of the frustum which lie outside, which only costs a draw.
+*/
+static bool chunkOutside(const SpatialChunks& chunks, uint32_t chunk, const glm::vec4 planes[6])
+{
+	for (unsigned int plane = 0; plane < 6; plane++)
+	{
+		const glm::vec4& p = planes[plane];
+
+		const float x = (p.x >= 0.0f) ? chunks.maximumX[chunk] : chunks.minimumX[chunk];
+		const float y = (p.y >= 0.0f) ? chunks.maximumY[chunk] : chunks.minimumY[chunk];
+		const float z = (p.z >= 0.0f) ? chunks.maximumZ[chunk] : chunks.minimumZ[chunk];
+
+		/*Summed in the same order as the SSE2 path, so both agree on boxes touching a plane*/
+		if (((p.x * x + p.w) + p.y * y) + p.z * z < 0.0f)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void cullChunksScalar(const SpatialChunks& chunks, uint32_t firstChunk, uint32_t chunkCount, const glm::mat4& objectToClip, std::vector<DrawRange>& ranges)
+{
+	glm::vec4 planes[6];
+	extractFrustumPlanes(objectToClip, planes);
+
+	for (uint32_t chunk = firstChunk; chunk < firstChunk + chunkCount; chunk++)
+	{
+		if (!chunkOutside(chunks, chunk, planes))
+		{
+			appendChunk(chunks, chunk, ranges);
+		}
+	}
+}
+
+void cullChunks(const SpatialChunks& chunks, uint32_t firstChunk, uint32_t chunkCount, const glm::mat4& objectToClip, std::vector<DrawRange>& ranges)
+{
+#ifdef SPATIAL_CHUNKS_SSE2
+	glm::vec4 planes[6];
+	extractFrustumPlanes(objectToClip, planes);
+
+	/*
+		Each plane is the same for all four boxes, so the corner furthest along it uses the same
+		bound arrays in every lane and is picked once per plane instead of with per lane selects
+	*/
+	const float* cornerX[6];
+	const float* cornerY[6];
+	const float* cornerZ[6];
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+
+	for (unsigned int plane = 0; plane < 6; plane++)
+	{
+		cornerX[plane] = (planes[plane].x >= 0.0f) ? chunks.maximumX.data() : chunks.minimumX.data();
+		cornerY[plane] = (planes[plane].y >= 0.0f) ? chunks.maximumY.data() : chunks.minimumY.data();
+		cornerZ[plane] = (planes[plane].z >= 0.0f) ? chunks.maximumZ.data() : chunks.minimumZ.data();
+
+		planeX[plane] = _mm_set1_ps(planes[plane].x);
+		planeY[plane] = _mm_set1_ps(planes[plane].y);
+		planeZ[plane] = _mm_set1_ps(planes[plane].z);
+		planeW[plane] = _mm_set1_ps(planes[plane].w);
+	}
+
+	const __m128 zero = _mm_setzero_ps();
+	const uint32_t endChunk = firstChunk + chunkCount;
+	uint32_t chunk = firstChunk;
+
+	for (; chunk + 4 <= endChunk; chunk += 4)
+	{
+		__m128 outside = zero;
+
+		for (unsigned int plane = 0; plane < 6; plane++)
+		{
+			__m128 distance = _mm_add_ps(_mm_mul_ps(planeX[plane], _mm_loadu_ps(cornerX[plane] + chunk)), planeW[plane]);
+			distance = _mm_add_ps(distance, _mm_mul_ps(planeY[plane], _mm_loadu_ps(cornerY[plane] + chunk)));
+			distance = _mm_add_ps(distance, _mm_mul_ps(planeZ[plane], _mm_loadu_ps(cornerZ[plane] + chunk)));
+
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, zero));
+		}
+
+		const int outsideMask = _mm_movemask_ps(outside);
+
+		/*Most groups are either completely visible or completely culled*/
+		if (outsideMask == 0xF)
+		{
+			continue;
+		}
+
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			if ((outsideMask & (1 << lane)) == 0)
+			{
+				appendChunk(chunks, chunk + lane, ranges);
+			}
+		}
+	}
+
+	/*The last chunks which do not fill a register*/
+	for (; chunk < endChunk; chunk++)
+	{
+		if (!chunkOutside(chunks, chunk, planes))
+		{
+			appendChunk(chunks, chunk, ranges);
+		}
+	}
+#else
+	cullChunksScalar(chunks, firstChunk, chunkCount, objectToClip, ranges);
+#endif
+}
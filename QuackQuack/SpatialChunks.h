@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+#include <glm.hpp>
+
+#include "Vertex.h"
+#include "MeshData.h"
+
+/*A range of the index buffer to draw with one material*/
+struct DrawRange
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	uint32_t material;
+};
+
+/*
+	Splits every detail level into chunks of trianglesPerChunk triangles which lie close together.
+
+	The triangles of each submesh of a level are sorted along a Morton curve through the bounds of the mesh
+	and cut into equal runs, so no chunk mixes materials. Each run is optimized for the vertex cache again,
+	as the sort loses the order the earlier passes created. If lods is empty the whole index buffer is added
+	to it as the only level, made up of all submeshes. Levels without submeshes use the default material.
+*/
+void buildSpatialChunks(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<MeshLod>& lods, const std::vector<Submesh>& submeshes, unsigned int trianglesPerChunk, SpatialChunks& chunks);
+
+/*
+	Appends the chunks firstChunk to firstChunk + chunkCount - 1 which intersect the view frustum to ranges,
+	merging chunks which follow each other in the index buffer and share their material into one range.
+	objectToClip is the full projection * view * model matrix, for Vulkan clip space with z between 0 and w.
+
+	Tests four chunks at a time with SSE where it is available.
+*/
+void cullChunks(const SpatialChunks& chunks, uint32_t firstChunk, uint32_t chunkCount, const glm::mat4& objectToClip, std::vector<DrawRange>& ranges);
+
+/*The same test one chunk at a time, as a reference for the SIMD version*/
+void cullChunksScalar(const SpatialChunks& chunks, uint32_t firstChunk, uint32_t chunkCount, const glm::mat4& objectToClip, std::vector<DrawRange>& ranges);
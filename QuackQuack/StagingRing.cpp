@@ -0,0 +1,602 @@
+#include "StagingRing.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+/*Chunks start at a multiple of this, which covers the texel size of every format an upload uses*/
+static const VkDeviceSize chunkAlignment = 16;
+
+static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+/*Stages which read the uploads on the graphics queue*/
+static const VkPipelineStageFlags readStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+static const VkAccessFlags bufferReadAccess = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+static VkCommandPool createCommandPool(VkDevice device, uint32_t queueFamily)
+{
+	VkCommandPoolCreateInfo poolInfo = {};
+	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolInfo.queueFamilyIndex = queueFamily;
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // Every command buffer is recorded again when it is reused
+
+	VkCommandPool pool;
+
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create a staging command pool!");
+	}
+
+	return pool;
+}
+
+static double secondsSince(std::chrono::high_resolution_clock::time_point startTime)
+{
+	return std::chrono::duration<double, std::chrono::seconds::period>(std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+StagingRing::StagingRing()
+{
+}
+
+void StagingRing::initialize(VkDevice logicalDevice, DeviceMemoryAllocator& allocator, const UploadQueues& uploadQueues, VkDeviceSize ringSize)
+{
+	device = logicalDevice;
+	queues = uploadQueues;
+	statistics.dedicatedTransferQueue = transfersOwnership();
+
+	commandPool = createCommandPool(device, queues.transferFamily);
+
+	if (transfersOwnership())
+	{
+		acquireCommandPool = createCommandPool(device, queues.graphicsFamily);
+	}
+
+	capacity = alignUp(ringSize, chunkAlignment);
+
+	/*Four chunks fit in the ring, so the host can write one while the GPU copies the others*/
+	chunkSize = (std::max)(capacity / 4, chunkAlignment);
+
+	VkBufferCreateInfo bufferInfo = {};
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = capacity;
+	bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+	{
+		throw std::runtime_error("Failed to create the staging ring!");
+	}
+
+	VkMemoryRequirements memRequirements;
+	vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+	/*Host visible blocks stay mapped, so the ring is written without ever mapping it*/
+	allocation = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, DeviceResourceKind::Buffer);
+
+	vkBindBufferMemory(device, buffer, allocation.memory, allocation.offset);
+}
+
+void StagingRing::destroy(DeviceMemoryAllocator& allocator)
+{
+	finish();
+
+	for (VkFence fence : unusedFences)
+	{
+		vkDestroyFence(device, fence, nullptr);
+	}
+
+	for (VkSemaphore semaphore : unusedSemaphores)
+	{
+		vkDestroySemaphore(device, semaphore, nullptr);
+	}
+
+	/*Destroying the pools frees their command buffers*/
+	vkDestroyCommandPool(device, commandPool, nullptr);
+
+	if (acquireCommandPool != VK_NULL_HANDLE)
+	{
+		vkDestroyCommandPool(device, acquireCommandPool, nullptr);
+	}
+
+	unusedFences.clear();
+	unusedSemaphores.clear();
+	unusedCommandBuffers.clear();
+	unusedAcquireCommandBuffers.clear();
+
+	vkDestroyBuffer(device, buffer, nullptr);
+	allocator.free(allocation);
+}
+
+void StagingRing::reclaim(bool wait)
+{
+	if (wait && !submissions.empty())
+	{
+		vkWaitForFences(device, 1, &submissions.front().fence, VK_TRUE, UINT64_MAX);
+	}
+
+	/*Submissions finish in the order they were made, so the first one still running ends the search*/
+	while (!submissions.empty() && (vkGetFenceStatus(device, submissions.front().fence) == VK_SUCCESS))
+	{
+		const Submission& submission = submissions.front();
+
+		vkResetFences(device, 1, &submission.fence);
+		unusedFences.push_back(submission.fence);
+		unusedCommandBuffers.push_back(submission.commandBuffer);
+
+		if (submission.acquireCommandBuffer != VK_NULL_HANDLE)
+		{
+			unusedAcquireCommandBuffers.push_back(submission.acquireCommandBuffer);
+			unusedSemaphores.push_back(submission.semaphore);
+		}
+
+		tail = submission.end;
+		submissions.pop_front();
+	}
+}
+
+void* StagingRing::reserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset)
+{
+	for (;;)
+	{
+		/*An idle ring starts over at the front, which keeps chunks from wrapping needlessly*/
+		if (!inUse())
+		{
+			head = 0;
+			tail = 0;
+		}
+
+		const VkDeviceSize start = alignUp(head, alignment);
+		bool found = false;
+
+		if (!inUse() || (head > tail))
+		{
+			/*The free part runs from the head to the end and wraps around to the tail*/
+			if (start + size <= capacity)
+			{
+				offset = start;
+				found = true;
+			}
+			else if (size <= tail)
+			{
+				offset = 0;
+				found = true;
+			}
+		}
+		else if (head < tail)
+		{
+			if (start + size <= tail)
+			{
+				offset = start;
+				found = true;
+			}
+		}
+
+		if (found)
+		{
+			head = offset + size;
+			return static_cast<char*>(allocation.mapped) + offset;
+		}
+
+		/*The ring is full, the pending copies have to run before their part can be reused*/
+		flush();
+		reclaim(true);
+		statistics.stallCount++;
+	}
+}
+
+VkCommandBuffer StagingRing::beginCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& unused)
+{
+	VkCommandBuffer commandBuffer;
+
+	if (!unused.empty())
+	{
+		commandBuffer = unused.back();
+		unused.pop_back();
+	}
+	else
+	{
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = pool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(device, &allocInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to allocate a staging command buffer!");
+		}
+	}
+
+	/*Beginning a command buffer of a pool created with the reset flag resets it as well*/
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	return commandBuffer;
+}
+
+VkFence StagingRing::acquireFence()
+{
+	VkFence fence;
+
+	if (!unusedFences.empty())
+	{
+		fence = unusedFences.back();
+		unusedFences.pop_back();
+	}
+	else
+	{
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a staging fence!");
+		}
+	}
+
+	return fence;
+}
+
+VkSemaphore StagingRing::acquireSemaphore()
+{
+	VkSemaphore semaphore;
+
+	if (!unusedSemaphores.empty())
+	{
+		semaphore = unusedSemaphores.back();
+		unusedSemaphores.pop_back();
+	}
+	else
+	{
+		VkSemaphoreCreateInfo semaphoreInfo = {};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+		if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &semaphore) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to create a staging semaphore!");
+		}
+	}
+
+	return semaphore;
+}
+
+VkImageMemoryBarrier StagingRing::imageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask)
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = srcAccessMask;
+	barrier.dstAccessMask = dstAccessMask;
+
+	return barrier;
+}
+
+void StagingRing::flush()
+{
+	if (pendingBufferCopies.empty() && pendingImageCopies.empty())
+	{
+		return;
+	}
+
+	const VkCommandBuffer commandBuffer = beginCommandBuffer(commandPool, unusedCommandBuffers);
+
+	/*Every image which gets its first copy in this batch enters the transfer layout in one barrier*/
+	if (!pendingTransferBarriers.empty())
+	{
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(pendingTransferBarriers.size()), pendingTransferBarriers.data());
+
+		statistics.barrierCount++;
+	}
+
+	/*Chunks of one upload follow each other, so a run with the same destination becomes one copy command*/
+	std::vector<VkBufferCopy> bufferRegions;
+
+	for (size_t copy = 0; copy < pendingBufferCopies.size(); copy++)
+	{
+		bufferRegions.push_back(pendingBufferCopies[copy].region);
+
+		if ((copy + 1 == pendingBufferCopies.size()) || (pendingBufferCopies[copy + 1].destination != pendingBufferCopies[copy].destination))
+		{
+			vkCmdCopyBuffer(commandBuffer, buffer, pendingBufferCopies[copy].destination, static_cast<uint32_t>(bufferRegions.size()), bufferRegions.data());
+			bufferRegions.clear();
+		}
+	}
+
+	std::vector<VkBufferImageCopy> imageRegions;
+
+	for (size_t copy = 0; copy < pendingImageCopies.size(); copy++)
+	{
+		imageRegions.push_back(pendingImageCopies[copy].region);
+
+		if ((copy + 1 == pendingImageCopies.size()) || (pendingImageCopies[copy + 1].destination != pendingImageCopies[copy].destination))
+		{
+			vkCmdCopyBufferToImage(commandBuffer, buffer, pendingImageCopies[copy].destination, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+			imageRegions.clear();
+		}
+	}
+
+	Submission submission = {};
+	submission.commandBuffer = commandBuffer;
+	submission.fence = acquireFence();
+	submission.end = head;
+
+	if (!transfersOwnership())
+	{
+		/*One barrier makes the buffers visible to the vertex input and the shaders, and moves every finished image to the shader read layout*/
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = bufferReadAccess;
+
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0,
+			1, &barrier, 0, nullptr, static_cast<uint32_t>(pendingReadBarriers.size()), pendingReadBarriers.data());
+
+		statistics.barrierCount++;
+
+		vkEndCommandBuffer(commandBuffer);
+
+		VkSubmitInfo submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &commandBuffer;
+
+		if (vkQueueSubmit(queues.transferQueue, 1, &submitInfo, submission.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit the staging copies!");
+		}
+	}
+	else
+	{
+		/*
+		Every finished destination is released by the transfer family after the copies and acquired by the graphics
+		family with an identical barrier. The release makes the writes available, the acquire makes them visible,
+		and the layout transition of an image happens once between the two
+		*/
+		std::vector<VkBufferMemoryBarrier> releaseBufferBarriers;
+		std::vector<VkBufferMemoryBarrier> acquireBufferBarriers;
+
+		for (VkBuffer destination : pendingReleasedBuffers)
+		{
+			VkBufferMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = queues.transferFamily;
+			barrier.dstQueueFamilyIndex = queues.graphicsFamily;
+			barrier.buffer = destination;
+			barrier.offset = 0;
+			barrier.size = VK_WHOLE_SIZE;
+
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = 0; // Ignored on the releasing queue
+			releaseBufferBarriers.push_back(barrier);
+
+			barrier.srcAccessMask = 0; // Ignored on the acquiring queue
+			barrier.dstAccessMask = bufferReadAccess;
+			acquireBufferBarriers.push_back(barrier);
+		}
+
+		std::vector<VkImageMemoryBarrier> releaseImageBarriers;
+		std::vector<VkImageMemoryBarrier> acquireImageBarriers;
+
+		for (VkImageMemoryBarrier barrier : pendingReadBarriers)
+		{
+			barrier.srcQueueFamilyIndex = queues.transferFamily;
+			barrier.dstQueueFamilyIndex = queues.graphicsFamily;
+
+			const VkAccessFlags dstAccessMask = barrier.dstAccessMask;
+			barrier.dstAccessMask = 0;
+			releaseImageBarriers.push_back(barrier);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = dstAccessMask;
+			acquireImageBarriers.push_back(barrier);
+		}
+
+		/*Chunks of destinations which are not finished yet stay with the transfer family, the ring only has to wait for the copies*/
+		if (!releaseBufferBarriers.empty() || !releaseImageBarriers.empty())
+		{
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+				static_cast<uint32_t>(releaseBufferBarriers.size()), releaseBufferBarriers.data(),
+				static_cast<uint32_t>(releaseImageBarriers.size()), releaseImageBarriers.data());
+
+			statistics.barrierCount++;
+		}
+
+		vkEndCommandBuffer(commandBuffer);
+
+		submission.semaphore = acquireSemaphore();
+
+		VkSubmitInfo transferSubmitInfo = {};
+		transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		transferSubmitInfo.commandBufferCount = 1;
+		transferSubmitInfo.pCommandBuffers = &commandBuffer;
+		transferSubmitInfo.signalSemaphoreCount = 1;
+		transferSubmitInfo.pSignalSemaphores = &submission.semaphore;
+
+		if (vkQueueSubmit(queues.transferQueue, 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit the staging copies!");
+		}
+
+		/*The acquire waits for the copies only where the graphics queue reads the uploads, so work already submitted there keeps running*/
+		submission.acquireCommandBuffer = beginCommandBuffer(acquireCommandPool, unusedAcquireCommandBuffers);
+
+		if (!acquireBufferBarriers.empty() || !acquireImageBarriers.empty())
+		{
+			vkCmdPipelineBarrier(submission.acquireCommandBuffer, readStages, readStages, 0, 0, nullptr,
+				static_cast<uint32_t>(acquireBufferBarriers.size()), acquireBufferBarriers.data(),
+				static_cast<uint32_t>(acquireImageBarriers.size()), acquireImageBarriers.data());
+
+			statistics.barrierCount++;
+		}
+
+		vkEndCommandBuffer(submission.acquireCommandBuffer);
+
+		const VkPipelineStageFlags waitStage = readStages;
+
+		VkSubmitInfo acquireSubmitInfo = {};
+		acquireSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		acquireSubmitInfo.waitSemaphoreCount = 1;
+		acquireSubmitInfo.pWaitSemaphores = &submission.semaphore;
+		acquireSubmitInfo.pWaitDstStageMask = &waitStage;
+		acquireSubmitInfo.commandBufferCount = 1;
+		acquireSubmitInfo.pCommandBuffers = &submission.acquireCommandBuffer;
+
+		/*The fence signals after the acquire, which itself waited for the copies, so it covers both submissions*/
+		if (vkQueueSubmit(queues.graphicsQueue, 1, &acquireSubmitInfo, submission.fence) != VK_SUCCESS)
+		{
+			throw std::runtime_error("Failed to submit the staging ownership transfer!");
+		}
+
+		statistics.ownershipTransferCount += releaseBufferBarriers.size() + releaseImageBarriers.size();
+		statistics.submitCount++;
+	}
+
+	submissions.push_back(submission);
+
+	statistics.transitionCount += pendingTransferBarriers.size() + pendingReadBarriers.size();
+	statistics.submitCount++;
+
+	pendingBufferCopies.clear();
+	pendingImageCopies.clear();
+	pendingTransferBarriers.clear();
+	pendingReadBarriers.clear();
+	pendingReleasedBuffers.clear();
+}
+
+void StagingRing::finish()
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	flush();
+
+	while (!submissions.empty())
+	{
+		reclaim(true);
+	}
+
+	statistics.seconds += secondsSince(startTime);
+}
+
+void StagingRing::uploadBuffer(const void* data, VkDeviceSize size, VkBuffer destination, VkDeviceSize destinationOffset)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const char* bytes = static_cast<const char*>(data);
+
+	for (VkDeviceSize copied = 0; copied < size; )
+	{
+		const VkDeviceSize copySize = (std::min)(size - copied, chunkSize);
+
+		VkDeviceSize offset;
+		void* chunk = reserve(copySize, chunkAlignment, offset);
+		memcpy(chunk, bytes + copied, static_cast<size_t>(copySize));
+
+		PendingBufferCopy copy;
+		copy.destination = destination;
+		copy.region.srcOffset = offset;
+		copy.region.dstOffset = destinationOffset + copied;
+		copy.region.size = copySize;
+		pendingBufferCopies.push_back(copy);
+
+		copied += copySize;
+		statistics.chunkCount++;
+
+		/*Parts read by finished submissions are released on the way, so a long upload rarely has to wait for the whole ring*/
+		reclaim(false);
+	}
+
+	/*Only the last copy hands the buffer over, the chunks before it may have been submitted by an earlier flush*/
+	if (std::find(pendingReleasedBuffers.begin(), pendingReleasedBuffers.end(), destination) == pendingReleasedBuffers.end())
+	{
+		pendingReleasedBuffers.push_back(destination);
+	}
+
+	statistics.uploadCount++;
+	statistics.bytes += size;
+	statistics.seconds += secondsSince(startTime);
+}
+
+void StagingRing::uploadImage(const void* texels, uint32_t width, uint32_t height, uint32_t texelSize, VkImage image)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	const char* bytes = static_cast<const char*>(texels);
+	const VkDeviceSize rowSize = VkDeviceSize(width) * texelSize;
+
+	if (rowSize > capacity)
+	{
+		throw std::runtime_error("A row of the image does not fit in the staging ring!");
+	}
+
+	pendingTransferBarriers.push_back(imageBarrier(image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT));
+
+	/*Images are streamed in bands of whole rows, each band is one copy region*/
+	uint32_t bandRows = static_cast<uint32_t>((std::max)(chunkSize / rowSize, VkDeviceSize(1)));
+
+	/*A transfer queue may only copy blocks of its granularity, bands then start on a multiple of its height. Without one, the image has to be copied whole*/
+	const uint32_t granularity = queues.transferGranularity.height;
+
+	if (granularity == 0)
+	{
+		bandRows = height;
+	}
+	else
+	{
+		bandRows = (std::max)(bandRows - bandRows % granularity, granularity);
+	}
+
+	if (rowSize * (std::min)(bandRows, height) > capacity)
+	{
+		throw std::runtime_error("A band of the image does not fit in the staging ring!");
+	}
+
+	for (uint32_t row = 0; row < height; )
+	{
+		const uint32_t rowCount = (std::min)(bandRows, height - row);
+		const VkDeviceSize copySize = rowSize * rowCount;
+
+		VkDeviceSize offset;
+		void* chunk = reserve(copySize, chunkAlignment, offset);
+		memcpy(chunk, bytes + rowSize * row, static_cast<size_t>(copySize));
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0; // Rows are tightly packed
+		region.bufferImageHeight = 0;
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = 0;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+		region.imageOffset = { 0, static_cast<int32_t>(row), 0 };
+		region.imageExtent = { width, rowCount, 1 };
+
+		pendingImageCopies.push_back({ image, region });
+
+		row += rowCount;
+		statistics.chunkCount++;
+
+		reclaim(false);
+	}
+
+	/*A flush while the ring was full may have recorded the first bands already, the transition out of the transfer layout follows the last one*/
+	pendingReadBarriers.push_back(imageBarrier(image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT));
+
+	statistics.uploadCount++;
+	statistics.bytes += rowSize * height;
+	statistics.seconds += secondsSince(startTime);
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <glfw3.h>
+
+#include <vector>
+#include <deque>
+#include <chrono>
+
+#include "DeviceMemoryAllocator.h"
+
+/*
+	One persistently mapped staging buffer which every upload goes through.
+
+	Uploads are written at the head of the ring right away, but their copies and layout transitions are
+	only recorded when the batch is flushed. A flush records everything pending into one command buffer,
+	with a single barrier moving every new image to the transfer layout before the copies and a single
+	barrier making all of them readable after, and submits it with one fence. The part of the ring a
+	submission read is only reused once its fence has signalled. An upload larger than a chunk is streamed
+	in several chunks, buffers by bytes and images by bands of rows, so the ring never has to be as large as
+	the largest asset. Only when the ring fills up does a batch take more than one submission.
+
+	When the device has a queue family for transfers alone, the copies run on it and never wait behind the
+	frames on the graphics queue. The destinations are then owned by the transfer family while they are
+	written, and each one is released to the graphics family after its last copy and acquired by a short
+	command buffer on the graphics queue, which waits on a semaphore signalled by the copies. Without such
+	a family everything is recorded for the graphics queue as before.
+*/
+
+/*The queues the ring uploads with. Both may be the same queue*/
+struct UploadQueues
+{
+	VkQueue transferQueue = VK_NULL_HANDLE; // Runs the copies
+	uint32_t transferFamily = 0;
+	VkQueue graphicsQueue = VK_NULL_HANDLE; // Reads the uploaded resources
+	uint32_t graphicsFamily = 0;
+	VkExtent3D transferGranularity = { 1, 1, 1 }; // minImageTransferGranularity of the transfer family
+};
+
+/*What the uploads through the ring cost*/
+struct StagingStatistics
+{
+	size_t uploadCount = 0; // Uploads which went through the ring, each of them used to create a staging buffer of its own
+	size_t chunkCount = 0; // Copy regions recorded, one per chunk
+	size_t submitCount = 0;
+	size_t barrierCount = 0; // Pipeline barrier commands recorded, each covering any number of layout transitions
+	size_t transitionCount = 0; // Image layout transitions, which used to take a submission and a queue wait each
+	size_t stallCount = 0; // Times the ring was full and the host had to wait for a copy to finish
+	size_t ownershipTransferCount = 0; // Buffers and images handed from the transfer family to the graphics family
+	bool dedicatedTransferQueue = false; // Whether the copies ran on a queue of their own
+	VkDeviceSize bytes = 0;
+	double seconds = 0.0; // Host time spent uploading, including the waits for the copies to complete
+
+	double gigabytesPerSecond() const
+	{
+		return (seconds > 0.0) ? static_cast<double>(bytes) / seconds / 1e9 : 0.0;
+	}
+};
+
+class StagingRing
+{
+
+private:
+
+	/*Copies which were submitted, oldest first*/
+	struct Submission
+	{
+		VkFence fence; // Signalled by the last of the submissions below
+		VkCommandBuffer commandBuffer;
+		VkCommandBuffer acquireCommandBuffer; // Only with a dedicated transfer queue, as is the semaphore
+		VkSemaphore semaphore;
+		VkDeviceSize end; // The head of the ring after the last chunk the copies read
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	UploadQueues queues;
+	VkCommandPool commandPool = VK_NULL_HANDLE; // For the transfer family
+	VkCommandPool acquireCommandPool = VK_NULL_HANDLE; // For the graphics family, only with a dedicated transfer queue
+
+	VkBuffer buffer = VK_NULL_HANDLE;
+	DeviceAllocation allocation;
+	VkDeviceSize capacity = 0;
+	VkDeviceSize chunkSize = 0; // Largest part of an upload written at once
+
+	VkDeviceSize head = 0; // Where the next chunk is written
+	VkDeviceSize tail = 0; // Start of the oldest part still read by a copy
+
+	/*Copies written to the ring but not recorded yet*/
+	struct PendingBufferCopy
+	{
+		VkBuffer destination;
+		VkBufferCopy region;
+	};
+
+	struct PendingImageCopy
+	{
+		VkImage destination;
+		VkBufferImageCopy region;
+	};
+
+	std::vector<PendingBufferCopy> pendingBufferCopies;
+	std::vector<PendingImageCopy> pendingImageCopies;
+	std::vector<VkImageMemoryBarrier> pendingTransferBarriers; // Images entering the transfer layout before the copies of the next flush
+	std::vector<VkImageMemoryBarrier> pendingReadBarriers; // Images whose last copy is pending, leaving for the shader read layout after it
+	std::vector<VkBuffer> pendingReleasedBuffers; // Buffers whose last copy is pending, handed to the graphics family after it
+
+	std::deque<Submission> submissions;
+	std::vector<VkFence> unusedFences; // Fences and command buffers of finished submissions, reused by the next ones
+	std::vector<VkCommandBuffer> unusedCommandBuffers;
+	std::vector<VkCommandBuffer> unusedAcquireCommandBuffers;
+	std::vector<VkSemaphore> unusedSemaphores;
+
+	StagingStatistics statistics;
+
+	/*Whether any part of the ring is still waiting for a copy*/
+	bool inUse() const { return !submissions.empty() || !pendingBufferCopies.empty() || !pendingImageCopies.empty(); };
+
+	/*Finds room for size bytes at the head, waiting for the oldest copies while the ring is full. Returns where the chunk is to be written*/
+	void* reserve(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+
+	/*Whether the copies and the reads of the uploads happen on queues of different families*/
+	bool transfersOwnership() const { return queues.transferFamily != queues.graphicsFamily; };
+
+	/*A command buffer of a finished submission, or a new one allocated from the pool*/
+	VkCommandBuffer beginCommandBuffer(VkCommandPool pool, std::vector<VkCommandBuffer>& unused);
+
+	/*A fence or a semaphore of a finished submission, or a new one*/
+	VkFence acquireFence();
+	VkSemaphore acquireSemaphore();
+
+	/*A layout transition of the whole colour image*/
+	static VkImageMemoryBarrier imageBarrier(VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccessMask, VkAccessFlags dstAccessMask);
+
+	/*Releases the parts of the ring read by finished submissions. With wait set, blocks on the oldest one first*/
+	void reclaim(bool wait);
+
+	StagingRing(const StagingRing&) = delete;
+	StagingRing& operator = (const StagingRing&) = delete;
+
+public:
+
+	StagingRing();
+
+	/*Creates the ring and the command pools of both queue families*/
+	void initialize(VkDevice logicalDevice, DeviceMemoryAllocator& allocator, const UploadQueues& uploadQueues, VkDeviceSize ringSize = 8 * 1024 * 1024);
+
+	/*Waits for the copies in flight and releases the ring*/
+	void destroy(DeviceMemoryAllocator& allocator);
+
+	/*Copies size bytes of data to the buffer. With a dedicated transfer queue the buffer is given to the graphics family afterwards, so it must not have been used by the graphics queue before*/
+	void uploadBuffer(const void* data, VkDeviceSize size, VkBuffer destination, VkDeviceSize destinationOffset = 0);
+
+	/*Copies tightly packed texels to a new image, whose contents are undefined until then. It is left in the SHADER_READ_ONLY_OPTIMAL layout*/
+	void uploadImage(const void* texels, uint32_t width, uint32_t height, uint32_t texelSize, VkImage image);
+
+	/*Records the pending uploads into one command buffer and submits it. They are complete before anything submitted to the graphics queue afterwards reads the destinations*/
+	void flush();
+
+	/*Submits the pending uploads and waits on the fences until all of them are done*/
+	void finish();
+
+	const StagingStatistics& getStatistics() const { return statistics; };
+};
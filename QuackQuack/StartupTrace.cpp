@@ -0,0 +1,110 @@
+#include "StartupTrace.h"
+
+#include <vector>
+#include <mutex>
+#include <fstream>
+#include <stdint.h>
+
+#define NOMINMAX
+#include <windows.h>
+
+/*A finished zone, with its times relative to the start of the process*/
+struct TraceZone
+{
+	std::string name;
+	const char* category;
+	uint32_t threadId;
+	int64_t startMicroseconds;
+	int64_t durationMicroseconds;
+};
+
+/*The recorded zones of all threads*/
+static std::mutex traceMutex;
+static std::vector<TraceZone> traceZones;
+
+/*The origin of the timeline, as close to the start of the process as a static gets*/
+static const TraceTime traceOrigin = std::chrono::high_resolution_clock::now();
+
+static int64_t microsecondsSinceOrigin(TraceTime time)
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(time - traceOrigin).count();
+}
+
+/*Quotes a string for JSON, paths contain backslashes*/
+static std::string jsonString(const std::string& text)
+{
+	std::string quoted = "\"";
+
+	for (const char character : text)
+	{
+		if (character == '"' || character == '\\')
+		{
+			quoted += '\\';
+			quoted += character;
+		}
+		else if (static_cast<unsigned char>(character) < 0x20)
+		{
+			quoted += ' ';
+		}
+		else
+		{
+			quoted += character;
+		}
+	}
+
+	return quoted + "\"";
+}
+
+void addTraceZone(const std::string& name, const char* category, TraceTime start, TraceTime end)
+{
+	TraceZone zone;
+	zone.name = name;
+	zone.category = category;
+	zone.threadId = static_cast<uint32_t>(GetCurrentThreadId());
+	zone.startMicroseconds = microsecondsSinceOrigin(start);
+	zone.durationMicroseconds = microsecondsSinceOrigin(end) - zone.startMicroseconds;
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+	traceZones.push_back(std::move(zone));
+}
+
+bool writeChromeTrace(const std::string& path)
+{
+	std::ofstream file(path, std::ios::trunc);
+
+	if (!file.is_open())
+	{
+		OutputDebugString("Could not create the startup trace file!");
+		return false;
+	}
+
+	const uint32_t processId = static_cast<uint32_t>(GetCurrentProcessId());
+
+	std::lock_guard<std::mutex> lock(traceMutex);
+
+	/*Complete events (ph X) carry their duration, so every zone is a single entry*/
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+	for (size_t zone = 0; zone < traceZones.size(); zone++)
+	{
+		const TraceZone& traceZone = traceZones[zone];
+
+		file << (zone == 0 ? "\n" : ",\n")
+			<< "{\"name\":" << jsonString(traceZone.name) << ",\"cat\":" << jsonString(traceZone.category) << ",\"ph\":\"X\""
+			<< ",\"ts\":" << traceZone.startMicroseconds << ",\"dur\":" << traceZone.durationMicroseconds
+			<< ",\"pid\":" << processId << ",\"tid\":" << traceZone.threadId << "}";
+	}
+
+	file << "\n]}\n";
+
+	return file.good();
+}
+
+ScopedTraceZone::ScopedTraceZone(std::string zoneName, const char* zoneCategory) : name(std::move(zoneName)), category(zoneCategory), start(std::chrono::high_resolution_clock::now())
+{
+}
+
+ScopedTraceZone::~ScopedTraceZone()
+{
+	addTraceZone(name, category, start, std::chrono::high_resolution_clock::now());
+}
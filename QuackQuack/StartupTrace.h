@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <chrono>
+
+/*
+	A timeline of the startup, written as a Chrome trace which chrome://tracing and Perfetto can open.
+
+	Every zone is recorded with the thread it ran on, so the background loads show up next to the Vulkan
+	initialization they overlap with. Recording a zone takes a lock, so zones are meant for init stages
+	and asset loads, not for anything which runs every frame.
+*/
+
+typedef std::chrono::high_resolution_clock::time_point TraceTime;
+
+/*Adds a zone which ran on the calling thread from start to end*/
+void addTraceZone(const std::string& name, const char* category, TraceTime start, TraceTime end);
+
+/*Writes every zone recorded so far to a Chrome trace JSON file, returns false if the file cannot be written*/
+bool writeChromeTrace(const std::string& path);
+
+/*Records a zone from its construction to the end of its scope*/
+class ScopedTraceZone
+{
+
+private:
+
+	std::string name;
+	const char* category;
+	TraceTime start;
+
+	ScopedTraceZone(const ScopedTraceZone&) = delete;
+	ScopedTraceZone& operator = (const ScopedTraceZone&) = delete;
+
+public:
+
+	explicit ScopedTraceZone(std::string zoneName, const char* zoneCategory = "startup");
+	~ScopedTraceZone();
+};
@@ -0,0 +1,137 @@
+#include "Submeshes.h"
+
+#include <cassert>
+
+/*Stable counting sort of the triangles in order by the key of each triangle*/
+static void sortByKey(std::vector<uint32_t>& order, const std::vector<uint32_t>& keys, size_t keyCount)
+{
+	std::vector<uint32_t> keyStarts(keyCount + 1, 0);
+
+	for (const uint32_t key : keys)
+	{
+		assert(key < keyCount);
+		keyStarts[key + 1]++;
+	}
+
+	for (size_t key = 0; key < keyCount; key++)
+	{
+		keyStarts[key + 1] += keyStarts[key];
+	}
+
+	std::vector<uint32_t> sortedOrder(order.size());
+
+	for (const uint32_t triangle : order)
+	{
+		sortedOrder[keyStarts[keys[triangle]]++] = triangle;
+	}
+
+	order.swap(sortedOrder);
+}
+
+void groupTriangles(std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangleObjects, size_t objectCount,
+	const std::vector<uint32_t>& triangleMaterials, size_t materialCount, std::vector<Submesh>& submeshes)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	assert(triangleObjects.empty() || triangleObjects.size() == triangleCount);
+	assert(triangleMaterials.empty() || triangleMaterials.size() == triangleCount);
+
+	/*Most files have neither, their triangles are in order already*/
+	if (triangleObjects.empty() && triangleMaterials.empty())
+	{
+		Submesh wholeMesh;
+		wholeMesh.indexCount = static_cast<uint32_t>(indices.size());
+		submeshes.push_back(wholeMesh);
+		return;
+	}
+
+	/*Sorting by material first and then by object leaves the triangles ordered by both, as each sort is stable*/
+	std::vector<uint32_t> order(triangleCount);
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		order[triangle] = static_cast<uint32_t>(triangle);
+	}
+
+	if (!triangleMaterials.empty())
+	{
+		sortByKey(order, triangleMaterials, materialCount);
+	}
+
+	if (!triangleObjects.empty())
+	{
+		sortByKey(order, triangleObjects, objectCount);
+	}
+
+	std::vector<uint32_t> sortedIndices(indices.size());
+
+	for (size_t triangle = 0; triangle < triangleCount; triangle++)
+	{
+		const uint32_t source = order[triangle];
+		const uint32_t object = triangleObjects.empty() ? 0 : triangleObjects[source];
+		const uint32_t material = triangleMaterials.empty() ? 0 : triangleMaterials[source];
+
+		/*A new submesh starts wherever the pair changes*/
+		if (triangle == 0 || submeshes.back().object != object || submeshes.back().material != material)
+		{
+			Submesh submesh;
+			submesh.indexOffset = static_cast<uint32_t>(triangle * 3);
+			submesh.material = material;
+			submesh.object = object;
+			submeshes.push_back(submesh);
+		}
+
+		submeshes.back().indexCount += 3;
+
+		sortedIndices[triangle * 3 + 0] = indices[source * 3 + 0];
+		sortedIndices[triangle * 3 + 1] = indices[source * 3 + 1];
+		sortedIndices[triangle * 3 + 2] = indices[source * 3 + 2];
+	}
+
+	indices.swap(sortedIndices);
+}
+
+void computeSubmeshBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes, std::vector<MeshObject>& objects)
+{
+	/*Objects without a submesh keep empty bounds at the origin*/
+	std::vector<char> objectSeen(objects.size(), 0);
+
+	for (Submesh& submesh : submeshes)
+	{
+		if (submesh.indexCount == 0)
+		{
+			continue;
+		}
+
+		submesh.minimum = vertices[indices[submesh.indexOffset]].pos;
+		submesh.maximum = submesh.minimum;
+
+		for (uint32_t index = submesh.indexOffset + 1; index < submesh.indexOffset + submesh.indexCount; index++)
+		{
+			submesh.minimum = glm::min(submesh.minimum, vertices[indices[index]].pos);
+			submesh.maximum = glm::max(submesh.maximum, vertices[indices[index]].pos);
+		}
+
+		MeshObject& object = objects[submesh.object];
+
+		object.minimum = objectSeen[submesh.object] ? glm::min(object.minimum, submesh.minimum) : submesh.minimum;
+		object.maximum = objectSeen[submesh.object] ? glm::max(object.maximum, submesh.maximum) : submesh.maximum;
+		objectSeen[submesh.object] = 1;
+	}
+}
+
+void appendSubmeshChunks(const std::vector<Submesh>& submeshes, SpatialChunks& chunks)
+{
+	for (const Submesh& submesh : submeshes)
+	{
+		chunks.indexOffsets.push_back(submesh.indexOffset);
+		chunks.indexCounts.push_back(submesh.indexCount);
+		chunks.materials.push_back(submesh.material);
+		chunks.minimumX.push_back(submesh.minimum.x);
+		chunks.minimumY.push_back(submesh.minimum.y);
+		chunks.minimumZ.push_back(submesh.minimum.z);
+		chunks.maximumX.push_back(submesh.maximum.x);
+		chunks.maximumY.push_back(submesh.maximum.y);
+		chunks.maximumZ.push_back(submesh.maximum.z);
+	}
+}
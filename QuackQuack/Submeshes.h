@@ -0,0 +1,29 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "Vertex.h"
+#include "MeshData.h"
+
+/*
+	The submesh table, which splits the index buffer by the o and g records and the materials of the obj file.
+
+	Every object gets its own contiguous ranges, one for each material it uses, so an object can be culled
+	or drawn with a transform of its own while the whole mesh still shares one vertex and index buffer.
+*/
+
+/*
+	Sorts the triangles by object and then by material, keeping the file order of the triangles of every
+	pair, and appends one submesh for every pair which has triangles. triangleObjects and triangleMaterials
+	hold the object and the material of every triangle, below objectCount and materialCount. An empty list
+	puts every triangle in object or material 0.
+*/
+void groupTriangles(std::vector<uint32_t>& indices, const std::vector<uint32_t>& triangleObjects, size_t objectCount,
+	const std::vector<uint32_t>& triangleMaterials, size_t materialCount, std::vector<Submesh>& submeshes);
+
+/*Fills in the bounding box of every submesh, and of every object as the union of its submeshes*/
+void computeSubmeshBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes, std::vector<MeshObject>& objects);
+
+/*Appends one chunk for every submesh, in the same order, so detail levels which were not split can still be culled object by object*/
+void appendSubmeshChunks(const std::vector<Submesh>& submeshes, SpatialChunks& chunks);
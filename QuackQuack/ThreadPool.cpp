@@ -0,0 +1,63 @@
+#include "ThreadPool.h"
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock(queueMutex);
+
+			/*Sleep until there is either work to do or the pool is being destroyed*/
+			queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			/*Remaining tasks are still executed before the worker exits*/
+			if (stopping && tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+
+		task();
+	}
+}
+
+ThreadPool::ThreadPool(size_t threadCount) : stopping(false)
+{
+	if (threadCount == 0)
+	{
+		threadCount = std::thread::hardware_concurrency();
+	}
+
+	/*hardware_concurrency is allowed to return 0 when it cannot be determined*/
+	if (threadCount == 0)
+	{
+		threadCount = 1;
+	}
+
+	workers.reserve(threadCount);
+
+	for (size_t workerIndex = 0; workerIndex < threadCount; workerIndex++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(queueMutex);
+		stopping = true;
+	}
+
+	queueCondition.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <exception>
+
+/*
+	A fixed set of worker threads which execute submitted tasks in the order they were queued.
+
+	Tasks should not block on other tasks of the same pool, as every worker could end up
+	waiting and nothing would be left to run the work they are waiting for.
+*/
+class ThreadPool
+{
+
+private:
+
+	std::vector<std::thread> workers; // The threads executing the tasks
+	std::queue<std::function<void()>> tasks; // Tasks waiting for a free worker
+
+	std::mutex queueMutex; // Guards the task queue and the stopping flag
+	std::condition_variable queueCondition; // Wakes up workers when a task is queued or the pool is shutting down
+
+	bool stopping; // Set once the destructor has been called
+
+	/*The loop each worker runs until the pool is destroyed*/
+	void workerLoop();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator = (const ThreadPool&) = delete;
+
+public:
+
+	/*A thread count of 0 creates one worker per hardware thread*/
+	explicit ThreadPool(size_t threadCount = 0);
+
+	/*Queues a task and returns a future holding its result, or the exception it threw*/
+	template<typename Function>
+	auto submit(Function&& function) -> std::future<decltype(function())>
+	{
+		/*std::function has to be copyable, so the packaged task is shared instead of moved in*/
+		auto task = std::make_shared<std::packaged_task<decltype(function())()>>(std::forward<Function>(function));
+		std::future<decltype(function())> result = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			tasks.push([task]() { (*task)(); });
+		}
+
+		queueCondition.notify_one();
+
+		return result;
+	}
+
+	/*Runs function(index) for every index in [0, count) on the workers and waits for all of them to finish. Rethrows the first exception a task raised*/
+	template<typename Function>
+	void parallelFor(size_t count, const Function& function)
+	{
+		std::vector<std::future<void>> results;
+		results.reserve(count);
+
+		for (size_t index = 0; index < count; index++)
+		{
+			results.push_back(submit([&function, index]() { function(index); }));
+		}
+
+		/*The tasks refer to function, so every one of them has to finish before an exception may leave this scope*/
+		std::exception_ptr firstException;
+
+		for (std::future<void>& result : results)
+		{
+			try
+			{
+				result.get();
+			}
+			catch (...)
+			{
+				if (!firstException)
+				{
+					firstException = std::current_exception();
+				}
+			}
+		}
+
+		if (firstException)
+		{
+			std::rethrow_exception(firstException);
+		}
+	}
+
+	/*The amount of worker threads*/
+	size_t size() const { return workers.size(); };
+
+	~ThreadPool();
+};
@@ -1,5 +1,17 @@
 #include "Vertex.h"
 
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define VERTEX_HASH_SSE2
+#include <emmintrin.h>
+#endif
+
+/*The hash reads the three attributes as one block of eight floats*/
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex is expected to be eight tightly packed floats");
+
 Vertex::Vertex()
 {
 }
@@ -28,17 +40,17 @@ std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescription
 
 	atributeDescriptions[0].binding = 0;
 	atributeDescriptions[0].location = 0;
-	atributeDescriptions[0].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	atributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT; // Only as wide as the member, a four component format would read into the next attribute
 	atributeDescriptions[0].offset = offsetof(Vertex, pos);
 
 	atributeDescriptions[1].binding = 0;
 	atributeDescriptions[1].location = 1;
-	atributeDescriptions[1].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	atributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
 	atributeDescriptions[1].offset = offsetof(Vertex, texCoord);
 
 	atributeDescriptions[2].binding = 0;
 	atributeDescriptions[2].location = 2;
-	atributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	atributeDescriptions[2].format = VK_FORMAT_R32G32B32_SFLOAT;
 	atributeDescriptions[2].offset = offsetof(Vertex, norm);
 
 	return atributeDescriptions;
@@ -48,3 +60,96 @@ bool operator == (const Vertex& vertex1, const Vertex& vertex2)
 {
 	return ( (vertex1.pos == vertex2.pos) && (vertex1.texCoord == vertex2.texCoord) && (vertex1.norm == vertex2.norm) );
 }
+
+/*One odd multiplier per word, taken from well known 64-bit hash functions*/
+static const uint64_t vertexHashMultipliers[8] =
+{
+	0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull,
+	0xFF51AFD7ED558CCDull, 0xC4CEB9FE1A85EC53ull, 0xBF58476D1CE4E5B9ull, 0x94D049BB133111EBull
+};
+
+size_t hashVertexWords(const uint32_t* words)
+{
+	uint64_t sum = 0;
+
+#ifdef VERTEX_HASH_SSE2
+	/*_mm_mul_epu32 multiplies the even 32-bit lanes into 64-bit products, the odd lanes get shifted down for a second multiply*/
+	const __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words));
+	const __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + 4));
+
+	/*Only the low 32 bits of each multiplier fit a lane, which is still a different odd constant per word*/
+	const __m128i lowEvenMultipliers = _mm_set_epi32(0, static_cast<int>(vertexHashMultipliers[2]), 0, static_cast<int>(vertexHashMultipliers[0]));
+	const __m128i lowOddMultipliers = _mm_set_epi32(0, static_cast<int>(vertexHashMultipliers[3]), 0, static_cast<int>(vertexHashMultipliers[1]));
+	const __m128i highEvenMultipliers = _mm_set_epi32(0, static_cast<int>(vertexHashMultipliers[6]), 0, static_cast<int>(vertexHashMultipliers[4]));
+	const __m128i highOddMultipliers = _mm_set_epi32(0, static_cast<int>(vertexHashMultipliers[7]), 0, static_cast<int>(vertexHashMultipliers[5]));
+
+	__m128i products = _mm_add_epi64(_mm_mul_epu32(low, lowEvenMultipliers), _mm_mul_epu32(_mm_srli_epi64(low, 32), lowOddMultipliers));
+	products = _mm_add_epi64(products, _mm_mul_epu32(high, highEvenMultipliers));
+	products = _mm_add_epi64(products, _mm_mul_epu32(_mm_srli_epi64(high, 32), highOddMultipliers));
+
+	uint64_t lanes[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), products);
+
+	/*Rotate one half so the two sums do not cancel each other out*/
+	sum = lanes[0] ^ ((lanes[1] << 31) | (lanes[1] >> 33));
+#else
+	/*Same arithmetic as the SSE2 path, so both produce the same hash*/
+	uint64_t lanes[2] = { 0, 0 };
+
+	for (unsigned int word = 0; word < 8; word++)
+	{
+		const uint32_t multiplier = static_cast<uint32_t>(vertexHashMultipliers[word]);
+		const unsigned int lane = (word / 2) % 2;
+
+		lanes[lane] += static_cast<uint64_t>(words[word]) * multiplier;
+	}
+
+	sum = lanes[0] ^ ((lanes[1] << 31) | (lanes[1] >> 33));
+#endif
+
+	/*Final avalanche, every input bit affects every output bit*/
+	sum ^= sum >> 30;
+	sum *= 0xBF58476D1CE4E5B9ull;
+	sum ^= sum >> 27;
+	sum *= 0x94D049BB133111EBull;
+	sum ^= sum >> 31;
+
+	return static_cast<size_t>(sum);
+}
+
+std::size_t KeyHasher::operator()(const Vertex& v) const
+{
+	uint32_t words[8];
+	std::memcpy(words, &v, sizeof(words));
+
+	/*Clear the sign of zeros, everything else is hashed bit for bit*/
+	for (uint32_t& word : words)
+	{
+		word = (word == 0x80000000u) ? 0u : word;
+	}
+
+	return hashVertexWords(words);
+}
+
+QuantizedVertex::QuantizedVertex(const Vertex& vertex, float step)
+{
+	const float floats[8] = { vertex.pos.x, vertex.pos.y, vertex.pos.z, vertex.texCoord.x, vertex.texCoord.y, vertex.norm.x, vertex.norm.y, vertex.norm.z };
+
+	for (unsigned int index = 0; index < 8; index++)
+	{
+		/*Round to the nearest grid point, clamped so huge coordinates cannot overflow*/
+		const double gridPosition = std::floor(static_cast<double>(floats[index]) / step + 0.5);
+
+		values[index] = static_cast<int32_t>((std::max)(-2147483648.0, (std::min)(2147483647.0, gridPosition)));
+	}
+}
+
+bool operator == (const QuantizedVertex& vertex1, const QuantizedVertex& vertex2)
+{
+	return std::memcmp(vertex1.values, vertex2.values, sizeof(vertex1.values)) == 0;
+}
+
+std::size_t QuantizedKeyHasher::operator()(const QuantizedVertex& v) const
+{
+	return hashVertexWords(reinterpret_cast<const uint32_t*>(v.values));
+}
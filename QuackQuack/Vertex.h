@@ -9,6 +9,7 @@
 #include <functional>
 #include <string>
 #include <unordered_set>
+#include <stdint.h>
 
 struct Vertex
 {
@@ -28,17 +29,37 @@ struct Vertex
 
 bool operator == (const Vertex& vertex1, const Vertex& vertex2);
 
+/*
+	Hashes the eight 32-bit words of a vertex, or of a quantized vertex.
+
+	Every word is multiplied by its own 64-bit constant and the products are summed, which is done
+	two words at a time with SSE2. A final mix spreads the result over all bits, so vertices which only
+	differ in a single coordinate, as is common for flat or axis aligned geometry, still land in different buckets.
+*/
+size_t hashVertexWords(const uint32_t* words);
+
 // class for hash function 
 struct KeyHasher
 {
-	std::size_t operator()(const Vertex& v) const
-	{
-		using std::size_t;
-		using std::hash;
-		using std::string;
-
-		return ((hash<float>()(v.pos.x)
-			^ (hash<float>()(v.texCoord.y) << 1)) >> 1)
-			^ (hash<float>()(v.norm.z) << 1);
-	}
+	/*Covers all eight floats, with -0.0 hashed like 0.0 as operator == treats them as equal*/
+	std::size_t operator()(const Vertex& v) const;
+};
+
+/*
+	A vertex with every float snapped to a grid with the given spacing. Vertices which snap to the
+	same grid point compare equal, which welds near identical vertices when deduplicating.
+	Values on either side of a grid line are never merged, however close they are.
+*/
+struct QuantizedVertex
+{
+	int32_t values[8];
+
+	QuantizedVertex(const Vertex& vertex, float step);
+};
+
+bool operator == (const QuantizedVertex& vertex1, const QuantizedVertex& vertex2);
+
+struct QuantizedKeyHasher
+{
+	std::size_t operator()(const QuantizedVertex& v) const;
 };
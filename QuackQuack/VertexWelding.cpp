@@ -0,0 +1,250 @@
+#include "VertexWelding.h"
+
+#include <algorithm>
+#include <cmath>
+
+/*
+	Cells are this many times as large as the position tolerance. A vertex closer than the tolerance to a
+	side of its cell has to search the cell on that side as well, so larger cells mean fewer cells to search
+	for every vertex, but more vertices in each of them
+*/
+static const float cellsPerTolerance = 8.0f;
+
+/*Cell of the grid a position falls into, and the neighbouring cells within the tolerance of the position*/
+struct WeldCell
+{
+	int64_t x;
+	int64_t y;
+	int64_t z;
+	int8_t nearX; // -1 or 1 if the cell on that side is within the tolerance, 0 otherwise
+	int8_t nearY;
+	int8_t nearZ;
+};
+
+static WeldCell cellOf(const glm::vec3& position, float inverseCellSize)
+{
+	/*Positions far outside the grid share its outermost cells, which only costs comparisons*/
+	const float limit = 4.0e18f;
+
+	WeldCell cell;
+	int64_t* const coordinates[3] = { &cell.x, &cell.y, &cell.z };
+	int8_t* const nearSides[3] = { &cell.nearX, &cell.nearY, &cell.nearZ };
+
+	for (unsigned int axis = 0; axis < 3; axis++)
+	{
+		const float scaled = (std::max)(-limit, (std::min)(position[axis] * inverseCellSize, limit));
+		const float lower = std::floor(scaled);
+
+		*coordinates[axis] = static_cast<int64_t>(lower);
+		const float offset = scaled - lower;
+
+		*nearSides[axis] = (offset * cellsPerTolerance < 1.0f) ? -1 : ((offset * cellsPerTolerance > cellsPerTolerance - 1.0f) ? 1 : 0);
+	}
+
+	return cell;
+}
+
+/*
+	Bucket of a cell. Blocks of 4x4x4 cells are hashed and the cells of a block stay next to each other,
+	so the cells of vertices which follow each other in the mesh mostly share cache lines
+*/
+static uint64_t hashCell(int64_t x, int64_t y, int64_t z)
+{
+	uint64_t hash = static_cast<uint64_t>(x >> 2) * 0x9E3779B97F4A7C15ull ^ static_cast<uint64_t>(y >> 2) * 0xC2B2AE3D27D4EB4Full ^ static_cast<uint64_t>(z >> 2) * 0x165667B19E3779F9ull;
+
+	/*Final mix of MurmurHash3, neighbouring blocks differ in the low bits of a single coordinate*/
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+
+	return (hash << 6) | static_cast<uint64_t>((x & 3) | ((y & 3) << 2) | ((z & 3) << 4));
+}
+
+/*True if the vertices are within the tolerances of each other*/
+static bool withinTolerances(const Vertex& a, const Vertex& b, float positionDistanceSquared, float normalCosine, float textureCoordinateDistanceSquared)
+{
+	const glm::vec3 positionDifference = a.pos - b.pos;
+
+	if (glm::dot(positionDifference, positionDifference) > positionDistanceSquared)
+	{
+		return false;
+	}
+
+	const glm::vec2 textureCoordinateDifference = a.texCoord - b.texCoord;
+
+	if (glm::dot(textureCoordinateDifference, textureCoordinateDifference) > textureCoordinateDistanceSquared)
+	{
+		return false;
+	}
+
+	const float lengthA = glm::length(a.norm);
+	const float lengthB = glm::length(b.norm);
+
+	/*A missing normal is not close to any direction*/
+	if (lengthA == 0.0f || lengthB == 0.0f)
+	{
+		return lengthA == lengthB;
+	}
+
+	return glm::dot(a.norm, b.norm) >= normalCosine * lengthA * lengthB;
+}
+
+WeldResult weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes, const WeldTolerances& tolerances)
+{
+	WeldResult result;
+
+	if (!(tolerances.position > 0.0f) || vertices.empty())
+	{
+		return result;
+	}
+
+	const float inverseCellSize = 1.0f / (cellsPerTolerance * tolerances.position);
+	const float positionDistanceSquared = tolerances.position * tolerances.position;
+	const float normalCosine = std::cos((std::min)(tolerances.normal, 180.0f) * 0.0174532925f);
+	const float textureCoordinateDistanceSquared = tolerances.textureCoordinate * tolerances.textureCoordinate;
+
+	/*
+		The grid is a hash table of cells with the vertices of every bucket stored next to each other, built
+		with a counting sort. The sort keeps the vertex order inside the buckets, so the search can stop at
+		the first vertex which is not earlier than the one being welded
+	*/
+	size_t bucketCount = 16;
+
+	while (bucketCount < vertices.size() * 2)
+	{
+		bucketCount *= 2;
+	}
+
+	std::vector<WeldCell> cells(vertices.size());
+	std::vector<uint32_t> bucketStarts(bucketCount + 1, 0);
+
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+	{
+		cells[vertex] = cellOf(vertices[vertex].pos, inverseCellSize);
+		bucketStarts[(hashCell(cells[vertex].x, cells[vertex].y, cells[vertex].z) & (bucketCount - 1)) + 1]++;
+	}
+
+	for (size_t bucket = 0; bucket < bucketCount; bucket++)
+	{
+		bucketStarts[bucket + 1] += bucketStarts[bucket];
+	}
+
+	std::vector<uint32_t> bucketVertices(vertices.size());
+	std::vector<uint32_t> bucketEnds(bucketStarts.begin(), bucketStarts.end() - 1);
+
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+	{
+		bucketVertices[bucketEnds[hashCell(cells[vertex].x, cells[vertex].y, cells[vertex].z) & (bucketCount - 1)]++] = static_cast<uint32_t>(vertex);
+	}
+
+	/*The vertex every vertex is welded to, itself if it is kept*/
+	std::vector<uint32_t> remap(vertices.size());
+
+	/*Buckets already searched for the current vertex, neighbouring cells may share one*/
+	uint64_t searchedBuckets[8];
+
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+	{
+		uint32_t target = static_cast<uint32_t>(vertex);
+		unsigned int searchedCount = 0;
+
+		const WeldCell& cell = cells[vertex];
+
+		for (unsigned int neighbour = 0; neighbour < 8; neighbour++)
+		{
+			/*Skip the combinations which include a side that is not within the tolerance*/
+			if (((neighbour & 1) && cell.nearX == 0) || ((neighbour & 2) && cell.nearY == 0) || ((neighbour & 4) && cell.nearZ == 0))
+			{
+				continue;
+			}
+
+			const int64_t x = cell.x + ((neighbour & 1) ? cell.nearX : 0);
+			const int64_t y = cell.y + ((neighbour & 2) ? cell.nearY : 0);
+			const int64_t z = cell.z + ((neighbour & 4) ? cell.nearZ : 0);
+			const uint64_t bucket = hashCell(x, y, z) & (bucketCount - 1);
+
+			if (std::find(searchedBuckets, searchedBuckets + searchedCount, bucket) != searchedBuckets + searchedCount)
+			{
+				continue;
+			}
+
+			searchedBuckets[searchedCount++] = bucket;
+
+			/*The earliest kept vertex within the tolerances wins, wherever it is in the grid*/
+			for (uint32_t item = bucketStarts[bucket]; item < bucketStarts[bucket + 1] && bucketVertices[item] < target; item++)
+			{
+				const uint32_t candidate = bucketVertices[item];
+
+				if (remap[candidate] == candidate && withinTolerances(vertices[candidate], vertices[vertex], positionDistanceSquared, normalCosine, textureCoordinateDistanceSquared))
+				{
+					target = candidate;
+					break;
+				}
+			}
+		}
+
+		remap[vertex] = target;
+		result.mergedVertexCount += (target != vertex) ? 1 : 0;
+	}
+
+	if (result.mergedVertexCount == 0)
+	{
+		return result;
+	}
+
+	/*Compact the kept vertices in their order, then point the triangles at them*/
+	std::vector<uint32_t> newIndices(vertices.size());
+	size_t keptCount = 0;
+
+	for (size_t vertex = 0; vertex < vertices.size(); vertex++)
+	{
+		if (remap[vertex] == vertex)
+		{
+			newIndices[vertex] = static_cast<uint32_t>(keptCount);
+			vertices[keptCount++] = vertices[vertex];
+		}
+	}
+
+	vertices.resize(keptCount);
+
+	/*A mesh without submeshes is compacted as a single range*/
+	Submesh wholeMesh;
+	wholeMesh.indexCount = static_cast<uint32_t>(indices.size());
+
+	Submesh* const firstRange = submeshes.empty() ? &wholeMesh : submeshes.data();
+	Submesh* const lastRange = submeshes.empty() ? &wholeMesh + 1 : submeshes.data() + submeshes.size();
+
+	size_t writtenIndexCount = 0;
+
+	for (Submesh* range = firstRange; range != lastRange; range++)
+	{
+		const size_t rangeStart = writtenIndexCount;
+
+		for (size_t index = range->indexOffset; index < range->indexOffset + range->indexCount; index += 3)
+		{
+			const uint32_t a = newIndices[remap[indices[index + 0]]];
+			const uint32_t b = newIndices[remap[indices[index + 1]]];
+			const uint32_t c = newIndices[remap[indices[index + 2]]];
+
+			if (a == b || b == c || c == a)
+			{
+				result.removedTriangleCount++;
+				continue;
+			}
+
+			indices[writtenIndexCount++] = a;
+			indices[writtenIndexCount++] = b;
+			indices[writtenIndexCount++] = c;
+		}
+
+		range->indexOffset = static_cast<uint32_t>(rangeStart);
+		range->indexCount = static_cast<uint32_t>(writtenIndexCount - rangeStart);
+	}
+
+	indices.resize(writtenIndexCount);
+
+	/*Submeshes whose triangles all collapsed have nothing left to draw*/
+	submeshes.erase(std::remove_if(submeshes.begin(), submeshes.end(), [](const Submesh& submesh) { return submesh.indexCount == 0; }), submeshes.end());
+
+	return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <vector>
+#include <stdint.h>
+
+#include "MeshData.h"
+
+/*
+	Merges vertices which only differ by the rounding noise exporters and scanners leave behind.
+
+	Deduplicating by value only merges bit identical vertices, so a mesh whose seams were written
+	with slightly different coordinates keeps every copy. Welding looks for vertices within a small
+	distance of each other instead, using a hash grid with cells several times the position tolerance, so
+	most vertices only search their own cell and a few of its neighbours.
+*/
+
+/*How far apart two vertices may be and still be welded. Every attribute has to be within its tolerance*/
+struct WeldTolerances
+{
+	float position = 0.0f; // Largest distance between the positions, 0 disables welding
+	float normal = 1.0f; // Largest angle between the normals, in degrees. Vertices without a normal only weld with each other
+	float textureCoordinate = 0.0001f; // Largest distance between the texture coordinates
+};
+
+/*What welding changed*/
+struct WeldResult
+{
+	size_t mergedVertexCount = 0; // Vertices replaced by a vertex close to them
+	size_t removedTriangleCount = 0; // Triangles which lost their area because two of their corners were welded
+};
+
+/*
+	Replaces every vertex by the first earlier vertex within the tolerances, removes the vertices which
+	are no longer used and the triangles which collapsed. Vertices are only welded to vertices which were
+	kept themselves, so no vertex moves further than the tolerances, however long a run of close vertices is.
+	The remaining vertices and triangles keep their order, and the submeshes shrink by the triangles they lost.
+*/
+WeldResult weldVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, std::vector<Submesh>& submeshes, const WeldTolerances& tolerances);
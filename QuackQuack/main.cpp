@@ -1,18 +1,35 @@
 #include "RenderCode.h" // Include all class deinitions of our user-defined class
 #include "OBJReaderClass.h" // Include the obj reader
+#include "OBJReaderBenchmark.h" // Loader throughput measurements
+#include "StartupTrace.h" // Timeline of the init stages and asset loads
 
 #include <glm.hpp>
 
+#include <future>
+
 /*The main entry point of our program*/
 int main()
 {
-	/*The mesh data*/
-	OBJReaderClass reader("Meshes/viking_room.obj");
-	const std::vector<Vertex> vertices = reader.getVertices();
-	const std::vector<uint32_t> indices = reader.getIndices();
+#ifdef QUACK_OBJ_BENCHMARK
+	/*Define QUACK_OBJ_BENCHMARK in the project settings to measure the obj loader before the renderer starts*/
+	benchmarkNumberParsing(5);
+	benchmarkObjReader("Meshes/viking_room.obj", 5);
+#endif
+
+	/*The mesh is read on a background thread, while the window and the Vulkan objects are created*/
+	std::future<MeshData> meshLoad = std::async(std::launch::async, []()
+	{
+		OBJReaderOptions options;
+		options.optimizeMesh = true; // The optimized order is stored in the mesh cache, so this only costs time on the first launch
+		options.lodLevelCount = 4; // Detail levels for when the camera moves away, also stored in the cache
+		options.trianglesPerChunk = 1024; // Chunks small enough to cull parts of a large mesh, large enough to keep the draw count low
+
+		OBJReaderClass reader("Meshes/viking_room.obj", options);
+		return reader.takeMesh();
+	}); // The reader and its raw attribute arrays are released once the thread is done, only the final mesh stays in memory
 
 	/*And instance representing the Vulkan application which renders a triangle to the screen*/
-	RenderCode app(vertices, indices);
+	RenderCode app(std::move(meshLoad), VertexFormat::Compact); // Compact vertices take half the memory and bandwidth of the full ones
 
 	/*A try block to enclose a function which could potentially throw an exception*/
 	try
@@ -26,10 +43,15 @@ int main()
 		/*Output the exception to stdout*/
 		std::cerr << e.what() << std::endl;
 
+		writeChromeTrace("startup_trace.json"); // A failed startup is the one most worth looking at
+
 		/*Returns a implementation-specific error code */
 		return EXIT_FAILURE; // The author has most likely used this to ensure people are not bound to a single system. I.e. the code is cross-platform.
 	}
 
+	/*The zones of the whole run, open it in chrome://tracing or Perfetto*/
+	writeChromeTrace("startup_trace.json");
+
 	/*
 	Visual studio closes the console as soon as program has stopped executing. This caused me to use some hacks around the system. I could've used a breakpoint, but even that has it's issues.
 	This would do for now.